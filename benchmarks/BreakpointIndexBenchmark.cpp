@@ -0,0 +1,132 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Times how long a 4 KiB read takes to find the breakpoints it has to mask
+// with 10k breakpoints set, once through the index DebuggerCoreBase keeps and
+// once by walking every breakpoint, which is what reads used to do
+
+#include "BreakpointIndex.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+
+#include <cstdio>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+const int            BREAKPOINT_COUNT = 10000;
+const int            READ_COUNT       = 100000;
+const std::size_t    READ_SIZE        = 0x1000;
+const edb::address_t CODE_START       = 0x400000;
+const std::size_t    CODE_SIZE        = 0x4000000; // the breakpoints are spread over this much code
+
+// the largest breakpoint there is, a ud2
+const std::size_t BREAKPOINT_MAX_SIZE = 2;
+
+// all that reads need of a breakpoint, sized like an int3
+class BenchmarkBreakpoint {
+public:
+	explicit BenchmarkBreakpoint(edb::address_t address) : address_(address) {
+	}
+
+public:
+	edb::address_t address() const { return address_; }
+	std::size_t size() const       { return 1; }
+
+private:
+	edb::address_t address_;
+};
+
+using Index          = DebuggerCorePlugin::BreakpointIndex<BenchmarkBreakpoint, BREAKPOINT_MAX_SIZE>;
+using BreakpointList = QHash<edb::address_t, std::shared_ptr<BenchmarkBreakpoint>>;
+
+//------------------------------------------------------------------------------
+// Name: count_linear
+// Desc: counts the breakpoints overlapping the read by looking at all of them
+//------------------------------------------------------------------------------
+std::size_t count_linear(const BreakpointList &breakpoints, edb::address_t address, std::size_t len) {
+
+	std::size_t count = 0;
+	for(const std::shared_ptr<BenchmarkBreakpoint> &bp : breakpoints) {
+		if(bp->address() + bp->size() > address && bp->address() < address + len) {
+			++count;
+		}
+	}
+
+	return count;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: main
+// Desc:
+//------------------------------------------------------------------------------
+int main() {
+
+	std::mt19937_64 random(0x20181112);
+
+	BreakpointList breakpoints;
+	Index          index;
+
+	std::uniform_int_distribution<quint64> code_offset(0, CODE_SIZE - 1);
+	while(breakpoints.size() < BREAKPOINT_COUNT) {
+		const edb::address_t address = CODE_START + code_offset(random);
+		auto bp = std::make_shared<BenchmarkBreakpoint>(address);
+		breakpoints[address] = bp;
+		index.insert(address, bp);
+	}
+
+	std::vector<edb::address_t> reads;
+	reads.reserve(READ_COUNT);
+
+	std::uniform_int_distribution<quint64> read_offset(0, CODE_SIZE - READ_SIZE);
+	for(int i = 0; i < READ_COUNT; ++i) {
+		reads.push_back(CODE_START + read_offset(random));
+	}
+
+	QElapsedTimer timer;
+
+	timer.start();
+	std::size_t indexed_hits = 0;
+	for(const edb::address_t address : reads) {
+		indexed_hits += index.overlapping(address, READ_SIZE).size();
+	}
+	const qint64 indexed_nsecs = timer.nsecsElapsed();
+
+	timer.start();
+	std::size_t linear_hits = 0;
+	for(const edb::address_t address : reads) {
+		linear_hits += count_linear(breakpoints, address, READ_SIZE);
+	}
+	const qint64 linear_nsecs = timer.nsecsElapsed();
+
+	std::printf("%d reads of %zu bytes, %d breakpoints\n", READ_COUNT, READ_SIZE, BREAKPOINT_COUNT);
+	std::printf("index:  %10.1f ns/read, %zu breakpoints masked\n", static_cast<double>(indexed_nsecs) / READ_COUNT, indexed_hits);
+	std::printf("linear: %10.1f ns/read, %zu breakpoints masked\n", static_cast<double>(linear_nsecs) / READ_COUNT, linear_hits);
+
+	if(indexed_hits != linear_hits) {
+		std::fprintf(stderr, "the index and the linear walk disagree\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,119 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef CODE_IMAGE_20181112_H_
+#define CODE_IMAGE_20181112_H_
+
+#include "Instruction.h"
+
+#include <QByteArray>
+#include <QFile>
+#include <QString>
+
+#include <cstdio>
+#include <cstring>
+#include <dlfcn.h>
+#include <link.h>
+
+// the code the decoding benchmarks run over, which is the executable segment
+// of a library. By default that is the C library the benchmark itself uses
+struct CodeImage {
+	QString    path;
+	QByteArray bytes;
+	quint64    address = 0; // where the segment is meant to be loaded
+};
+
+//------------------------------------------------------------------------------
+// Name: init_capstone
+// Desc: sets the disassembler up for the architecture edb is built for
+//------------------------------------------------------------------------------
+inline bool init_capstone() {
+#if defined EDB_X86 || defined EDB_X86_64
+	return CapstoneEDB::init(EDB_IS_64_BIT ? CapstoneEDB::Architecture::ARCH_AMD64 : CapstoneEDB::Architecture::ARCH_X86);
+#elif defined EDB_ARM32
+	return CapstoneEDB::init(CapstoneEDB::Architecture::ARCH_ARM32_ARM);
+#elif defined EDB_ARM64
+	return CapstoneEDB::init(CapstoneEDB::Architecture::ARCH_ARM64);
+#else
+#error "How to initialize Capstone?"
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: default_library_path
+// Desc: the file the C library was loaded from
+//------------------------------------------------------------------------------
+inline QString default_library_path() {
+	Dl_info info;
+	if(dladdr(reinterpret_cast<void *>(&std::fopen), &info) && info.dli_fname) {
+		return QString::fromLocal8Bit(info.dli_fname);
+	}
+
+	return QString();
+}
+
+//------------------------------------------------------------------------------
+// Name: load_code_image
+// Desc: reads the first executable segment of the ELF file <path>, which has
+//       to be of the same class as edb itself
+//------------------------------------------------------------------------------
+inline bool load_code_image(const QString &path, CodeImage *image) {
+
+	QFile file(path);
+	if(!file.open(QIODevice::ReadOnly)) {
+		std::fprintf(stderr, "unable to open %s\n", qPrintable(path));
+		return false;
+	}
+
+	const QByteArray elf = file.readAll();
+
+	ElfW(Ehdr) header;
+	if(static_cast<std::size_t>(elf.size()) < sizeof(header)) {
+		std::fprintf(stderr, "%s is not an ELF file\n", qPrintable(path));
+		return false;
+	}
+
+	std::memcpy(&header, elf.constData(), sizeof(header));
+	if(std::memcmp(header.e_ident, ELFMAG, SELFMAG) != 0 || header.e_phentsize != sizeof(ElfW(Phdr))) {
+		std::fprintf(stderr, "%s is not an ELF file edb can load\n", qPrintable(path));
+		return false;
+	}
+
+	for(int i = 0; i < header.e_phnum; ++i) {
+
+		const quint64 offset = header.e_phoff + static_cast<quint64>(i) * sizeof(ElfW(Phdr));
+		if(offset + sizeof(ElfW(Phdr)) > static_cast<quint64>(elf.size())) {
+			break;
+		}
+
+		ElfW(Phdr) segment;
+		std::memcpy(&segment, elf.constData() + offset, sizeof(segment));
+
+		if(segment.p_type == PT_LOAD && (segment.p_flags & PF_X) && segment.p_offset + segment.p_filesz <= static_cast<quint64>(elf.size())) {
+			image->path    = path;
+			image->bytes   = elf.mid(segment.p_offset, segment.p_filesz);
+			image->address = segment.p_vaddr;
+			return true;
+		}
+	}
+
+	std::fprintf(stderr, "%s has no code\n", qPrintable(path));
+	return false;
+}
+
+#endif
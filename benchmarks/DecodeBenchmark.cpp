@@ -0,0 +1,153 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Compares how fast the code of a library (the C library unless one is given
+// on the command line) can be swept with each of the ways there are to decode
+// an instruction: a full Instruction, an Instruction decoded into an
+// InstructionBuffer, and decode_length
+
+#include "CodeImage.h"
+#include "Instruction.h"
+
+#include <QElapsedTimer>
+
+#include <cstdio>
+#include <functional>
+
+namespace {
+
+// each sweep is run this many times and the fastest run is reported
+const int ROUNDS = 5;
+
+struct Sweep {
+	const char                   *name;
+	std::function<std::size_t()>  run; // returns how many instructions were decoded
+};
+
+//------------------------------------------------------------------------------
+// Name: fastest_run
+// Desc: returns the time of the fastest of ROUNDS runs of <sweep> in ns
+//------------------------------------------------------------------------------
+qint64 fastest_run(const Sweep &sweep, std::size_t *count) {
+
+	qint64 best = -1;
+
+	for(int i = 0; i < ROUNDS; ++i) {
+		QElapsedTimer timer;
+		timer.start();
+		*count = sweep.run();
+		const qint64 nsecs = timer.nsecsElapsed();
+
+		if(best < 0 || nsecs < best) {
+			best = nsecs;
+		}
+	}
+
+	return best;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: main
+// Desc:
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+
+	const QString path = (argc > 1) ? QString::fromLocal8Bit(argv[1]) : default_library_path();
+
+	CodeImage image;
+	if(path.isEmpty() || !load_code_image(path, &image)) {
+		return 1;
+	}
+
+	if(!init_capstone()) {
+		std::fprintf(stderr, "unable to initialize capstone\n");
+		return 1;
+	}
+
+	const auto first = reinterpret_cast<const quint8 *>(image.bytes.constData());
+	const auto last  = first + image.bytes.size();
+
+	// every sweep moves past each instruction it decodes, or one byte on where
+	// there is none
+	const Sweep sweeps[] = {
+		{ "Instruction", [&]() {
+			std::size_t count = 0;
+			for(const quint8 *p = first; p < last;) {
+				const CapstoneEDB::Instruction inst(p, last, image.address + (p - first));
+				if(inst) {
+					++count;
+				}
+				p += inst.byte_size();
+			}
+			return count;
+		}},
+		{ "InstructionBuffer", [&]() {
+			CapstoneEDB::InstructionBuffer buffer;
+			std::size_t count = 0;
+			for(const quint8 *p = first; p < last;) {
+				const CapstoneEDB::Instruction inst(buffer, p, last, image.address + (p - first));
+				if(inst) {
+					++count;
+				}
+				p += inst.byte_size();
+			}
+			return count;
+		}},
+		{ "decode_length", [&]() {
+			CapstoneEDB::InstructionBuffer buffer;
+			std::size_t count = 0;
+			for(const quint8 *p = first; p < last;) {
+				if(const std::size_t size = CapstoneEDB::decode_length(buffer, p, last, image.address + (p - first))) {
+					++count;
+					p += size;
+				} else {
+					++p;
+				}
+			}
+			return count;
+		}},
+	};
+
+	std::printf("%s: %d bytes of code\n", qPrintable(image.path), image.bytes.size());
+
+	std::size_t expected = 0;
+	bool        agree    = true;
+
+	for(const Sweep &sweep : sweeps) {
+		std::size_t count = 0;
+		const qint64 nsecs = fastest_run(sweep, &count);
+
+		const double mib_per_sec = (image.bytes.size() / (1024.0 * 1024.0)) / (nsecs / 1e9);
+		std::printf("%-18s %8.1f MiB/s %8.1f ns/instruction %10zu instructions\n", sweep.name, mib_per_sec, static_cast<double>(nsecs) / (count ? count : 1), count);
+
+		if(&sweep == sweeps) {
+			expected = count;
+		} else if(count != expected) {
+			agree = false;
+		}
+	}
+
+	if(!agree) {
+		std::fprintf(stderr, "the sweeps decoded different numbers of instructions\n");
+		return 1;
+	}
+
+	return 0;
+}
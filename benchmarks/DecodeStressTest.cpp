@@ -0,0 +1,151 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Decodes the code of a library (the C library unless one is given on the
+// command line) from several threads at once, and checks that every thread
+// gets exactly what a single thread does. Each thread uses its own capstone
+// handles, so any difference means they are being shared
+//
+// usage: decode_stress_test [threads] [library]
+
+#include "CodeImage.h"
+#include "Instruction.h"
+
+#include <QVector>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// the code is decoded in slices of this size, each thread goes over all of
+// them ROUNDS times, starting at a different one
+const int SLICE_SIZE = 0x10000;
+const int ROUNDS     = 3;
+
+//------------------------------------------------------------------------------
+// Name: hash_bytes
+// Desc: FNV-1a
+//------------------------------------------------------------------------------
+quint64 hash_bytes(quint64 hash, const void *data, std::size_t size) {
+	auto p = static_cast<const quint8 *>(data);
+	for(std::size_t i = 0; i < size; ++i) {
+		hash = (hash ^ p[i]) * 0x100000001b3ull;
+	}
+	return hash;
+}
+
+//------------------------------------------------------------------------------
+// Name: digest_slice
+// Desc: sweeps the <slice>th slice of <image> and hashes the text of every
+//       instruction along with what decode_length makes of it
+//------------------------------------------------------------------------------
+quint64 digest_slice(const CodeImage &image, int slice) {
+
+	const auto code  = reinterpret_cast<const quint8 *>(image.bytes.constData());
+	const auto first = code + slice * SLICE_SIZE;
+	const auto last  = code + std::min(image.bytes.size(), (slice + 1) * SLICE_SIZE);
+
+	CapstoneEDB::Formatter         formatter;
+	CapstoneEDB::InstructionBuffer instructions;
+	CapstoneEDB::InstructionBuffer lengths;
+
+	quint64 hash = 0xcbf29ce484222325ull;
+
+	for(const quint8 *p = first; p < last;) {
+		const quint64 address = image.address + (p - code);
+
+		const CapstoneEDB::Instruction inst(instructions, p, last, address);
+		const std::string text = formatter.to_string(inst);
+		hash = hash_bytes(hash, text.data(), text.size());
+
+		CapstoneEDB::FlowClass flow;
+		const quint64 length = CapstoneEDB::decode_length(lengths, p, last, address, &flow);
+		hash = hash_bytes(hash, &length, sizeof(length));
+		hash = hash_bytes(hash, &flow, sizeof(flow));
+
+		p += inst.byte_size();
+	}
+
+	return hash;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: main
+// Desc:
+//------------------------------------------------------------------------------
+int main(int argc, char *argv[]) {
+
+	const int thread_count = (argc > 1) ? std::atoi(argv[1]) : std::max(4, static_cast<int>(std::thread::hardware_concurrency()));
+	const QString path     = (argc > 2) ? QString::fromLocal8Bit(argv[2]) : default_library_path();
+
+	if(thread_count < 1) {
+		std::fprintf(stderr, "usage: %s [threads] [library]\n", argv[0]);
+		return 1;
+	}
+
+	CodeImage image;
+	if(path.isEmpty() || !load_code_image(path, &image)) {
+		return 1;
+	}
+
+	if(!init_capstone()) {
+		std::fprintf(stderr, "unable to initialize capstone\n");
+		return 1;
+	}
+
+	const int slice_count = (image.bytes.size() + SLICE_SIZE - 1) / SLICE_SIZE;
+
+	// what a single thread makes of the code
+	QVector<quint64> expected(slice_count);
+	for(int slice = 0; slice < slice_count; ++slice) {
+		expected[slice] = digest_slice(image, slice);
+	}
+
+	std::atomic<int> mismatches(0);
+
+	std::vector<std::thread> threads;
+	for(int t = 0; t < thread_count; ++t) {
+		threads.emplace_back([&, t]() {
+			const int start = (t * slice_count) / thread_count;
+			for(int round = 0; round < ROUNDS; ++round) {
+				for(int i = 0; i < slice_count; ++i) {
+					const int slice = (start + i) % slice_count;
+					if(digest_slice(image, slice) != expected.at(slice)) {
+						++mismatches;
+					}
+				}
+			}
+		});
+	}
+
+	for(std::thread &thread : threads) {
+		thread.join();
+	}
+
+	std::printf("%s: %d slices decoded %d times by each of %d threads, %d mismatches\n", qPrintable(image.path), slice_count, ROUNDS, thread_count, mismatches.load());
+
+	return mismatches ? 1 : 0;
+}
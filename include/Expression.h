@@ -20,7 +20,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define EXPRESSION_20070402_H_
 
 #include <QString>
+#include <QStringList>
+#include <QVarLengthArray>
 #include <functional>
+#include <vector>
 
 struct ExpressionError {
 public:
@@ -73,6 +76,70 @@ private:
 };
 
 
+// A parsed expression in the form of a small stack machine program. Variables
+// are referred to by index into variables(), so a caller which evaluates the
+// same expression many times can resolve each name once up front
+template <class T>
+class CompiledExpression {
+	template <class U>
+	friend class Expression;
+
+public:
+	typedef std::function<T(std::size_t, bool*, ExpressionError*)> variable_reader_t;
+	typedef std::function<T(T, bool*, ExpressionError*)>           memory_reader_t;
+
+public:
+	enum OpCode : quint8 {
+		PUSH_CONST, // push constants_[operand]
+		PUSH_VAR,   // push the value of variables_[operand]
+		LOAD,       // replace the top of the stack with the memory it points to
+		POS,
+		NEG,
+		CMP,
+		NOT,
+		AND,
+		OR,
+		XOR,
+		LSHFT,
+		RSHFT,
+		ADD,
+		SUB,
+		MUL,
+		DIV,
+		MOD,
+		LT,
+		LE,
+		GT,
+		GE,
+		EQ,
+		NE,
+		LOGICAL_AND,
+		LOGICAL_OR
+	};
+
+	struct Op {
+		OpCode      code;
+		std::size_t operand;
+	};
+
+public:
+	bool empty() const                { return code_.empty(); }
+	const QStringList &variables() const { return variables_; }
+
+public:
+	T evaluate(const variable_reader_t &vr, const memory_reader_t &mr, bool *ok, ExpressionError *error) const noexcept;
+
+private:
+	void append_op(OpCode code, std::size_t operand = 0) {
+		code_.push_back(Op{code, operand});
+	}
+
+private:
+	std::vector<Op> code_;
+	std::vector<T>  constants_;
+	QStringList     variables_;
+};
+
 template <class T>
 class Expression {
 public:
@@ -132,42 +199,21 @@ private:
 		}
 	};
 
-private:
-	T evaluate_expression() {
-		T result;
-
-		get_token();
-		eval_exp(result);
-
-		return result;
-	}
-
 public:
-	T evaluate_expression(bool *ok, ExpressionError *error) noexcept {
-
-		Q_ASSERT(ok);
-		Q_ASSERT(error);
-
-		try {
-			*ok = true;
-			return evaluate_expression();
-		} catch(const ExpressionError &e) {
-			*ok = false;
-			*error = e;
-			return T();
-		}
-	}
+	CompiledExpression<T> compile(bool *ok, ExpressionError *error) noexcept;
+	T evaluate_expression(bool *ok, ExpressionError *error) noexcept;
+
 private:
-	void eval_exp(T &result);
-	void eval_exp0(T &result);
-	void eval_exp1(T &result);
-	void eval_exp2(T &result);
-	void eval_exp3(T &result);
-	void eval_exp4(T &result);
-	void eval_exp5(T &result);
-	void eval_exp6(T &result);
-	void eval_exp7(T &result);
-	void eval_atom(T &result);
+	void eval_exp();
+	void eval_exp0();
+	void eval_exp1();
+	void eval_exp2();
+	void eval_exp3();
+	void eval_exp4();
+	void eval_exp5();
+	void eval_exp6();
+	void eval_exp7();
+	void eval_atom();
 	void get_token();
 
 	static bool is_delim(QChar ch) {
@@ -180,6 +226,7 @@ private:
 	Token                   token_;
 	variable_getter_t       variable_reader_;
 	memory_reader_t         memory_reader_;
+	CompiledExpression<T>   program_;
 };
 
 #include "Expression.tcc"
@@ -19,6 +19,138 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef EXPRESSION_20070402_TCC_
 #define EXPRESSION_20070402_TCC_
 
+//------------------------------------------------------------------------------
+// Name: evaluate
+// Desc: runs the program, variables are fetched through <vr> by index
+//------------------------------------------------------------------------------
+template <class T>
+T CompiledExpression<T>::evaluate(const variable_reader_t &vr, const memory_reader_t &mr, bool *ok, ExpressionError *error) const noexcept {
+
+	Q_ASSERT(ok);
+	Q_ASSERT(error);
+
+	QVarLengthArray<T, 16> stack;
+
+	try {
+		for(const Op &op : code_) {
+			switch(op.code) {
+			case PUSH_CONST:
+				stack.push_back(constants_[op.operand]);
+				break;
+			case PUSH_VAR:
+				if(vr) {
+					bool var_ok;
+					ExpressionError var_error;
+					const T value = vr(op.operand, &var_ok, &var_error);
+					if(!var_ok) {
+						throw var_error;
+					}
+					stack.push_back(value);
+				} else {
+					throw ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
+				}
+				break;
+			case LOAD:
+				if(mr) {
+					bool mem_ok;
+					ExpressionError mem_error;
+					stack.last() = mr(stack.last(), &mem_ok, &mem_error);
+					if(!mem_ok) {
+						throw mem_error;
+					}
+				} else {
+					throw ExpressionError(ExpressionError::CANNOT_READ_MEMORY);
+				}
+				break;
+			case POS:
+				// this may seems like a waste, but unary + can be overloaded for a type
+				// to have a non-nop effect!
+				stack.last() = +stack.last();
+				break;
+			case NEG:
+#ifdef _MSC_VER
+#pragma warning(push)
+#pragma warning(disable:4146)
+#endif
+				stack.last() = -stack.last();
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+				break;
+			case CMP:
+				stack.last() = ~stack.last();
+				break;
+			case NOT:
+				stack.last() = !stack.last();
+				break;
+			default:
+				{
+					const T partial_value = stack.last();
+					stack.removeLast();
+					T &result = stack.last();
+
+					switch(op.code) {
+					case AND:         result &= partial_value; break;
+					case OR:          result |= partial_value; break;
+					case XOR:         result ^= partial_value; break;
+					case LSHFT:       result <<= partial_value; break;
+					case RSHFT:       result >>= partial_value; break;
+					case ADD:         result += partial_value; break;
+					case SUB:
+#ifdef _MSC_VER
+#pragma warning(push)
+/* disable warning about applying unary - to an unsigned type */
+#pragma warning(disable : 4146)
+#endif
+						result -= partial_value;
+#ifdef _MSC_VER
+#pragma warning(pop)
+#endif
+						break;
+					case MUL:         result *= partial_value; break;
+					case DIV:
+						if(partial_value == 0) {
+							throw ExpressionError(ExpressionError::DIVIDE_BY_ZERO);
+						}
+						result /= partial_value;
+						break;
+					case MOD:
+						if(partial_value == 0) {
+							throw ExpressionError(ExpressionError::DIVIDE_BY_ZERO);
+						}
+						result %= partial_value;
+						break;
+					case LT:          result = result <  partial_value; break;
+					case LE:          result = result <= partial_value; break;
+					case GT:          result = result >  partial_value; break;
+					case GE:          result = result >= partial_value; break;
+					case EQ:          result = result == partial_value; break;
+					case NE:          result = result != partial_value; break;
+					case LOGICAL_AND: result = result && partial_value; break;
+					case LOGICAL_OR:  result = result || partial_value; break;
+					default:
+						break;
+					}
+				}
+				break;
+			}
+		}
+	} catch(const ExpressionError &e) {
+		*ok    = false;
+		*error = e;
+		return T();
+	}
+
+	if(stack.size() != 1) {
+		*ok    = false;
+		*error = ExpressionError(ExpressionError::SYNTAX);
+		return T();
+	}
+
+	*ok = true;
+	return stack.last();
+}
+
 //------------------------------------------------------------------------------
 // Name: Expression
 // Desc:
@@ -29,17 +161,70 @@ Expression<T>::Expression(const QString &s, variable_getter_t vg, memory_reader_
 		variable_reader_(vg), memory_reader_(mr) {
 }
 
+//------------------------------------------------------------------------------
+// Name: compile
+// Desc: parses the expression into a program which can be evaluated any
+//       number of times without parsing again
+//------------------------------------------------------------------------------
+template <class T>
+CompiledExpression<T> Expression<T>::compile(bool *ok, ExpressionError *error) noexcept {
+
+	Q_ASSERT(ok);
+	Q_ASSERT(error);
+
+	expression_ptr_ = expression_.begin();
+	program_        = CompiledExpression<T>();
+
+	try {
+		get_token();
+		eval_exp();
+		*ok = true;
+		return program_;
+	} catch(const ExpressionError &e) {
+		*ok = false;
+		*error = e;
+		return CompiledExpression<T>();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: evaluate_expression
+// Desc:
+//------------------------------------------------------------------------------
+template <class T>
+T Expression<T>::evaluate_expression(bool *ok, ExpressionError *error) noexcept {
+
+	const CompiledExpression<T> program = compile(ok, error);
+	if(!*ok) {
+		return T();
+	}
+
+	const QStringList &names = program.variables();
+	const variable_getter_t &variable_reader = variable_reader_;
+
+	return program.evaluate(
+		[&names, &variable_reader](std::size_t index, bool *var_ok, ExpressionError *var_error) -> T {
+			if(!variable_reader) {
+				*var_ok    = false;
+				*var_error = ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
+				return T();
+			}
+			return variable_reader(names[index], var_ok, var_error);
+		},
+		memory_reader_, ok, error);
+}
+
 //------------------------------------------------------------------------------
 // Name: eval_exp
 // Desc: private entry point with sanity check
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp(T &result) {
+void Expression<T>::eval_exp() {
 	if(token_.type_ == Token::UNKNOWN) {
 		throw ExpressionError(ExpressionError::SYNTAX);
 	}
 
-	eval_exp0(result);
+	eval_exp0();
 
 	switch(token_.type_) {
 	case Token::OPERATOR:
@@ -67,22 +252,19 @@ void Expression<T>::eval_exp(T &result) {
 // Desc: logic
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp0(T &result) {
-	eval_exp1(result);
+void Expression<T>::eval_exp0() {
+	eval_exp1();
 
 	for(Token op = token_; op.operator_ == Token::LOGICAL_AND || op.operator_ == Token::LOGICAL_OR; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp1(partial_value);
+		eval_exp1();
 
-		// add or subtract
 		switch(op.operator_) {
 		case Token::LOGICAL_AND:
-			result = result && partial_value;
+			program_.append_op(CompiledExpression<T>::LOGICAL_AND);
 			break;
 		case Token::LOGICAL_OR:
-			result = result || partial_value;
+			program_.append_op(CompiledExpression<T>::LOGICAL_OR);
 			break;
 		default:
 			break;
@@ -95,25 +277,22 @@ void Expression<T>::eval_exp0(T &result) {
 // Desc: binary logic
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp1(T &result) {
-	eval_exp2(result);
+void Expression<T>::eval_exp1() {
+	eval_exp2();
 
 	for(Token op = token_; op.operator_ == Token::AND || op.operator_ == Token::OR || op.operator_ == Token::XOR; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp2(partial_value);
+		eval_exp2();
 
-		// add or subtract
 		switch(op.operator_) {
 		case Token::AND:
-			result &= partial_value;
+			program_.append_op(CompiledExpression<T>::AND);
 			break;
 		case Token::OR:
-			result |= partial_value;
+			program_.append_op(CompiledExpression<T>::OR);
 			break;
 		case Token::XOR:
-			result ^= partial_value;
+			program_.append_op(CompiledExpression<T>::XOR);
 			break;
 		default:
 			break;
@@ -126,34 +305,31 @@ void Expression<T>::eval_exp1(T &result) {
 // Desc: comparisons
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp2(T &result) {
-	eval_exp3(result);
+void Expression<T>::eval_exp2() {
+	eval_exp3();
 
 	for(Token op = token_; op.operator_ == Token::LT || op.operator_ == Token::LE || op.operator_ == Token::GT || op.operator_ == Token::GE || op.operator_ == Token::EQ || op.operator_ == Token::NE; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp3(partial_value);
+		eval_exp3();
 
-		// perform the relational operation
 		switch(op.operator_) {
 		case Token::LT:
-			result = result < partial_value;
+			program_.append_op(CompiledExpression<T>::LT);
 			break;
 		case Token::LE:
-			result = result <= partial_value;
+			program_.append_op(CompiledExpression<T>::LE);
 			break;
 		case Token::GT:
-			result = result > partial_value;
+			program_.append_op(CompiledExpression<T>::GT);
 			break;
 		case Token::GE:
-			result = result >= partial_value;
+			program_.append_op(CompiledExpression<T>::GE);
 			break;
 		case Token::EQ:
-			result = result == partial_value;
+			program_.append_op(CompiledExpression<T>::EQ);
 			break;
 		case Token::NE:
-			result = result != partial_value;
+			program_.append_op(CompiledExpression<T>::NE);
 			break;
 		default:
 			break;
@@ -166,22 +342,19 @@ void Expression<T>::eval_exp2(T &result) {
 // Desc: shifts
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp3(T &result) {
-	eval_exp4(result);
+void Expression<T>::eval_exp3() {
+	eval_exp4();
 
 	for(Token op = token_; op.operator_ == Token::RSHFT || op.operator_ == Token::LSHFT; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp4(partial_value);
+		eval_exp4();
 
-		// perform the shift operation
 		switch(op.operator_) {
 		case Token::LSHFT:
-			result <<= partial_value;
+			program_.append_op(CompiledExpression<T>::LSHFT);
 			break;
 		case Token::RSHFT:
-			result >>= partial_value;
+			program_.append_op(CompiledExpression<T>::RSHFT);
 			break;
 		default:
 			break;
@@ -194,30 +367,19 @@ void Expression<T>::eval_exp3(T &result) {
 // Desc: addition/subtraction
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp4(T &result) {
-	eval_exp5(result);
+void Expression<T>::eval_exp4() {
+	eval_exp5();
 
 	for(Token op = token_; op.operator_ == Token::PLUS || op.operator_ == Token::MINUS; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp5(partial_value);
+		eval_exp5();
 
-		// add or subtract
 		switch(op.operator_) {
 		case Token::PLUS:
-			result += partial_value;
+			program_.append_op(CompiledExpression<T>::ADD);
 			break;
 		case Token::MINUS:
-#ifdef _MSC_VER
-#pragma warning(push)
-/* disable warning about applying unary - to an unsigned type */
-#pragma warning(disable : 4146)
-#endif
-			result -= partial_value;
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
+			program_.append_op(CompiledExpression<T>::SUB);
 			break;
 		default:
 			break;
@@ -230,31 +392,22 @@ void Expression<T>::eval_exp4(T &result) {
 // Desc: multiplication/division
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp5(T &result) {
-	eval_exp6(result);
+void Expression<T>::eval_exp5() {
+	eval_exp6();
 
 	for(Token op = token_; op.operator_ == Token::MUL || op.operator_ == Token::DIV || op.operator_ == Token::MOD; op = token_) {
-		T partial_value;
-
 		get_token();
-		eval_exp6(partial_value);
+		eval_exp6();
 
-		// mul, div, or modulus
 		switch(op.operator_) {
 		case Token::MUL:
-			result *= partial_value;
+			program_.append_op(CompiledExpression<T>::MUL);
 			break;
 		case Token::DIV:
-			if(partial_value == 0) {
-				throw ExpressionError(ExpressionError::DIVIDE_BY_ZERO);
-			}
-			result /= partial_value;
+			program_.append_op(CompiledExpression<T>::DIV);
 			break;
 		case Token::MOD:
-			if(partial_value == 0) {
-				throw ExpressionError(ExpressionError::DIVIDE_BY_ZERO);
-			}
-			result %= partial_value;
+			program_.append_op(CompiledExpression<T>::MOD);
 			break;
 		default:
 			break;
@@ -267,36 +420,27 @@ void Expression<T>::eval_exp5(T &result) {
 // Desc: unary expressions
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp6(T &result) {
+void Expression<T>::eval_exp6() {
 
 	Token op = token_;
 	if(op.operator_ == Token::PLUS || op.operator_ == Token::MINUS || op.operator_ == Token::CMP || op.operator_ == Token::NOT) {
 		get_token();
 	}
 
-	eval_exp7(result);
+	eval_exp7();
 
 	switch(op.operator_) {
 	case Token::PLUS:
-		// this may seems like a waste, but unary + can be overloaded for a type
-		// to have a non-nop effect!
-		result = +result;
+		program_.append_op(CompiledExpression<T>::POS);
 		break;
 	case Token::MINUS:
-#ifdef _MSC_VER
-#pragma warning(push)
-#pragma warning(disable:4146)
-#endif
-		result = -result;
-#ifdef _MSC_VER
-#pragma warning(pop)
-#endif
+		program_.append_op(CompiledExpression<T>::NEG);
 		break;
 	case Token::CMP:
-		result = ~result;
+		program_.append_op(CompiledExpression<T>::CMP);
 		break;
 	case Token::NOT:
-		result = !result;
+		program_.append_op(CompiledExpression<T>::NOT);
 		break;
 	default:
 		break;
@@ -308,14 +452,14 @@ void Expression<T>::eval_exp6(T &result) {
 // Desc: sub-expressions
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_exp7(T &result) {
+void Expression<T>::eval_exp7() {
 
 	switch(token_.operator_) {
 	case Token::LPAREN:
 		get_token();
 
 		// get sub-expression
-		eval_exp0(result);
+		eval_exp0();
 
 		if(token_.operator_ != Token::RPAREN) {
 			throw ExpressionError(ExpressionError::UNBALANCED_PARENS);
@@ -327,37 +471,23 @@ void Expression<T>::eval_exp7(T &result) {
 		throw ExpressionError(ExpressionError::UNBALANCED_PARENS);
 		break;
 	case Token::LBRACE:
-		do {
-			get_token();
-
-			// get sub-expression
-			T effective_address;
-			eval_exp0(effective_address);
-
-			if(memory_reader_) {
-				bool ok;
-				ExpressionError error;
+		get_token();
 
-				result = memory_reader_(effective_address, &ok, &error);
-				if(!ok) {
-					throw error;
-				}
-			} else {
-				throw ExpressionError(ExpressionError::CANNOT_READ_MEMORY);
-			}
+		// get sub-expression, the effective address
+		eval_exp0();
+		program_.append_op(CompiledExpression<T>::LOAD);
 
-			if(token_.operator_ != Token::RBRACE) {
-				throw ExpressionError(ExpressionError::UNBALANCED_BRACES);
-			}
+		if(token_.operator_ != Token::RBRACE) {
+			throw ExpressionError(ExpressionError::UNBALANCED_BRACES);
+		}
 
-			get_token();
-		} while(0);
+		get_token();
 		break;
 	case Token::RBRACE:
 		throw ExpressionError(ExpressionError::UNBALANCED_BRACES);
 		break;
 	default:
-		eval_atom(result);
+		eval_atom();
 		break;
 
 	}
@@ -368,27 +498,30 @@ void Expression<T>::eval_exp7(T &result) {
 // Desc: atoms (variables/constants)
 //------------------------------------------------------------------------------
 template <class T>
-void Expression<T>::eval_atom(T &result) {
+void Expression<T>::eval_atom() {
 
 	switch(token_.type_) {
 	case Token::VARIABLE:
-		if(variable_reader_) {
-			bool ok;
-			ExpressionError error;
-			result = variable_reader_(token_.data_, &ok, &error);
-			if(!ok) {
-				throw error;
+		{
+			// each distinct name is only resolved once per evaluation
+			int index = program_.variables_.indexOf(token_.data_);
+			if(index == -1) {
+				index = program_.variables_.size();
+				program_.variables_.push_back(token_.data_);
 			}
-		} else {
-			throw ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
+			program_.append_op(CompiledExpression<T>::PUSH_VAR, index);
 		}
 		get_token();
 		break;
 	case Token::NUMBER:
-		bool ok;
-		result = token_.data_.toULongLong(&ok, 0);
-		if(!ok) {
-			throw ExpressionError(ExpressionError::INVALID_NUMBER);
+		{
+			bool ok;
+			const T value = token_.data_.toULongLong(&ok, 0);
+			if(!ok) {
+				throw ExpressionError(ExpressionError::INVALID_NUMBER);
+			}
+			program_.append_op(CompiledExpression<T>::PUSH_CONST, program_.constants_.size());
+			program_.constants_.push_back(value);
 		}
 		get_token();
 		break;
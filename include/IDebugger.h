@@ -26,8 +26,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QHash>
 #include <QMap>
 #include <QString>
+#include <QStringList>
 #include <QtPlugin>
+#include <array>
+#include <functional>
 #include <memory>
+#include <vector>
 
 class IDebugEvent;
 class IProcess;
@@ -39,6 +43,22 @@ class IDebugger {
 public:
 	typedef QHash<edb::address_t, std::shared_ptr<IBreakpoint>> BreakpointList;
 
+public:
+	// trace run support, see trace_run
+	static constexpr std::size_t MaxTraceRegisters = 4;
+
+	struct TraceEntry {
+		edb::address_t                                ip;
+		std::array<edb::reg_t, MaxTraceRegisters>     registers;
+	};
+
+	struct TraceOptions {
+		std::function<bool(const State &state)> stop_predicate; // return true to stop tracing
+		QStringList                             registers;      // general purpose registers to record, at most MaxTraceRegisters
+		std::size_t                             max_steps    = 0x1000; // per call, must not be 0. Long traces are run in chunks so the user can pause between them
+		std::size_t                             log_capacity = 0x10000; // the log carries over between calls unless this changes
+	};
+
 public:
 	virtual ~IDebugger() = default;
 
@@ -89,6 +109,7 @@ public:
 	virtual Status open(const QString &path, const QString &cwd, const QList<QByteArray> &args) = 0;
 	virtual Status open(const QString &path, const QString &cwd, const QList<QByteArray> &args, const QString &tty) = 0;
 	virtual std::shared_ptr<IDebugEvent> wait_debug_event(int msecs) = 0;
+	virtual int debug_event_fd() const = 0; // readable when wait_debug_event has something, -1 if unsupported
 	virtual Status detach() = 0;
 	virtual void kill() = 0;
 	virtual void end_debug_session() = 0;
@@ -105,6 +126,25 @@ public:
 	virtual void                         remove_breakpoint(edb::address_t address) = 0;
 	virtual std::vector<IBreakpoint::BreakpointType> supported_breakpoint_types() const = 0;
 
+	// breakpoint conditions are compiled with the addresses of the symbols they
+	// name, this forgets them so they are compiled again when next evaluated
+	virtual void                         clear_conditions() = 0;
+
+public:
+	// single steps the current thread in a tight loop inside the core, the
+	// resulting event (if any) is also delivered by the next wait_debug_event
+	virtual std::shared_ptr<IDebugEvent> trace_run(const TraceOptions &options) = 0;
+	virtual std::vector<TraceEntry>      trace_log() const = 0;
+	virtual void                         clear_trace_log() = 0;
+
+public:
+	// the debug registers every thread of the debuggee is meant to have, kept
+	// up to date by whoever sets hardware breakpoints. New threads are given
+	// a copy of them
+	using DebugRegisters = std::array<edb::reg_t, 8>;
+	virtual void           set_debug_registers(const DebugRegisters &registers) = 0;
+	virtual DebugRegisters debug_registers() const = 0;
+
 public:
 	virtual IState *create_state() const = 0;
 
@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "OSTypes.h"
 #include "Types.h"
 #include "Patch.h"
+#include "ReadSpan.h"
 #include "Status.h"
 #include <QList>
 #include <QMap>
@@ -62,6 +63,7 @@ public:
 	virtual std::size_t                      patch_bytes(edb::address_t address, const void *buf, size_t len) = 0;
 	virtual std::size_t                      read_bytes(edb::address_t address, void *buf, size_t len) const = 0;
 	virtual std::size_t                      read_pages(edb::address_t address, void *buf, size_t count) const = 0;
+	virtual std::size_t                      read_spans(ReadSpan *spans, size_t count) const = 0;
 	virtual Status                           pause() = 0;
 	virtual Status                           resume(edb::EVENT_STATUS status) = 0;
 	virtual Status                           step(edb::EVENT_STATUS status) = 0;
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "API.h"
 #include "Types.h"
+#include <functional>
 #include <memory>
 #include <QHash>
 #include <QList>
@@ -35,6 +36,13 @@ public:
 
 public:
 	virtual const QList<std::shared_ptr<Symbol>> symbols() const = 0;
+
+	// calls <f> with every symbol, or with every symbol whose address is in
+	// [start, end). Unlike symbols(), the symbols are not kept around, so
+	// prefer these for going over lots of them
+	virtual void for_each_symbol(const std::function<void(const Symbol &)> &f) const = 0;
+	virtual void for_each_symbol(edb::address_t start, edb::address_t end, const std::function<void(const Symbol &)> &f) const = 0;
+
 	virtual const std::shared_ptr<Symbol> find(const QString &name) const = 0;
 	virtual const std::shared_ptr<Symbol> find(edb::address_t address) const = 0;
 	virtual const std::shared_ptr<Symbol> find_near_symbol(edb::address_t address) const = 0;
@@ -23,7 +23,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Types.h"
 #include <QAbstractItemModel>
 #include <QList>
+#include <QVector>
 #include <memory>
+#include <vector>
 
 class IRegion;
 
@@ -45,12 +47,26 @@ public:
 
 public:
 	std::shared_ptr<IRegion> find_region(edb::address_t address) const;
+	QVector<std::shared_ptr<IRegion>> find_regions(const QVector<edb::address_t> &addresses) const;
 	const QList<std::shared_ptr<IRegion>> &regions() const { return regions_; }
 	void clear();
 	void sync();
 
+private:
+	int find_region_index(edb::address_t address) const;
+
+private:
+	struct RegionBounds {
+		edb::address_t start;
+		edb::address_t end;
+	};
+
 private:
 	QList<std::shared_ptr<IRegion>> regions_;
+
+	// the bounds of regions_ (which is kept sorted by start address), stored
+	// flat so that lookups can binary search them
+	std::vector<RegionBounds>       index_;
 };
 
 #endif
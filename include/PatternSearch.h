@@ -0,0 +1,123 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef PATTERN_SEARCH_20181021_H_
+#define PATTERN_SEARCH_20181021_H_
+
+#include "API.h"
+#include "Types.h"
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+class IRegion;
+
+namespace edb {
+
+// a byte sequence to search for, every byte has a mask so that single nibbles
+// or whole bytes may be wildcards
+class EDB_EXPORT BytePattern {
+public:
+	BytePattern() = default;
+	explicit BytePattern(const QByteArray &bytes);
+	BytePattern(const QByteArray &bytes, const QByteArray &masks);
+
+public:
+	// parses hex such as "48 8b ?? 4?", whitespace is ignored
+	static BytePattern from_string(const QString &text, bool *ok = nullptr);
+
+public:
+	int size() const            { return bytes_.size(); }
+	bool empty() const          { return bytes_.isEmpty(); }
+	quint8 byte(int n) const    { return static_cast<quint8>(bytes_[n]); }
+	quint8 mask(int n) const    { return static_cast<quint8>(masks_[n]); }
+	bool matches(const quint8 *p) const;
+
+private:
+	QByteArray bytes_; // with the wildcard bits cleared
+	QByteArray masks_;
+};
+
+struct SearchHit {
+	edb::address_t address;
+	int            pattern; // index into the patterns the search was made with
+};
+
+// Finds all occurrences of one or more patterns. A single pattern is located
+// by a vectorized scan for its literal bytes, several patterns are matched
+// in one pass with an Aho-Corasick automaton
+class EDB_EXPORT PatternSearch {
+public:
+	// receives the hits of each batch in address order along with the overall
+	// progress, returning false stops the search
+	using HitHandler = std::function<bool(const QVector<SearchHit> &hits, int percent)>;
+
+public:
+	explicit PatternSearch(const BytePattern &pattern, std::size_t alignment = 1);
+	explicit PatternSearch(const QVector<BytePattern> &patterns, std::size_t alignment = 1);
+
+public:
+	// searches <size> bytes at <data> which are a copy of memory at <address>,
+	// this is safe to call from several threads at once
+	QVector<SearchHit> search(const void *data, std::size_t size, edb::address_t address) const;
+
+	// searches the memory of the debuggee, the regions are read in bulk on
+	// the calling thread and searched in parallel, <handler> is also called
+	// on the calling thread
+	void search_regions(const QList<std::shared_ptr<IRegion>> &regions, const HitHandler &handler) const;
+
+public:
+	bool valid() const { return !patterns_.isEmpty(); }
+	const QVector<BytePattern> &patterns() const { return patterns_; }
+
+private:
+	void build_automaton();
+	void search_single(const quint8 *first, std::size_t size, edb::address_t address, QVector<SearchHit> *hits) const;
+	void search_multiple(const quint8 *first, std::size_t size, edb::address_t address, QVector<SearchHit> *hits) const;
+	void search_unanchored(const quint8 *first, std::size_t size, edb::address_t address, QVector<SearchHit> *hits) const;
+
+private:
+	// the longest run of fully specified bytes of a pattern, this is what
+	// candidates are found with before the whole pattern is compared
+	struct Literal {
+		int offset;
+		int length;
+	};
+
+	struct Node {
+		int          next[256];
+		int          fail;
+		QVector<int> outputs; // patterns whose literal ends here
+	};
+
+private:
+	QVector<BytePattern> patterns_;
+	QVector<Literal>     literals_;
+	QVector<int>         unanchored_; // patterns that are wildcards only
+	QVector<Node>        nodes_;
+	std::size_t          alignment_;
+	int                  max_size_ = 0;
+};
+
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+Copyright (C) 2017 - 2017 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef READ_SPAN_H_
+#define READ_SPAN_H_
+
+#include "OSTypes.h"
+#include <cstddef>
+
+// one element of a batched read, see IProcess::read_spans
+// <bytes_read> is filled in by the read, if it is less than <length>
+// only the first <bytes_read> bytes of <buffer> are defined
+struct ReadSpan {
+	edb::address_t address;
+	void          *buffer;
+	std::size_t    length;
+	std::size_t    bytes_read;
+};
+
+#endif
@@ -0,0 +1,93 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STRING_SEARCH_20181106_H_
+#define STRING_SEARCH_20181106_H_
+
+#include "API.h"
+#include "Types.h"
+#include <QList>
+#include <QString>
+#include <QVector>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+class IRegion;
+
+namespace edb {
+
+struct StringHit {
+	edb::address_t address;
+	int            length; // in characters, before escaping
+	bool           utf16;
+	QString        text;   // with C-style escapes, as get_ascii_string_at_address
+};
+
+// Finds the strings in a block of memory, that is runs of at least min_length
+// printable characters. ASCII strings are made of printable characters and
+// whitespace, UTF-16 strings of ASCII characters encoded as little endian
+// 16-bit units. The bytes are classified 16 at a time where SSE2 is available.
+// Each run is reported once, its text limited to max_length characters
+class EDB_EXPORT StringSearch {
+public:
+	// receives the hits of each batch in address order along with the overall
+	// progress, returning false stops the search
+	using HitHandler = std::function<bool(const QVector<StringHit> &hits, int percent)>;
+
+public:
+	StringSearch(int min_length, int max_length, bool utf16);
+
+public:
+	// searches <size> bytes at <data> which are a copy of memory at <address>,
+	// this is safe to call from several threads at once
+	QVector<StringHit> search(const void *data, std::size_t size, edb::address_t address) const;
+
+	// searches the memory of the debuggee, the regions are read in bulk on
+	// the calling thread and searched in parallel, <handler> is also called
+	// on the calling thread
+	void search_regions(const QList<std::shared_ptr<IRegion>> &regions, const HitHandler &handler) const;
+
+public:
+	bool valid() const { return min_length_ <= max_length_; }
+
+public:
+	// the character classification the search uses, applied to a single
+	// string at the start of the <size> bytes at <data>. string_length is how
+	// many characters long (at most max_length) it is, string_text is those
+	// characters as they are
+	static int string_length(const void *data, std::size_t size, int max_length, bool utf16);
+	static QString string_text(const void *data, int length, bool utf16);
+
+	// the C-style escapes the hits' text has
+	static QString escape_string(QString s);
+
+private:
+	void search_range(const quint8 *first, std::size_t size, std::size_t begin, std::size_t end, edb::address_t address, QVector<StringHit> *hits) const;
+	void search_ascii(const quint8 *first, std::size_t size, std::size_t begin, std::size_t end, edb::address_t address, QVector<StringHit> *hits) const;
+	void search_utf16(const quint8 *first, std::size_t size, std::size_t begin, std::size_t end, edb::address_t address, QVector<StringHit> *hits) const;
+
+private:
+	int  min_length_;
+	int  max_length_;
+	bool utf16_;
+};
+
+}
+
+#endif
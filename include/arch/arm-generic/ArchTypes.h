@@ -24,8 +24,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace edb {
 
-typedef CapstoneEDB::Instruction  Instruction;
-typedef CapstoneEDB::Operand      Operand;
+typedef CapstoneEDB::Instruction       Instruction;
+typedef CapstoneEDB::InstructionBuffer InstructionBuffer;
+typedef CapstoneEDB::Operand           Operand;
 
 }
 
@@ -24,9 +24,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace edb {
 
-typedef value16                   seg_reg_t;
-typedef CapstoneEDB::Instruction  Instruction;
-typedef CapstoneEDB::Operand      Operand;
+typedef value16                        seg_reg_t;
+typedef CapstoneEDB::Instruction       Instruction;
+typedef CapstoneEDB::InstructionBuffer InstructionBuffer;
+typedef CapstoneEDB::Operand           Operand;
 
 }
 
@@ -27,6 +27,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QPointer>
 #include <QStringList>
 #include <QVector>
+#include <functional>
 #include <memory>
 
 class ArchProcessor;
@@ -58,6 +59,7 @@ class Model;
 namespace edb {
 
 struct Prototype;
+struct StringHit;
 
 namespace v1 {
 
@@ -115,6 +117,9 @@ EDB_EXPORT bool get_binary_string_from_user(QByteArray &value, const QString &ti
 EDB_EXPORT bool get_ascii_string_at_address(address_t address, QString &s, int min_length, int max_length, int &found_length);
 EDB_EXPORT bool get_utf16_string_at_address(address_t address, QString &s, int min_length, int max_length, int &found_length);
 
+// the same for many addresses at once, which is much cheaper than asking for each one by itself
+EDB_EXPORT QVector<StringHit> get_strings_at_addresses(const QVector<address_t> &addresses, int min_length, int max_length);
+
 // Combination of get_ascii/utf16_at_address using current user configuration. May perform more analysis types in the future
 EDB_EXPORT bool get_human_string_at_address(address_t address, QString &s);
 
@@ -207,6 +212,16 @@ EDB_EXPORT int pointer_size();
 
 EDB_EXPORT QVector<quint8> read_pages(address_t address, size_t page_count);
 
+// a pointer aligned slot in memory and the value stored in it
+struct PointerRef {
+	address_t location;
+	address_t target;
+};
+
+// <progress> is told how much of the region has been scanned, in percent
+EDB_EXPORT QVector<PointerRef> find_pointers(const std::shared_ptr<IRegion> &region, address_t first, address_t last, const std::function<void(int)> &progress = nullptr);
+EDB_EXPORT QVector<PointerRef> find_pointers_to_bytes(const std::shared_ptr<IRegion> &region, const QByteArray &bytes, const std::function<void(int)> &progress = nullptr);
+
 EDB_EXPORT CapstoneEDB::Formatter &formatter();
 
 EDB_EXPORT bool debuggeeIs32Bit();
@@ -37,20 +37,26 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QCoreApplication>
 #include <QDir>
+#include <QFile>
 #include <QFileInfo>
 #include <QHash>
 #include <QMainWindow>
 #include <QMenu>
 #include <QMessageBox>
 #include <QProgressDialog>
+#include <QSaveFile>
 #include <QSettings>
 #include <QStack>
 #include <QTime>
 #include <QToolBar>
 #include <QtDebug>
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <cstring>
+#include <iterator>
+#include <numeric>
 
 #ifdef QT_CONCURRENT_LIB
 #include <QtConcurrent>
@@ -63,6 +69,230 @@ namespace {
 
 const int MIN_REFCOUNT = 2;
 
+// how many functions are handed to the thread pool at once, the results of a
+// batch are merged before the next one starts so that the workers always see
+// an up to date set of known functions
+const int FUNCTION_BATCH_SIZE = 256;
+
+// the part of a region which was successfully captured
+struct RegionImage {
+	edb::address_t start;
+	edb::address_t end;
+	const quint8  *memory;
+};
+
+// everything found while walking the basic blocks of a single function
+struct DiscoveredFunction {
+	edb::address_t                             entry;
+	QVector<QPair<edb::address_t, BasicBlock>> blocks;
+	QVector<edb::address_t>                    entries;    // call targets and far jumps, each of which may be a new function
+	QVector<edb::address_t>                    references; // jumps to functions which are already known
+};
+
+// the layout of a cached analysis on disk, all sections follow the header in
+// the order listed here. The file is mapped and used in place, so everything
+// is naturally aligned and in host byte order
+const char    ANALYSIS_MAGIC[8] = { 'E', 'D', 'B', 'A', 'N', 'L', 'Y', 'Z' };
+const quint32 ANALYSIS_VERSION  = 1;
+
+struct AnalysisHeader {
+	char    magic[8];
+	quint32 version;
+	quint32 fuzzy;
+	quint64 region_start;
+	quint64 region_size;
+	char    md5[16];       // of the region contents
+	char    marks_md5[16]; // of the user marked functions in the region
+	quint64 block_count;
+	quint64 ref_count;
+	quint64 function_count;
+	quint64 known_count;
+	quint64 fuzzy_count;
+	quint64 function_block_count;
+};
+
+struct AnalysisBlock {
+	quint64 address;
+	quint32 instruction_count;
+	quint32 ref_count; // refs are stored in block order
+};
+
+struct AnalysisRef {
+	quint64 site;
+	quint64 target;
+};
+
+struct AnalysisFunction {
+	quint64 entry;
+	quint32 block_count; // indexes into the block table, stored in function order
+	qint32  reference_count;
+	quint32 type;
+	quint32 reserved;
+};
+
+//------------------------------------------------------------------------------
+// Name: append
+// Desc: appends the raw bytes of a POD to a buffer
+//------------------------------------------------------------------------------
+template <class T>
+void append(QByteArray *buffer, const T &value) {
+	buffer->append(reinterpret_cast<const char *>(&value), sizeof(T));
+}
+
+//------------------------------------------------------------------------------
+// Name: copy_md5
+// Desc:
+//------------------------------------------------------------------------------
+void copy_md5(char (&dest)[16], const QByteArray &md5) {
+	std::memset(dest, 0, sizeof(dest));
+	std::memcpy(dest, md5.constData(), std::min<std::size_t>(sizeof(dest), md5.size()));
+}
+
+//------------------------------------------------------------------------------
+// Name: decode_block
+// Desc: rebuilds a basic block of <count> instructions at <address> from the
+//       captured copy of the region, returns false if it doesn't decode the
+//       same way anymore
+//------------------------------------------------------------------------------
+bool decode_block(const RegionImage &image, edb::address_t address, quint32 count, BasicBlock *block) {
+
+	const std::size_t max_size = edb::Instruction::MAX_SIZE;
+
+	for(quint32 i = 0; i < count; ++i) {
+		if(address < image.start || address >= image.end) {
+			return false;
+		}
+
+		const quint8 *const first = image.memory + static_cast<std::size_t>(address - image.start);
+		const quint8 *const last  = first + std::min<std::size_t>(max_size, image.end - address);
+
+		edb::Instruction decoded(first, last, address);
+		if(!decoded.valid()) {
+			return false;
+		}
+
+		auto inst = std::make_shared<edb::Instruction>(std::move(decoded));
+		block->push_back(inst);
+		address += inst->byte_size();
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: discover_function
+// Desc: walks the basic blocks reachable from <function_address>, decoding from
+//       the captured copy of the region
+// Note: this runs on worker threads, so it may only look at its arguments
+//------------------------------------------------------------------------------
+DiscoveredFunction discover_function(edb::address_t function_address, const RegionImage &image, const QSet<edb::address_t> &known_functions, const QSet<edb::address_t> &noreturn_functions) {
+
+	DiscoveredFunction result;
+	result.entry = function_address;
+
+	QSet<edb::address_t>   seen_blocks;
+	QStack<edb::address_t> blocks;
+	blocks.push(function_address);
+
+	// process are basic blocks that are known
+	while(!blocks.empty()) {
+
+		const edb::address_t block_address = blocks.pop();
+		edb::address_t address             = block_address;
+		BasicBlock     block;
+
+		if(seen_blocks.contains(block_address)) {
+			continue;
+		}
+
+		seen_blocks.insert(block_address);
+
+		while(address >= image.start && address < image.end) {
+
+			const std::size_t max_size  = edb::Instruction::MAX_SIZE;
+			const quint8 *const first = image.memory + static_cast<std::size_t>(address - image.start);
+			const quint8 *const last  = first + std::min<std::size_t>(max_size, image.end - address);
+
+			edb::Instruction decoded(first, last, address);
+			if(!decoded.valid()) {
+				break;
+			}
+
+			auto inst = std::make_shared<edb::Instruction>(std::move(decoded));
+			block.push_back(inst);
+
+			if(is_call(*inst)) {
+
+				// note the destination and move on
+				// we special case some simple things.
+				// also this is an opportunity to find call tables.
+				const auto op = inst->operand(0);
+				if(is_immediate(op)) {
+					const edb::address_t ea = op->imm;
+
+					// skip over ones which are: "call <label>; label:"
+					if(ea != address + inst->byte_size()) {
+						result.entries.push_back(ea);
+
+						if(noreturn_functions.contains(ea)) {
+							break;
+						}
+
+						block.addRef(address, ea);
+					}
+				}
+
+			} else if(is_unconditional_jump(*inst)) {
+
+				Q_ASSERT(inst->operand_count() >= 1);
+				const auto op = inst->operand(0);
+
+				// TODO(eteran): we need some heuristic for detecting when this is
+				//               a call/ret -> jmp optimization
+				if(is_immediate(op)) {
+					const edb::address_t ea = op->imm;
+
+					if(known_functions.contains(ea)) {
+						result.references.push_back(ea);
+					} else if((ea - function_address) > 0x2000u) {
+						result.entries.push_back(ea);
+					} else {
+						blocks.push(ea);
+					}
+
+					block.addRef(address, ea);
+				}
+				break;
+			} else if(is_conditional_jump(*inst)) {
+
+				Q_ASSERT(inst->operand_count() == 1);
+				const auto op = inst->operand(0);
+
+				if(is_immediate(op)) {
+
+					const edb::address_t ea = op->imm;
+
+					blocks.push(ea);
+					blocks.push(address + inst->byte_size());
+
+					block.addRef(address, ea);
+				}
+				break;
+			} else if(is_terminator(*inst)) {
+				break;
+			}
+
+			address += inst->byte_size();
+		}
+
+		if(!block.empty()) {
+			result.blocks.push_back(qMakePair(block_address, block));
+		}
+	}
+
+	return result;
+}
+
 //------------------------------------------------------------------------------
 // Name: module_entry_point
 // Desc:
@@ -77,6 +307,21 @@ edb::address_t module_entry_point(const std::shared_ptr<IRegion> &region) {
 	return entry;
 }
 
+//------------------------------------------------------------------------------
+// Name: is_noreturn
+// Desc: returns true if <sym> is a function which is known to never return
+//------------------------------------------------------------------------------
+bool is_noreturn(const Symbol &sym) {
+	const QString symname   = sym.name_no_prefix;
+	const QString func_name = symname.mid(0, symname.indexOf("@"));
+
+	if(const edb::Prototype *const info = edb::v1::get_function_info(func_name)) {
+		return info->noreturn;
+	}
+
+	return false;
+}
+
 }
 
 //------------------------------------------------------------------------------
@@ -325,16 +570,14 @@ void Analyzer::bonus_symbols(RegionData *data) {
 	Q_ASSERT(data);
 
 	// give bonus if we have a symbol for the address
-	const QList<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().symbols();
+	edb::v1::symbol_manager().for_each_symbol(data->region->start(), data->region->end(), [data](const Symbol &sym) {
+		const edb::address_t addr = sym.address;
 
-	for(const std::shared_ptr<Symbol> &sym: symbols) {
-		const edb::address_t addr = sym->address;
-
-		if(data->region->contains(addr) && sym->is_code()) {
-			qDebug("[Analyzer] adding: %s <%s>", qPrintable(sym->name), qPrintable(addr.toPointerString()));
+		if(sym.is_code()) {
+			qDebug("[Analyzer] adding: %s <%s>", qPrintable(sym.name), qPrintable(addr.toPointerString()));
 			data->known_functions.insert(addr);
 		}
-	}
+	});
 }
 
 //------------------------------------------------------------------------------
@@ -411,152 +654,133 @@ void Analyzer::ident_header(Analyzer::RegionData *data) {
 }
 
 //------------------------------------------------------------------------------
-// Name: analyze
-// Desc:
+// Name: noreturn_functions
+// Desc: the addresses of all symbols which are known to never return
+// Note: the symbol manager isn't thread safe, so this is gathered up front
+//       for the benefit of the worker threads
 //------------------------------------------------------------------------------
-void Analyzer::collect_functions(Analyzer::RegionData *data) {
+QSet<edb::address_t> Analyzer::noreturn_functions() const {
+
+	QSet<edb::address_t> ret;
+
+	edb::v1::symbol_manager().for_each_symbol([&ret](const Symbol &sym) {
+		if(sym.is_code() && is_noreturn(sym)) {
+			ret.insert(sym.address);
+		}
+	});
+
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: collect_functions
+// Desc: discovers the basic blocks of every known function and of every
+//       function found along the way. Functions are walked in parallel in
+//       batches, each batch is merged in address order so the result does not
+//       depend on the scheduling
+//------------------------------------------------------------------------------
+void Analyzer::collect_functions(Analyzer::RegionData *data, const std::function<void(int, int)> &progress) {
 	Q_ASSERT(data);
 
 	// results
 	QHash<edb::address_t, BasicBlock> basic_blocks;
 	FunctionMap                       functions;
 
-	// push all known functions onto a stack
-	QStack<edb::address_t> known_functions;
-	Q_FOREACH(const edb::address_t function, data->known_functions) {
-		known_functions.push(function);
-	}
+	RegionImage image;
+	image.start  = data->region->start();
+	image.end    = image.start + std::min<edb::address_t>(data->region->size(), data->memory.size());
+	image.memory = data->memory.constData();
 
-	// push all fuzzy function too...
-	Q_FOREACH(const edb::address_t function, data->fuzzy_functions) {
-		known_functions.push(function);
-	}
+	const QSet<edb::address_t> noreturn = noreturn_functions();
 
-	// process all functions that are known
-	while(!known_functions.empty()) {
-		const edb::address_t function_address = known_functions.pop();
+	// how many times each function was called or jumped to, the first of these
+	// is what creates the function, the rest are references to it
+	QHash<edb::address_t, int> pushes;
+	QHash<edb::address_t, int> references;
 
-		if(!functions.contains(function_address)) {
+	// every function which has been scheduled for analysis
+	QSet<edb::address_t> scheduled;
 
-			QStack<edb::address_t> blocks;
-			blocks.push(function_address);
+	QVector<edb::address_t> pending;
+	auto schedule = [&](edb::address_t function) {
+		++pushes[function];
+		if(!scheduled.contains(function)) {
+			scheduled.insert(function);
+			if(data->region->contains(function)) {
+				pending.push_back(function);
+			}
+		}
+	};
 
-			Function func;
+	// start with all known functions and the fuzzy ones too...
+	Q_FOREACH(const edb::address_t function, data->known_functions) {
+		schedule(function);
+	}
 
-			// process are basic blocks that are known
-			while(!blocks.empty()) {
+	Q_FOREACH(const edb::address_t function, data->fuzzy_functions) {
+		schedule(function);
+	}
 
-				const edb::address_t block_address = blocks.pop();
-				edb::address_t address             = block_address;
-				BasicBlock     block;
+	int functions_done = 0;
 
-				if(!basic_blocks.contains(block_address)) {
-					while(data->region->contains(address)) {
+	while(!pending.empty()) {
 
-						quint8 buffer[edb::Instruction::MAX_SIZE];
-						const int buf_size = edb::v1::get_instruction_bytes(address, buffer);
-						if(buf_size == 0) {
-							break;
-						}
+		QVector<edb::address_t> frontier;
+		qSwap(frontier, pending);
+		std::sort(frontier.begin(), frontier.end());
 
-						auto inst = std::make_shared<edb::Instruction>(buffer, buffer + buf_size, address);
-						if(!inst->valid()) {
-							break;
-						}
+		for(int i = 0; i < frontier.size(); i += FUNCTION_BATCH_SIZE) {
 
-						block.push_back(inst);
-
-						if(is_call(*inst)) {
-
-							// note the destination and move on
-							// we special case some simple things.
-							// also this is an opportunity to find call tables.
-							const auto op = inst->operand(0);
-							if(is_immediate(op)) {
-								const edb::address_t ea = op->imm;
-
-								// skip over ones which are: "call <label>; label:"
-								if(ea != address + inst->byte_size()) {
-									known_functions.push(ea);
-
-									if(!will_return(ea)) {
-										break;
-									}
-									
-									block.addRef(address, ea);
-									
-								}
-							} else if(is_expression(op)) {
-								// looks like: "call [...]", if it is of the form, call [C + REG]
-								// then it may be a jump table using REG as an offset
-							} else if(is_register(op)) {
-								// looks like: "call <reg>", this is this may be a callback
-								// if we can use analysis to determine that it's a constant
-								// we can figure it out...
-								// eventually, we should figure out the parameters of the function
-								// to see if we can know what the target is
-							}
+			const QVector<edb::address_t> batch = frontier.mid(i, FUNCTION_BATCH_SIZE);
 
+			const std::function<DiscoveredFunction(const edb::address_t &)> discover = [&image, &scheduled, &noreturn](const edb::address_t &function) {
+				return discover_function(function, image, scheduled, noreturn);
+			};
 
-						} else if(is_unconditional_jump(*inst)) {
+#if defined(QT_CONCURRENT_LIB)
+			const QVector<DiscoveredFunction> results = QtConcurrent::blockingMapped<QVector<DiscoveredFunction>>(batch, discover);
+#else
+			QVector<DiscoveredFunction> results;
+			std::transform(batch.begin(), batch.end(), std::back_inserter(results), discover);
+#endif
 
-							Q_ASSERT(inst->operand_count() >= 1);
-							const auto op = inst->operand(0);
+			for(const DiscoveredFunction &result : results) {
 
-							// TODO(eteran): we need some heuristic for detecting when this is
-							//               a call/ret -> jmp optimization
-							if(is_immediate(op)) {
-								const edb::address_t ea = op->imm;
+				Function func;
 
+				for(const QPair<edb::address_t, BasicBlock> &block : result.blocks) {
+					// a block belongs to the first function which reaches it
+					if(!basic_blocks.contains(block.first)) {
+						basic_blocks.insert(block.first, block.second);
 
-								if(functions.contains(ea)) {
-									functions[ea].add_reference();
-								} else if((ea - function_address) > 0x2000u) {
-									known_functions.push(ea);
-								} else {
-									blocks.push(ea);
-								}
-								
-								block.addRef(address, ea);
-							}
-							break;
-						} else if(is_conditional_jump(*inst)) {
-
-							Q_ASSERT(inst->operand_count() == 1);
-							const auto op = inst->operand(0);
-
-							if(is_immediate(op)) {
-							
-								const edb::address_t ea = op->imm;
-							
-								blocks.push(ea);
-								blocks.push(address + inst->byte_size());
-								
-								block.addRef(address, ea);
-							}
-							break;
-						} else if(is_terminator(*inst)) {
-							break;
+						if(block.first >= result.entry) {
+							func.insert(block.second);
 						}
-
-						address += inst->byte_size();
 					}
+				}
 
-					if(!block.empty()) {
-						basic_blocks.insert(block_address, block);
+				if(!func.empty()) {
+					functions.insert(result.entry, func);
+				}
 
-						if(block_address >= function_address) {
-							func.insert(block);
-						}
-					}
+				for(const edb::address_t ea : result.entries) {
+					schedule(ea);
 				}
-			}
 
-			if(!func.empty()) {
-				functions.insert(function_address, func);
+				for(const edb::address_t ea : result.references) {
+					++references[ea];
+				}
 			}
-		} else {
-			functions[function_address].add_reference();
+
+			functions_done += batch.size();
+			progress(functions_done, functions_done + pending.size() + (frontier.size() - i - batch.size()));
+		}
+	}
+
+	for(auto it = functions.begin(); it != functions.end(); ++it) {
+		const int count = pushes.value(it.key()) - 1 + references.value(it.key());
+		for(int i = 0; i < count; ++i) {
+			it.value().add_reference();
 		}
 	}
 
@@ -593,9 +817,12 @@ void Analyzer::collect_fuzzy_functions(RegionData *data) {
 		quint8 *const last  = &first[data->memory.size()];
 		quint8 *p           = first;
 
+		// this decodes at every single byte, so reuse the same storage for all of them
+		edb::InstructionBuffer buffer;
+
 		// fuzzy_functions, known_functions
 		for(edb::address_t addr = data->region->start(); addr != data->region->end(); ++addr) {
-			const edb::Instruction inst(p, last, addr);
+			const edb::Instruction inst(buffer, p, last, addr);
 			if(inst) {
 				if(is_call(inst)) {
 
@@ -664,6 +891,30 @@ void Analyzer::analyze(const std::shared_ptr<IRegion> &region) {
 		region_data.md5    = md5;
 		region_data.fuzzy  = fuzzy;
 
+		const QString    cache_path = md5.isEmpty() ? QString() : get_analysis_path(region);
+		const QByteArray marks_md5  = marked_functions_md5(region);
+
+		if(!cache_path.isEmpty() && load_analysis(&region_data, cache_path, marks_md5)) {
+			qDebug("[Analyzer] loaded cached analysis from %s", qPrintable(cache_path));
+			Q_EMIT update_progress(100);
+
+			if(analyzer_widget_) {
+				analyzer_widget_->update();
+			}
+
+			qDebug("[Analyzer] elapsed: %d ms", t.elapsed());
+			return;
+		}
+
+		// lets the long running steps report how far along they are
+		int current_step = 0;
+		int step_count   = 1;
+		const std::function<void(int, int)> step_progress = [this, &current_step, &step_count](int done, int total) {
+			if(total != 0) {
+				Q_EMIT update_progress(util::percentage(current_step, step_count, done, total));
+			}
+		};
+
 		const struct {
 			const char             *message;
 			std::function<void()> function;
@@ -674,13 +925,15 @@ void Analyzer::analyze(const std::shared_ptr<IRegion> &region) {
 			{ "attempting to add functions with symbols to the list...", [this, &region_data]() { bonus_symbols(&region_data);           } },
 			{ "attempting to add marked functions to the list...",       [this, &region_data]() { bonus_marked_functions(&region_data);  } },
 			{ "attempting to collect functions with fuzzy analysis...",  [this, &region_data]() { collect_fuzzy_functions(&region_data); } },
-			{ "collecting basic blocks...",                              [this, &region_data]() { collect_functions(&region_data);       } },
+			{ "collecting basic blocks...",                              [this, &region_data, &step_progress]() { collect_functions(&region_data, step_progress); } },
 		};
 
 		const int total_steps = sizeof(analysis_steps) / sizeof(analysis_steps[0]);
+		step_count = total_steps;
 
 		Q_EMIT update_progress(util::percentage(0, total_steps));
 		for(int i = 0; i < total_steps; ++i) {
+			current_step = i;
 			qDebug("[Analyzer] %s", analysis_steps[i].message);
 			analysis_steps[i].function();
 			Q_EMIT update_progress(util::percentage(i + 1, total_steps));
@@ -690,6 +943,10 @@ void Analyzer::analyze(const std::shared_ptr<IRegion> &region) {
 
 		set_function_types(&region_data.functions);
 
+		if(!cache_path.isEmpty()) {
+			save_analysis(region_data, cache_path, marks_md5);
+		}
+
 		qDebug("[Analyzer] complete");
 		Q_EMIT update_progress(100);
 
@@ -896,18 +1153,294 @@ Result<edb::address_t> Analyzer::find_containing_function(edb::address_t address
 bool Analyzer::will_return(edb::address_t address) const {
 
 	const std::shared_ptr<Symbol> symbol = edb::v1::symbol_manager().find(address);
-	if(symbol) {
-		const QString symname = symbol->name_no_prefix;
-		const QString func_name = symname.mid(0, symname.indexOf("@"));
-		
-		if(const edb::Prototype *const info = edb::v1::get_function_info(func_name)) {
-			if(info->noreturn) {
+	if(symbol && is_noreturn(*symbol)) {
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: marked_functions_md5
+// Desc: a hash of the user marked functions which are in <region>, these feed
+//       into the analysis so a cached analysis is only valid for the same set
+//------------------------------------------------------------------------------
+QByteArray Analyzer::marked_functions_md5(const std::shared_ptr<IRegion> &region) const {
+
+	std::vector<quint64> marks;
+	Q_FOREACH(const edb::address_t addr, specified_functions_) {
+		if(region->contains(addr)) {
+			marks.push_back(addr);
+		}
+	}
+
+	std::sort(marks.begin(), marks.end());
+	return edb::v1::get_md5(marks.data(), marks.size() * sizeof(quint64));
+}
+
+//------------------------------------------------------------------------------
+// Name: save_analysis
+// Desc: writes the analysis of a region to <path> so that a later session can
+//       skip analyzing the same module again, see load_analysis
+//------------------------------------------------------------------------------
+void Analyzer::save_analysis(const RegionData &data, const QString &path, const QByteArray &marks_md5) const {
+
+	QList<edb::address_t> block_addresses = data.basic_blocks.keys();
+	std::sort(block_addresses.begin(), block_addresses.end());
+
+	QHash<edb::address_t, quint32> block_index;
+	block_index.reserve(block_addresses.size());
+
+	QByteArray blocks;
+	QByteArray refs;
+	quint64    ref_count = 0;
+
+	for(const edb::address_t address : block_addresses) {
+		const BasicBlock &bb = data.basic_blocks[address];
+		const QVector<QPair<edb::address_t, edb::address_t>> block_refs = bb.refs();
+
+		AnalysisBlock block;
+		block.address           = address;
+		block.instruction_count = static_cast<quint32>(bb.size());
+		block.ref_count         = static_cast<quint32>(block_refs.size());
+		append(&blocks, block);
+
+		for(const QPair<edb::address_t, edb::address_t> &r : block_refs) {
+			AnalysisRef ref;
+			ref.site   = r.first;
+			ref.target = r.second;
+			append(&refs, ref);
+		}
+
+		ref_count += block_refs.size();
+		block_index.insert(address, block_index.size());
+	}
+
+	QByteArray functions;
+	QByteArray function_blocks;
+	quint64    function_block_count = 0;
+
+	for(auto it = data.functions.begin(); it != data.functions.end(); ++it) {
+		const Function &function = it.value();
+
+		AnalysisFunction func;
+		func.entry           = it.key();
+		func.block_count     = 0;
+		func.reference_count = function.reference_count();
+		func.type            = function.type();
+		func.reserved        = 0;
+
+		for(const BasicBlock &bb : function) {
+			auto index = block_index.find(bb.firstAddress());
+			if(index != block_index.end()) {
+				append(&function_blocks, index.value());
+				++func.block_count;
+			}
+		}
+
+		function_block_count += func.block_count;
+		append(&functions, func);
+	}
+
+	QByteArray known;
+	Q_FOREACH(const edb::address_t address, data.known_functions) {
+		append(&known, static_cast<quint64>(address));
+	}
+
+	QByteArray fuzzy;
+	Q_FOREACH(const edb::address_t address, data.fuzzy_functions) {
+		append(&fuzzy, static_cast<quint64>(address));
+	}
+
+	AnalysisHeader header;
+	std::memcpy(header.magic, ANALYSIS_MAGIC, sizeof(header.magic));
+	header.version              = ANALYSIS_VERSION;
+	header.fuzzy                = data.fuzzy;
+	header.region_start         = data.region->start();
+	header.region_size          = data.region->size();
+	copy_md5(header.md5, data.md5);
+	copy_md5(header.marks_md5, marks_md5);
+	header.block_count          = block_addresses.size();
+	header.ref_count            = ref_count;
+	header.function_count       = data.functions.size();
+	header.known_count          = data.known_functions.size();
+	header.fuzzy_count          = data.fuzzy_functions.size();
+	header.function_block_count = function_block_count;
+
+	QSaveFile file(path);
+	if(!file.open(QIODevice::WriteOnly)) {
+		qDebug("[Analyzer] unable to write analysis cache %s", qPrintable(path));
+		return;
+	}
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(blocks);
+	file.write(refs);
+	file.write(functions);
+	file.write(known);
+	file.write(fuzzy);
+	file.write(function_blocks);
+
+	if(!file.commit()) {
+		qDebug("[Analyzer] unable to write analysis cache %s", qPrintable(path));
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: load_analysis
+// Desc: restores the analysis of a region saved by save_analysis, returns false
+//       if there is none or it is stale
+// Note: instructions aren't stored, the basic blocks are decoded again from the
+//       region image, which is a small fraction of the cost of analyzing
+//------------------------------------------------------------------------------
+bool Analyzer::load_analysis(RegionData *data, const QString &path, const QByteArray &marks_md5) const {
+
+	Q_ASSERT(data);
+
+	QFile file(path);
+	if(!file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	const qint64 size = file.size();
+	if(size < static_cast<qint64>(sizeof(AnalysisHeader))) {
+		return false;
+	}
+
+	const uchar *const map = file.map(0, size);
+	if(!map) {
+		return false;
+	}
+
+	auto header = reinterpret_cast<const AnalysisHeader *>(map);
+
+	char md5[16];
+	char marks[16];
+	copy_md5(md5, data->md5);
+	copy_md5(marks, marks_md5);
+
+	if(std::memcmp(header->magic, ANALYSIS_MAGIC, sizeof(header->magic)) != 0 ||
+		header->version != ANALYSIS_VERSION ||
+		header->fuzzy != static_cast<quint32>(data->fuzzy) ||
+		data->region->start() != header->region_start ||
+		data->region->size() != header->region_size ||
+		std::memcmp(header->md5, md5, sizeof(md5)) != 0 ||
+		std::memcmp(header->marks_md5, marks, sizeof(marks)) != 0) {
+		qDebug("[Analyzer] cached analysis %s is stale", qPrintable(path));
+		return false;
+	}
+
+	const quint64 expected_size = sizeof(AnalysisHeader) +
+		header->block_count          * sizeof(AnalysisBlock) +
+		header->ref_count            * sizeof(AnalysisRef) +
+		header->function_count       * sizeof(AnalysisFunction) +
+		header->known_count          * sizeof(quint64) +
+		header->fuzzy_count          * sizeof(quint64) +
+		header->function_block_count * sizeof(quint32);
+
+	if(expected_size != static_cast<quint64>(size)) {
+		return false;
+	}
+
+	auto blocks          = reinterpret_cast<const AnalysisBlock *>(header + 1);
+	auto refs            = reinterpret_cast<const AnalysisRef *>(blocks + header->block_count);
+	auto functions       = reinterpret_cast<const AnalysisFunction *>(refs + header->ref_count);
+	auto known           = reinterpret_cast<const quint64 *>(functions + header->function_count);
+	auto fuzzy           = known + header->known_count;
+	auto function_blocks = reinterpret_cast<const quint32 *>(fuzzy + header->fuzzy_count);
+
+	// where the refs of each block start
+	std::vector<quint64> ref_offsets(header->block_count);
+	quint64 ref_offset = 0;
+	for(quint64 i = 0; i < header->block_count; ++i) {
+		ref_offsets[i] = ref_offset;
+		ref_offset += blocks[i].ref_count;
+	}
+
+	if(ref_offset != header->ref_count) {
+		return false;
+	}
+
+	RegionImage image;
+	image.start  = data->region->start();
+	image.end    = image.start + std::min<edb::address_t>(data->region->size(), data->memory.size());
+	image.memory = data->memory.constData();
+
+	QVector<quint64> indexes(header->block_count);
+	std::iota(indexes.begin(), indexes.end(), 0);
+
+	std::atomic<bool> corrupt(false);
+	const std::function<BasicBlock(const quint64 &)> rebuild = [&](const quint64 &index) {
+		BasicBlock bb;
+		if(!decode_block(image, blocks[index].address, blocks[index].instruction_count, &bb)) {
+			corrupt = true;
+		}
+
+		for(quint32 i = 0; i < blocks[index].ref_count; ++i) {
+			const AnalysisRef &ref = refs[ref_offsets[index] + i];
+			bb.addRef(ref.site, ref.target);
+		}
+		return bb;
+	};
+
+#if defined(QT_CONCURRENT_LIB)
+	const QVector<BasicBlock> decoded = QtConcurrent::blockingMapped<QVector<BasicBlock>>(indexes, rebuild);
+#else
+	QVector<BasicBlock> decoded;
+	std::transform(indexes.begin(), indexes.end(), std::back_inserter(decoded), rebuild);
+#endif
+
+	if(corrupt) {
+		qDebug("[Analyzer] cached analysis %s does not match the region", qPrintable(path));
+		return false;
+	}
+
+	QHash<edb::address_t, BasicBlock> basic_blocks;
+	basic_blocks.reserve(decoded.size());
+	for(quint64 i = 0; i < header->block_count; ++i) {
+		basic_blocks.insert(blocks[i].address, decoded[i]);
+	}
+
+	FunctionMap results;
+	quint64 function_block = 0;
+	for(quint64 i = 0; i < header->function_count; ++i) {
+		const AnalysisFunction &func = functions[i];
+
+		if(function_block + func.block_count > header->function_block_count) {
+			return false;
+		}
+
+		Function function;
+		for(quint32 j = 0; j < func.block_count; ++j) {
+			const quint32 index = function_blocks[function_block++];
+			if(index >= header->block_count) {
 				return false;
 			}
+			function.insert(decoded[index]);
 		}
+
+		for(qint32 j = 0; j < func.reference_count; ++j) {
+			function.add_reference();
+		}
+
+		function.set_type(static_cast<Function::Type>(func.type));
+		results.insert(func.entry, function);
 	}
 
+	QSet<edb::address_t> known_functions;
+	for(quint64 i = 0; i < header->known_count; ++i) {
+		known_functions.insert(known[i]);
+	}
 
+	QSet<edb::address_t> fuzzy_functions;
+	for(quint64 i = 0; i < header->fuzzy_count; ++i) {
+		fuzzy_functions.insert(fuzzy[i]);
+	}
+
+	qSwap(data->basic_blocks, basic_blocks);
+	qSwap(data->functions, results);
+	qSwap(data->known_functions, known_functions);
+	qSwap(data->fuzzy_functions, fuzzy_functions);
 	return true;
 }
 
@@ -77,7 +77,7 @@ private:
 	void bonus_main(RegionData *data) const;
 	void bonus_marked_functions(RegionData *data);
 	void bonus_symbols(RegionData *data);
-	void collect_functions(RegionData *data);
+	void collect_functions(RegionData *data, const std::function<void(int, int)> &progress);
 	void collect_fuzzy_functions(RegionData *data);
 	void do_analysis(const std::shared_ptr<IRegion> &region);
 	void ident_header(Analyzer::RegionData *data);
@@ -85,6 +85,10 @@ private:
 	void set_function_types(FunctionMap *results);
 	void set_function_types_helper(Function &function) const;
 	QString get_analysis_path(const std::shared_ptr<IRegion> &region) const;
+	QSet<edb::address_t> noreturn_functions() const;
+	QByteArray marked_functions_md5(const std::shared_ptr<IRegion> &region) const;
+	bool load_analysis(RegionData *data, const QString &path, const QByteArray &marks_md5) const;
+	void save_analysis(const RegionData &data, const QString &path, const QByteArray &marks_md5) const;
 
 Q_SIGNALS:
 	void update_progress(int);
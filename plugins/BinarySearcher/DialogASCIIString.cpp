@@ -24,10 +24,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IThread.h"
 #include "MemoryRegions.h"
 #include "State.h"
-#include "Util.h"
 #include <QMessageBox>
 #include <QVector>
-#include <cstring>
 
 #include "ui_DialogASCIIString.h"
 
@@ -72,31 +70,19 @@ void DialogASCIIString::do_find() {
 
 				State state;
 				thread->get_state(&state);
-				edb::address_t stack_ptr = state.stack_pointer();
+				const edb::address_t stack_ptr = state.stack_pointer();
 
 				if(std::shared_ptr<IRegion> region = edb::v1::memory_regions().find_region(stack_ptr)) {
 
-					edb::address_t count = (region->end() - stack_ptr) / edb::v1::pointer_size();
-					stack_ptr = region->start();
-
 					try {
-						QVector<quint8> chars(sz);
-
-						int i = 0;
-						while(stack_ptr < region->end()) {
-							// get the value from the stack
-							edb::address_t value(0);
-							if(process->read_bytes(stack_ptr, &value, edb::v1::pointer_size())) {
-								if(process->read_bytes(value, &chars[0], sz)) {
-									if(std::memcmp(&chars[0], b.constData(), sz) == 0) {
-										auto item = new QListWidgetItem(edb::v1::format_pointer(stack_ptr));
-										item->setData(Qt::UserRole, stack_ptr);
-										ui->listWidget->addItem(item);
-									}
-								}
-							}
-							ui->progressBar->setValue(util::percentage(i++, count));
-							stack_ptr += edb::v1::pointer_size();
+						const QVector<edb::v1::PointerRef> pointers = edb::v1::find_pointers_to_bytes(region, b, [this](int percent) {
+							ui->progressBar->setValue(percent);
+						});
+
+						for(const edb::v1::PointerRef &pointer : pointers) {
+							auto item = new QListWidgetItem(edb::v1::format_pointer(pointer.location));
+							item->setData(Qt::UserRole, static_cast<qulonglong>(pointer.location));
+							ui->listWidget->addItem(item);
 						}
 					} catch(const std::bad_alloc &) {
 						QMessageBox::critical(0, tr("Memroy Allocation Error"),
@@ -21,10 +21,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IDebugger.h"
 #include "IRegion.h"
 #include "MemoryRegions.h"
-#include "Util.h"
+#include "PatternSearch.h"
 #include <QMessageBox>
 #include <QVector>
-#include <cstring>
+#include <algorithm>
 
 #include "ui_DialogBinaryString.h"
 
@@ -60,53 +60,33 @@ void DialogBinaryString::do_find() {
 	const QByteArray b = ui->binaryString->value();
 	ui->listWidget->clear();
 
-	const int sz = b.size();
-	if(sz != 0) {
+	if(!b.isEmpty()) {
 		edb::v1::memory_regions().sync();
-		const QList<std::shared_ptr<IRegion>> regions = edb::v1::memory_regions().regions();
-		const edb::address_t page_size = edb::v1::debugger_core->page_size();
 
-		int i = 0;
-		for(const std::shared_ptr<IRegion> &region: regions) {
-			const auto region_size = region->size();
+		QList<std::shared_ptr<IRegion>> regions = edb::v1::memory_regions().regions();
 
-			// a short circut for speading things up
-			if(ui->chkSkipNoAccess->isChecked() && !region->accessible()) {
-				ui->progressBar->setValue(util::percentage(++i, regions.size()));
-				continue;
-			}
-
-			const size_t page_count     = region_size / page_size;
-			const QVector<quint8> pages = edb::v1::read_pages(region->start(), page_count);
-
-			if(!pages.isEmpty()) {
-
-				const quint8 *p = &pages[0];
-				const quint8 *const pages_end = &pages[0] + region_size - sz;
-
-				while(p < pages_end) {
-					// compare values..
-					if(std::memcmp(p, b.constData(), sz) == 0) {
-						const edb::address_t addr = p - &pages[0] + region->start();
-						const edb::address_t align = 1 << (ui->cmbAlignment->currentIndex() + 1);
+		// a short circut for speading things up
+		if(ui->chkSkipNoAccess->isChecked()) {
+			regions.erase(std::remove_if(regions.begin(), regions.end(), [](const std::shared_ptr<IRegion> &region) {
+				return !region->accessible();
+			}), regions.end());
+		}
 
-						if(!ui->chkAlignment->isChecked() || (addr % align) == 0) {
-							auto item = new QListWidgetItem(edb::v1::format_pointer(addr));
-							item->setData(Qt::UserRole, addr);
-							ui->listWidget->addItem(item);
-						}
-					}
+		const std::size_t align = ui->chkAlignment->isChecked() ? (1u << (ui->cmbAlignment->currentIndex() + 1)) : 1u;
 
-					// update progress bar every 64KB
-					if ((quint64(p) & 0xFFFF) == 0) {
-						ui->progressBar->setValue(util::percentage(i, regions.size(), p - &pages[0], region_size));
-					}
+		const edb::PatternSearch search(edb::BytePattern(b), align);
 
-					++p;
-				}
+		// hits arrive a batch at a time
+		search.search_regions(regions, [this](const QVector<edb::SearchHit> &hits, int percent) {
+			for(const edb::SearchHit &hit : hits) {
+				auto item = new QListWidgetItem(edb::v1::format_pointer(hit.address));
+				item->setData(Qt::UserRole, static_cast<qulonglong>(hit.address));
+				ui->listWidget->addItem(item);
 			}
-			++i;
-		}
+
+			ui->progressBar->setValue(percent);
+			return true;
+		});
 	}
 }
 
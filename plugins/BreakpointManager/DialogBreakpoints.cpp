@@ -159,12 +159,11 @@ void DialogBreakpoints::on_btnAddFunction_clicked() {
     bool ok;
     const QString text = QInputDialog::getText(this, tr("Add Breakpoint On Library Function"), tr("Function Name:"), QLineEdit::Normal, QString(), &ok);
 	if(ok && !text.isEmpty()) {
-		const QList<std::shared_ptr<Symbol>> syms = edb::v1::symbol_manager().symbols();
-		for(const std::shared_ptr<Symbol> &current: syms) {
+		edb::v1::symbol_manager().for_each_symbol([&text](const Symbol &current) {
 			if(current.name_no_prefix == text) {
 				edb::v1::create_breakpoint(current.address);
 			}
-		}
+		});
 		updateList();
 	}
 }
@@ -0,0 +1,74 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef BREAKPOINT_INDEX_20181112_H_
+#define BREAKPOINT_INDEX_20181112_H_
+
+#include "Types.h"
+#include <QMap>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace DebuggerCorePlugin {
+
+// Breakpoints ordered by address. Every memory read asks which breakpoints it
+// has to hide, so finding the ones in a range costs a lookup plus the number
+// of matches rather than a walk over every breakpoint. <BP> is anything with
+// address() and size(), no breakpoint may be larger than <MaxSize> bytes
+template <class BP, std::size_t MaxSize>
+class BreakpointIndex {
+public:
+	void insert(edb::address_t address, const std::shared_ptr<BP> &bp) { index_[address] = bp; }
+	void remove(edb::address_t address)                                { index_.remove(address); }
+	void clear()                                                       { index_.clear(); }
+	bool empty() const                                                 { return index_.isEmpty(); }
+	std::size_t size() const                                           { return index_.size(); }
+
+public:
+	// the breakpoints which cover any of the <len> bytes starting at
+	// <address>, in address order
+	std::vector<std::shared_ptr<BP>> overlapping(edb::address_t address, std::size_t len) const {
+
+		std::vector<std::shared_ptr<BP>> ret;
+
+		if(len == 0 || index_.isEmpty()) {
+			return ret;
+		}
+
+		// a breakpoint starting a little before <address> may still reach into it
+		const edb::address_t first = (address >= MaxSize) ? address - (MaxSize - 1) : edb::address_t(0);
+		const edb::address_t last  = address + (len - 1);
+
+		for(auto it = index_.lowerBound(first); it != index_.end() && it.key() <= last; ++it) {
+			const std::shared_ptr<BP> &bp = it.value();
+			if(bp->address() + bp->size() > address) {
+				ret.push_back(bp);
+			}
+		}
+
+		return ret;
+	}
+
+private:
+	QMap<edb::address_t, std::shared_ptr<BP>> index_;
+};
+
+}
+
+#endif
@@ -19,11 +19,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "DebuggerCoreBase.h"
 #include "Breakpoint.h"
 #include "Configuration.h"
+#include "Expression.h"
+#include "IProcess.h"
+#include "ISymbolManager.h"
+#include "Register.h"
+#include "State.h"
+#include "Symbol.h"
 #include "edb.h"
 #include <QtDebug>
 
 namespace DebuggerCorePlugin {
 
+struct DebuggerCoreBase::CompiledCondition {
+	enum OperandType {
+		Unresolved,
+		Register,
+		Constant
+	};
+
+	struct Operand {
+		OperandType    type = Unresolved;
+		QString        name;  // the register to read when type is Register
+		edb::address_t value; // the symbol address when type is Constant
+	};
+
+	CompiledExpression<edb::address_t> program;
+	std::vector<Operand>               operands;
+};
+
 //------------------------------------------------------------------------------
 // Name: DebuggerCoreBase
 // Desc: constructor
@@ -45,9 +68,20 @@ DebuggerCoreBase::~DebuggerCoreBase() {
 void DebuggerCoreBase::clear_breakpoints() {
 	if(attached()) {
 		breakpoints_.clear();
+		breakpoint_index_.clear();
+		conditions_.clear();
 	}
 }
 
+//------------------------------------------------------------------------------
+// Name: clear_conditions
+// Desc: forgets the compiled breakpoint conditions, the symbol addresses they
+//       hold are only good for the symbols they were compiled against
+//------------------------------------------------------------------------------
+void DebuggerCoreBase::clear_conditions() {
+	conditions_.clear();
+}
+
 //------------------------------------------------------------------------------
 // Name: add_breakpoint
 // Desc: creates a new breakpoint
@@ -60,6 +94,7 @@ std::shared_ptr<IBreakpoint> DebuggerCoreBase::add_breakpoint(edb::address_t add
 			if(!find_breakpoint(address)) {
 				auto bp = std::make_shared<Breakpoint>(address);
 				breakpoints_[address] = bp;
+				breakpoint_index_.insert(address, bp);
 				return bp;
 			}
 		}
@@ -120,6 +155,7 @@ void DebuggerCoreBase::remove_breakpoint(edb::address_t address) {
 		if(it != breakpoints_.end()) {
 			breakpoints_.erase(it);
 		}
+		breakpoint_index_.remove(address);
 	}
 }
 
@@ -181,8 +217,161 @@ bool DebuggerCoreBase::attached() const {
 	return pid() != 0;
 }
 
+//------------------------------------------------------------------------------
+// Name: overlapping_breakpoints
+// Desc: returns the breakpoints which cover any of the <len> bytes starting
+//       at <address>, in address order
+// Note: cost is proportional to the number of matching breakpoints, not the
+//       total number of breakpoints
+//------------------------------------------------------------------------------
+std::vector<std::shared_ptr<IBreakpoint>> DebuggerCoreBase::overlapping_breakpoints(edb::address_t address, std::size_t len) const {
+	return breakpoint_index_.overlapping(address, len);
+}
+
+//------------------------------------------------------------------------------
+// Name: evaluate_condition
+// Desc: evaluates a breakpoint condition against <state>, returns false if the
+//       condition could not be evaluated
+// Note: each condition is parsed once and each of its variables is looked up
+//       once, so a breakpoint which is hit often only pays for running the
+//       compiled program
+//------------------------------------------------------------------------------
+bool DebuggerCoreBase::evaluate_condition(const QString &condition, const State &state, bool *value) {
+
+	Q_ASSERT(value);
+
+	std::shared_ptr<CompiledCondition> &compiled = conditions_[condition];
+	if(!compiled) {
+		bool ok;
+		ExpressionError error;
+		Expression<edb::address_t> expr(condition, nullptr, nullptr);
+
+		auto program = expr.compile(&ok, &error);
+		if(!ok) {
+			conditions_.remove(condition);
+			return false;
+		}
+
+		compiled = std::make_shared<CompiledCondition>();
+		compiled->program = program;
+		compiled->operands.resize(program.variables().size());
+	}
+
+	std::vector<CompiledCondition::Operand> &operands = compiled->operands;
+	const QStringList &names = compiled->program.variables();
+
+	// registers are preferred over symbols of the same name, just like the
+	// expression dialog does it
+	for(std::size_t i = 0; i < operands.size(); ++i) {
+		CompiledCondition::Operand &operand = operands[i];
+		if(operand.type != CompiledCondition::Unresolved) {
+			continue;
+		}
+
+		const Register reg = state.value(names[i]);
+		if(reg.valid()) {
+			operand.type = CompiledCondition::Register;
+			if(reg.name() == "fs") {
+				operand.name = QLatin1String("fs_base");
+			} else if(reg.name() == "gs") {
+				operand.name = QLatin1String("gs_base");
+			} else {
+				operand.name = names[i];
+			}
+		} else if(const std::shared_ptr<Symbol> sym = edb::v1::symbol_manager().find(names[i])) {
+			operand.type  = CompiledCondition::Constant;
+			operand.value = sym->address;
+		}
+	}
+
+	auto read_variable = [&operands, &state](std::size_t index, bool *ok, ExpressionError *error) -> edb::address_t {
+		const CompiledCondition::Operand &operand = operands[index];
+		switch(operand.type) {
+		case CompiledCondition::Register:
+			*ok = true;
+			return state[operand.name].valueAsAddress();
+		case CompiledCondition::Constant:
+			*ok = true;
+			return operand.value;
+		default:
+			*ok    = false;
+			*error = ExpressionError(ExpressionError::UNKNOWN_VARIABLE);
+			return 0;
+		}
+	};
+
+	IProcess *const proc = process();
+	auto read_memory = [proc](edb::address_t address, bool *ok, ExpressionError *error) -> edb::address_t {
+		edb::address_t ret = 0;
+		*ok = proc && proc->read_bytes(address, &ret, edb::v1::pointer_size());
+		if(!*ok) {
+			*error = ExpressionError(ExpressionError::CANNOT_READ_MEMORY);
+		}
+		return ret;
+	};
+
+	bool ok;
+	ExpressionError error;
+	const edb::address_t result = compiled->program.evaluate(read_variable, read_memory, &ok, &error);
+	if(!ok) {
+		return false;
+	}
+
+	*value = result != 0;
+	return true;
+}
+
 auto DebuggerCoreBase::supported_breakpoint_types() const -> std::vector<IBreakpoint::BreakpointType> {
 	return Breakpoint::supported_types();
 }
 
+//------------------------------------------------------------------------------
+// Name: debug_event_fd
+// Desc: by default there is nothing to watch and wait_debug_event must be polled
+//------------------------------------------------------------------------------
+int DebuggerCoreBase::debug_event_fd() const {
+	return -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: trace_run
+// Desc: platforms without an in-core trace loop report nothing, callers are
+//       expected to fall back to regular stepping
+//------------------------------------------------------------------------------
+std::shared_ptr<IDebugEvent> DebuggerCoreBase::trace_run(const TraceOptions &options) {
+	Q_UNUSED(options);
+	return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Name: trace_log
+// Desc:
+//------------------------------------------------------------------------------
+auto DebuggerCoreBase::trace_log() const -> std::vector<TraceEntry> {
+	return {};
+}
+
+//------------------------------------------------------------------------------
+// Name: clear_trace_log
+// Desc:
+//------------------------------------------------------------------------------
+void DebuggerCoreBase::clear_trace_log() {
+}
+
+//------------------------------------------------------------------------------
+// Name: set_debug_registers
+// Desc: records the debug registers which new threads should be given
+//------------------------------------------------------------------------------
+void DebuggerCoreBase::set_debug_registers(const DebugRegisters &registers) {
+	debug_registers_ = registers;
+}
+
+//------------------------------------------------------------------------------
+// Name: debug_registers
+// Desc:
+//------------------------------------------------------------------------------
+auto DebuggerCoreBase::debug_registers() const -> DebugRegisters {
+	return debug_registers_;
+}
+
 }
@@ -20,6 +20,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define DEBUGGERCOREBASE_20090529_H_
 
 #include "IDebugger.h"
+#include "Breakpoint.h"
+#include "BreakpointIndex.h"
+#include <QHash>
+#include <QMap>
+#include <vector>
 
 class Status;
 
@@ -47,20 +52,42 @@ public:
 	std::shared_ptr<IBreakpoint> find_breakpoint(edb::address_t address) override;
 	std::shared_ptr<IBreakpoint> find_triggered_breakpoint(edb::address_t address) override;
 	void clear_breakpoints() override;
+	void clear_conditions() override;
 	void remove_breakpoint(edb::address_t address) override;
 	void end_debug_session() override;
+	int debug_event_fd() const override;
 
 	std::vector<IBreakpoint::BreakpointType> supported_breakpoint_types() const override;
 
+public:
+	std::shared_ptr<IDebugEvent> trace_run(const TraceOptions &options) override;
+	std::vector<TraceEntry> trace_log() const override;
+	void clear_trace_log() override;
+
+public:
+	void set_debug_registers(const DebugRegisters &registers) override;
+	DebugRegisters debug_registers() const override;
+
 public:
 	virtual edb::pid_t pid() const;
 
 protected:
 	bool attached() const;
+	std::vector<std::shared_ptr<IBreakpoint>> overlapping_breakpoints(edb::address_t address, std::size_t len) const;
+	bool evaluate_condition(const QString &condition, const State &state, bool *value);
 
 protected:
 	edb::pid_t      pid_;
 	BreakpointList  breakpoints_;
+	DebugRegisters  debug_registers_ = {};
+
+private:
+	// the same breakpoints as breakpoints_, but ordered by address
+	BreakpointIndex<IBreakpoint, Breakpoint::MAX_SIZE> breakpoint_index_;
+
+	// breakpoint conditions, parsed once and keyed by their text
+	struct CompiledCondition;
+	QHash<QString, std::shared_ptr<CompiledCondition>> conditions_;
 };
 
 }
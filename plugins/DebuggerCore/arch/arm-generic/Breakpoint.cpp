@@ -93,7 +93,7 @@ Breakpoint::~Breakpoint() {
 bool Breakpoint::enable() {
 	if(!enabled()) {
 		if(IProcess *process = edb::v1::debugger_core->process()) {
-			std::vector<quint8> prev(4);
+			std::vector<quint8> prev(MAX_SIZE);
 			prev.resize(process->read_bytes(address(), &prev[0], prev.size()));
 			if(prev.size()) {
 				original_bytes_ = prev;
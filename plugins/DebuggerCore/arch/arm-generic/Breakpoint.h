@@ -57,6 +57,9 @@ public:
 	static std::vector<BreakpointType> supported_types();
 	static std::vector<size_t> possible_rewind_sizes();
 
+	// the largest number of bytes any breakpoint type occupies
+	static constexpr std::size_t MAX_SIZE = 4;
+
 public:
     bool enable() override;
     bool disable() override;
@@ -98,7 +98,7 @@ Breakpoint::~Breakpoint() {
 bool Breakpoint::enable() {
 	if(!enabled()) {
 		if(IProcess *process = edb::v1::debugger_core->process()) {
-			std::vector<quint8> prev(2);
+			std::vector<quint8> prev(MAX_SIZE);
 			if(process->read_bytes(address(), &prev[0], prev.size())) {
 				original_bytes_ = prev;
 				const std::vector<quint8>* bpBytes=nullptr;
@@ -0,0 +1,298 @@
+/*
+Copyright (C) 2017 - 2017 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "DebugEventWaiter.h"
+
+#include <QtDebug>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include <dirent.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace DebuggerCorePlugin {
+
+namespace {
+
+// how often the debuggee's threads are checked while another child of edb is
+// waiting to be reaped
+constexpr std::chrono::milliseconds ForeignChildPollInterval(10);
+
+//------------------------------------------------------------------------------
+// Name: is_debuggee_thread
+// Desc: returns true if <tid> is one of the threads of the process <pid>
+//------------------------------------------------------------------------------
+bool is_debuggee_thread(edb::pid_t pid, edb::tid_t tid) {
+
+	if(pid <= 0) {
+		return false;
+	}
+
+	if(tid == pid) {
+		return true;
+	}
+
+	char path[64];
+	std::snprintf(path, sizeof(path), "/proc/%d/task/%d", static_cast<int>(pid), static_cast<int>(tid));
+	return ::access(path, F_OK) == 0;
+}
+
+//------------------------------------------------------------------------------
+// Name: poll_threads
+// Desc: returns a thread of the process <pid> which has an event waiting, or 0
+//       if there is none
+//------------------------------------------------------------------------------
+edb::tid_t poll_threads(edb::pid_t pid) {
+
+	char path[64];
+	std::snprintf(path, sizeof(path), "/proc/%d/task", static_cast<int>(pid));
+
+	DIR *const dir = ::opendir(path);
+	if(!dir) {
+		return 0;
+	}
+
+	edb::tid_t found = 0;
+	while(const struct dirent *entry = ::readdir(dir)) {
+		char *end;
+		const long tid = std::strtol(entry->d_name, &end, 10);
+		if(*end != '\0' || tid <= 0) {
+			continue;
+		}
+
+		siginfo_t info = {};
+		if(::waitid(P_PID, tid, &info, WEXITED | WSTOPPED | WNOWAIT | WNOHANG | __WALL) == 0 && info.si_pid != 0) {
+			found = tid;
+			break;
+		}
+	}
+
+	::closedir(dir);
+	return found;
+}
+
+}
+
+// everything the thread touches lives here, so that the thread may safely
+// outlive the DebugEventWaiter if it is still blocked in waitid on shutdown
+struct DebugEventWaiter::Shared {
+	int                     fd = -1;
+	std::atomic<edb::tid_t> tid{0};
+	std::atomic<bool>       broken{false};
+	edb::pid_t              pid   = 0;
+	std::mutex              mutex;
+	std::condition_variable cv;
+	bool                    armed = false;
+	bool                    stop  = false;
+
+	~Shared() {
+		if(fd != -1) {
+			::close(fd);
+		}
+	}
+};
+
+//------------------------------------------------------------------------------
+// Name: run
+// Desc: body of the waiter thread
+//------------------------------------------------------------------------------
+void DebugEventWaiter::run(std::shared_ptr<Shared> shared) {
+
+	Q_FOREVER {
+		edb::pid_t pid;
+		{
+			std::unique_lock<std::mutex> lock(shared->mutex);
+			shared->cv.wait(lock, [&shared]() { return shared->armed || shared->stop; });
+			if(shared->stop) {
+				return;
+			}
+			shared->armed = false;
+			pid = shared->pid;
+		}
+
+		const edb::tid_t tid = wait_for_debuggee(shared, pid);
+		if(tid == 0) {
+			// nobody to wait for (yet), the next attach/launch arms us again
+			continue;
+		}
+
+		if(tid > 0) {
+			shared->tid.store(tid, std::memory_order_release);
+		}
+
+		const uint64_t one = 1;
+		if(::write(shared->fd, &one, sizeof(one)) == -1) {
+			qWarning() << "DebugEventWaiter: failed to signal eventfd:" << std::strerror(errno);
+		}
+
+		if(shared->broken) {
+			return;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: wait_for_debuggee
+// Desc: blocks until a thread of the process <pid> has an event and returns
+//       it. Returns 0 if there are no children to wait for or the waiter is
+//       shutting down, and -1 if waitid doesn't work
+//------------------------------------------------------------------------------
+edb::tid_t DebugEventWaiter::wait_for_debuggee(const std::shared_ptr<Shared> &shared, edb::pid_t pid) {
+
+	Q_FOREVER {
+		// only peek, the event stays queued in the kernel for the core to reap
+		siginfo_t info = {};
+		if(::waitid(P_ALL, 0, &info, WEXITED | WSTOPPED | WNOWAIT | __WALL) == -1) {
+			if(errno == EINTR) {
+				continue;
+			}
+
+			if(errno == ECHILD) {
+				return 0;
+			}
+
+			// most likely a kernel which doesn't accept __WALL for waitid (< 4.7),
+			// wake up the core so it notices and falls back to polling
+			qWarning() << "DebugEventWaiter: waitid failed:" << std::strerror(errno);
+			shared->broken = true;
+			return -1;
+		}
+
+		if(is_debuggee_thread(pid, info.si_pid)) {
+			return info.si_pid;
+		}
+
+		// some other child of edb, waitid keeps reporting it until its owner
+		// reaps it. Until then the debuggee's threads are checked one by one
+		Q_FOREVER {
+			{
+				std::lock_guard<std::mutex> lock(shared->mutex);
+				if(shared->stop) {
+					return 0;
+				}
+			}
+
+			if(const edb::tid_t tid = poll_threads(pid)) {
+				return tid;
+			}
+
+			siginfo_t other = {};
+			if(::waitid(P_PID, info.si_pid, &other, WEXITED | WSTOPPED | WNOWAIT | WNOHANG | __WALL) == -1 || other.si_pid == 0) {
+				break;
+			}
+
+			std::this_thread::sleep_for(ForeignChildPollInterval);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: DebugEventWaiter
+// Desc:
+//------------------------------------------------------------------------------
+DebugEventWaiter::DebugEventWaiter() : shared_(std::make_shared<Shared>()) {
+
+	shared_->fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(shared_->fd == -1) {
+		qWarning() << "DebugEventWaiter: eventfd failed:" << std::strerror(errno);
+		shared_->broken = true;
+		return;
+	}
+
+	std::thread(run, shared_).detach();
+}
+
+//------------------------------------------------------------------------------
+// Name: ~DebugEventWaiter
+// Desc: the thread is detached, if it is parked it exits right away, if it is
+//       blocked in waitid it exits as soon as that returns
+//------------------------------------------------------------------------------
+DebugEventWaiter::~DebugEventWaiter() {
+	std::lock_guard<std::mutex> lock(shared_->mutex);
+	shared_->stop = true;
+	shared_->cv.notify_one();
+}
+
+//------------------------------------------------------------------------------
+// Name: valid
+// Desc: returns false if the waiter can't be used and the core should poll
+//------------------------------------------------------------------------------
+bool DebugEventWaiter::valid() const {
+	return !shared_->broken;
+}
+
+//------------------------------------------------------------------------------
+// Name: fd
+// Desc: a descriptor which becomes readable when a child has an event
+//------------------------------------------------------------------------------
+int DebugEventWaiter::fd() const {
+	return valid() ? shared_->fd : -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: arm
+// Desc: lets the waiter look for the next event of the process <pid>
+//------------------------------------------------------------------------------
+void DebugEventWaiter::arm(edb::pid_t pid) {
+	std::lock_guard<std::mutex> lock(shared_->mutex);
+	shared_->pid   = pid;
+	shared_->armed = true;
+	shared_->cv.notify_one();
+}
+
+//------------------------------------------------------------------------------
+// Name: acknowledge
+// Desc: consumes a pending wake up, returns false if there was none. <tid> is
+//       set to the child which the kernel reported, it may have been reaped
+//       by someone else in the meantime
+//------------------------------------------------------------------------------
+bool DebugEventWaiter::acknowledge(edb::tid_t *tid) {
+
+	uint64_t count;
+	if(::read(shared_->fd, &count, sizeof(count)) != sizeof(count)) {
+		return false;
+	}
+
+	*tid = shared_->tid.load(std::memory_order_acquire);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: wait
+// Desc: waits up to <msecs> for a wake up without consuming it
+//------------------------------------------------------------------------------
+bool DebugEventWaiter::wait(int msecs) const {
+	struct pollfd pfd = {};
+	pfd.fd     = shared_->fd;
+	pfd.events = POLLIN;
+	return ::poll(&pfd, 1, msecs) > 0;
+}
+
+}
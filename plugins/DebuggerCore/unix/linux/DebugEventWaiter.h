@@ -0,0 +1,65 @@
+/*
+Copyright (C) 2017 - 2017 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef DEBUG_EVENT_WAITER_H_
+#define DEBUG_EVENT_WAITER_H_
+
+#include "OSTypes.h"
+#include <memory>
+
+namespace DebuggerCorePlugin {
+
+// A background thread which blocks in waitid(WNOWAIT) until one of our
+// children has something to report, and then signals an eventfd which can be
+// watched by the event loop. It never reaps anything itself: only the tracer
+// thread may issue ptrace requests, so the actual waitpid stays with the core.
+//
+// The protocol is one event per arm(): after a wake up, the waiter sleeps
+// until the core has consumed the event and calls arm() again. This way the
+// waiter doesn't spin on a child which is waitable but not yet reaped.
+//
+// Other children of edb (the terminal of the debuggee for example) are never
+// reported, they are left for whoever started them to reap.
+class DebugEventWaiter {
+public:
+	DebugEventWaiter();
+	~DebugEventWaiter();
+
+private:
+	DebugEventWaiter(const DebugEventWaiter &) = delete;
+	DebugEventWaiter &operator=(const DebugEventWaiter &) = delete;
+
+public:
+	bool valid() const;
+	int fd() const;
+	void arm(edb::pid_t pid);
+	bool acknowledge(edb::tid_t *tid);
+	bool wait(int msecs) const;
+
+private:
+	struct Shared;
+	static void run(std::shared_ptr<Shared> shared);
+	static edb::tid_t wait_for_debuggee(const std::shared_ptr<Shared> &shared, edb::pid_t pid);
+
+private:
+	std::shared_ptr<Shared> shared_;
+};
+
+}
+
+#endif
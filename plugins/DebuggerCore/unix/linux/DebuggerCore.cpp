@@ -17,10 +17,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 
-// TODO(eteran): research usage of process_vm_readv, process_vm_writev
+// TODO(eteran): research usage of process_vm_writev
 
 #include "DebuggerCore.h"
 #include "Configuration.h"
+#include "DebugEventWaiter.h"
 #include "DialogMemoryAccess.h"
 #include "edb.h"
 #include "FeatureDetect.h"
@@ -31,13 +32,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "PlatformRegion.h"
 #include "PlatformState.h"
 #include "PlatformThread.h"
+#include "Register.h"
 #include "State.h"
 #include "string_hash.h"
 
 #include <QDebug>
 #include <QDir>
+#include <QElapsedTimer>
 #include <QSettings>
 
+#include <algorithm>
 #include <cerrno>
 #include <cstring>
 
@@ -78,10 +82,17 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace DebuggerCorePlugin {
 
+Q_LOGGING_CATEGORY(DebuggerTiming, "edb.debugger.timing", QtWarningMsg)
+
 namespace {
 
 const edb::address_t PageSize = 0x1000;
 
+// how long trace_run waits for a single step to complete before assuming that
+// the thread is blocked (e.g. in a system call) and handing it back to the
+// regular event loop
+const qint64 TraceStepTimeout = 250;
+
 //------------------------------------------------------------------------------
 // Name: is_numeric
 // Desc: returns true if the string only contains decimal digits
@@ -163,8 +174,8 @@ DebuggerCore::DebuggerCore() :
 	USER_CS_64(osIs64Bit ? 0x33 : 0xfff8), // RPL 0 can't appear in user segment registers, so 0xfff8 is safe
 	USER_SS(osIs64Bit    ? 0x2b : 0x7b),
 #endif
-	lastMeansOfCapture(MeansOfCapture::NeverCaptured)
-	
+	lastMeansOfCapture(MeansOfCapture::NeverCaptured),
+	waiter_(new DebugEventWaiter)
 	 {
 
 #if 0
@@ -307,6 +318,7 @@ Status DebuggerCore::ptrace_continue(edb::tid_t tid, long status) {
 			return Status(strError);
 		}
 		waited_threads_.remove(tid);
+		++stop_epoch_;
 		return Status::Ok;
 	}
 	return Status(QObject::tr("ptrace_continue(): waited_threads_ doesn't contain tid %1").arg(tid));
@@ -328,6 +340,7 @@ Status DebuggerCore::ptrace_step(edb::tid_t tid, long status) {
 			return Status(strError);
 		}
 		waited_threads_.remove(tid);
+		++stop_epoch_;
 		return Status::Ok;
 	}
 	return Status(QObject::tr("ptrace_step(): waited_threads_ doesn't contain tid %1").arg(tid));
@@ -407,15 +420,53 @@ void DebuggerCore::handle_thread_exit(edb::tid_t tid, int status) {
 	waited_threads_.remove(tid);
 }
 
+//------------------------------------------------------------------------------
+// Name: add_thread
+// Desc: starts tracking the new thread <tid>, whose first stop was <status>
+//------------------------------------------------------------------------------
+std::shared_ptr<PlatformThread> DebuggerCore::add_thread(edb::tid_t tid, int status) {
+
+	if(!WIFSTOPPED(status) || WSTOPSIG(status) != SIGSTOP) {
+		qWarning("add_thread(): new thread [%d] received an event besides SIGSTOP: status=0x%x", static_cast<int>(tid), status);
+	}
+
+	auto newThread            = std::make_shared<PlatformThread>(this, process_, tid);
+	newThread->status_        = status;
+	newThread->signal_status_ = PlatformThread::Stopped;
+
+	threads_.insert(tid, newThread);
+
+	// give the new thread the hardware breakpoints the others have. A new
+	// thread starts out with all of its debug registers cleared, so only
+	// the non-zero address and control registers have to be written
+	static constexpr std::size_t propagated[] = { 0, 1, 2, 3, 7 };
+	for(std::size_t i : propagated) {
+		if(debug_registers_[i] != 0) {
+			newThread->set_debug_register(i, debug_registers_[i]);
+		}
+	}
+
+	return newThread;
+}
+
 //------------------------------------------------------------------------------
 // Name: handle_event
 // Desc:
 //------------------------------------------------------------------------------
 std::shared_ptr<IDebugEvent> DebuggerCore::handle_event(edb::tid_t tid, int status) {
 
+	// anything we learned about the process while it was running is stale now
+	++stop_epoch_;
+
 	// note that we have waited on this thread
 	waited_threads_.insert(tid);
 
+	// a thread which was stepping over a breakpoint with a false condition has
+	// stopped again, so the breakpoint can be put back
+	if(finish_step_over(tid, status)) {
+		return nullptr;
+	}
+
 	// was it a thread exit event?
 	if(WIFEXITED(status)) {
 
@@ -439,44 +490,22 @@ std::shared_ptr<IDebugEvent> DebuggerCore::handle_event(edb::tid_t tid, int stat
 		unsigned long new_tid;
 		if(ptrace_get_event_message(tid, &new_tid)) {
 
-			auto newThread            = std::make_shared<PlatformThread>(this, process_, new_tid);
-			newThread->status_        = 0;
-			newThread->signal_status_ = PlatformThread::Stopped;
-
-			threads_.insert(new_tid, newThread);
-
-			int thread_status = 0;
-			if(!waited_threads_.contains(new_tid)) {
+			// the new thread may already have been collected (and added) while
+			// stopping the other threads
+			if(!threads_.contains(new_tid)) {
+				int thread_status = 0;
 				if(native::waitpid(new_tid, &thread_status, __WALL) > 0) {
 					waited_threads_.insert(new_tid);
 				}
-			}
 
-			// A new thread could exit before we have fully created it, no event then since it can't be the last thread
-			if(WIFEXITED(thread_status)) {
-				handle_thread_exit(tid,thread_status);
-				return nullptr;
-			}
-
-			if(!WIFSTOPPED(thread_status) || WSTOPSIG(thread_status) != SIGSTOP) {
-				qWarning("handle_event(): new thread [%d] received an event besides SIGSTOP: status=0x%x", static_cast<int>(new_tid),thread_status);
-			}
-
-			newThread->status_ = thread_status;
-
-			// copy the hardware debug registers from the current thread to the new thread
-			if(process_) {
-				if(auto thread = process_->current_thread()) {
-					for(int i = 0; i < 8; ++i) {
-						auto new_thread = std::static_pointer_cast<PlatformThread>(newThread);
-						auto old_thread = std::static_pointer_cast<PlatformThread>(thread);
-						new_thread->set_debug_register(i, old_thread->get_debug_register(i));
-					}
+				// A new thread could exit before we have fully created it, no event then since it can't be the last thread
+				if(WIFEXITED(thread_status)) {
+					handle_thread_exit(new_tid,thread_status);
+				} else {
+					// TODO(eteran): what the heck do we do if this isn't a SIGSTOP?
+					add_thread(new_tid, thread_status)->resume();
 				}
 			}
-
-			// TODO(eteran): what the heck do we do if this isn't a SIGSTOP?
-			newThread->resume();
 		}
 
 		ptrace_continue(tid, 0);
@@ -484,6 +513,21 @@ std::shared_ptr<IDebugEvent> DebuggerCore::handle_event(edb::tid_t tid, int stat
 	}
 
 	// normal event
+	active_thread_ = tid;
+
+	auto it = threads_.find(tid);
+	if(it != threads_.end()) {
+		it.value()->status_ = status;
+	}
+
+	stop_threads();
+
+	// breakpoints whose condition is false are stepped over right here, the
+	// GUI never hears about them
+	if(skip_false_condition(tid, &status)) {
+		return nullptr;
+	}
+
 	auto e = std::make_shared<PlatformEvent>();
 
 	e->pid_    = pid();
@@ -493,14 +537,16 @@ std::shared_ptr<IDebugEvent> DebuggerCore::handle_event(edb::tid_t tid, int stat
 		// TODO: handle no info?
 	}
 
-	active_thread_ = tid;
-
-	auto it = threads_.find(tid);
-	if(it != threads_.end()) {
-		it.value()->status_ = status;
+#if defined(EDB_X86) || defined(EDB_X86_64)
+	// the SIGTRAP which follows a successful execve is sent by the process to
+	// itself. The kernel has cleared the debug registers of the new image, so
+	// whatever the threads had cached about them is wrong now
+	if(WIFSTOPPED(status) && WSTOPSIG(status) == SIGTRAP && (status >> 16) == 0 && e->siginfo_.si_code == SI_USER && e->siginfo_.si_pid == pid()) {
+		for(const std::shared_ptr<PlatformThread> &thread : threads_) {
+			thread->invalidate_state_cache();
+		}
 	}
-
-	stop_threads();
+#endif
 
 	// Some breakpoint types result in SIGILL or SIGSEGV. We'll transform the
 	// event into breakpoint event if such a breakpoint has triggered.
@@ -535,42 +581,260 @@ std::shared_ptr<IDebugEvent> DebuggerCore::handle_event(edb::tid_t tid, int stat
 	return e;
 }
 
+//------------------------------------------------------------------------------
+// Name: skip_false_condition
+// Desc: if <tid> stopped on a conditional breakpoint whose condition is false,
+//       steps it over the breakpoint and lets the process run again. Returns
+//       true if the process was resumed. If the step ended with some other
+//       event, <status> is replaced with it and false is returned so it is
+//       handled as usual
+// Note: this is the same thing Debugger::handle_trap does with a false
+//       condition, minus the round trip through the event loop. Every other
+//       thread is already stopped, so none of them can run past the
+//       breakpoint while it is disabled
+//------------------------------------------------------------------------------
+bool DebuggerCore::skip_false_condition(edb::tid_t tid, int *status) {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+	// only plain SIGTRAP stops, not ptrace events
+	if(!WIFSTOPPED(*status) || WSTOPSIG(*status) != SIGTRAP || (*status >> 16) != 0) {
+		return false;
+	}
+
+	auto it = threads_.find(tid);
+	if(it == threads_.end()) {
+		return false;
+	}
+
+	siginfo_t siginfo;
+	if(!ptrace_getsiginfo(tid, &siginfo) || siginfo.si_code == TRAP_TRACE) {
+		return false;
+	}
+
+	const std::shared_ptr<PlatformThread> thread = it.value();
+
+	// the condition can only refer to general purpose registers
+	State state;
+	thread->get_state(&state, PlatformThread::GeneralRegisters);
+
+	const std::shared_ptr<IBreakpoint> bp = find_triggered_breakpoint(state.instruction_pointer());
+	if(!bp || !bp->enabled() || bp->internal() || bp->condition.isEmpty()) {
+		return false;
+	}
+
+	// the condition sees the thread as it was before the breakpoint executed
+	state.set_instruction_pointer(bp->address());
+
+	// if the condition can't be evaluated, let the GUI deal with it
+	bool condition;
+	if(!evaluate_condition(bp->condition, state, &condition) || condition) {
+		return false;
+	}
+
+	bp->hit();
+
+	State full_state;
+	thread->get_state(&full_state);
+	full_state.set_instruction_pointer(bp->address());
+	thread->set_state(full_state);
+
+	bp->disable();
+	if(!ptrace_step(tid, 0)) {
+		bp->enable();
+		return false;
+	}
+
+	int new_status = 0;
+	if(!wait_trace_step(tid, &new_status)) {
+		// the step hasn't finished (a blocking system call for example), the
+		// breakpoint stays disabled until this thread stops again. The other
+		// threads can't be kept waiting that long
+		stepping_over_.insert(tid, bp);
+		resume_waited_threads();
+		return true;
+	}
+
+	bp->enable();
+
+	waited_threads_.insert(tid);
+	++stop_epoch_;
+	thread->status_ = new_status;
+
+	if(is_trace_trap(tid, new_status)) {
+		ptrace_continue(tid, 0);
+		resume_waited_threads();
+		return true;
+	}
+
+	*status = new_status;
+	return false;
+#else
+	// there is no hardware single step to get over the breakpoint with
+	Q_UNUSED(tid);
+	Q_UNUSED(status);
+	return false;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: finish_step_over
+// Desc: re-enables the breakpoint <tid> was stepping over when its step took
+//       too long to wait for. Returns true if <status> is the end of that step,
+//       in which case the thread has been resumed
+//------------------------------------------------------------------------------
+bool DebuggerCore::finish_step_over(edb::tid_t tid, int status) {
+
+	auto it = stepping_over_.find(tid);
+	if(it == stepping_over_.end()) {
+		return false;
+	}
+
+	const std::shared_ptr<IBreakpoint> bp = it.value();
+	stepping_over_.erase(it);
+
+	// the breakpoint may have been removed while the thread was stepping
+	if(find_breakpoint(bp->address()) == bp) {
+		bp->enable();
+	}
+
+	if(WIFSTOPPED(status) && is_trace_trap(tid, status)) {
+		ptrace_continue(tid, 0);
+		return true;
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: is_trace_trap
+// Desc: returns true if <status> is <tid> stopping at the end of a single step.
+//       If <siginfo> is given, the signal info of the stop is stored there
+//------------------------------------------------------------------------------
+bool DebuggerCore::is_trace_trap(edb::tid_t tid, int status, siginfo_t *siginfo) {
+
+	if(!WIFSTOPPED(status) || WSTOPSIG(status) != SIGTRAP || (status >> 16) != 0) {
+		return false;
+	}
+
+	siginfo_t info;
+	if(!siginfo) {
+		siginfo = &info;
+	}
+
+	return ptrace_getsiginfo(tid, siginfo) && siginfo->si_code == TRAP_TRACE;
+}
+
+//------------------------------------------------------------------------------
+// Name: resume_waited_threads
+// Desc: resumes every thread which is stopped, passing along the signals that
+//       stopped them
+//------------------------------------------------------------------------------
+void DebuggerCore::resume_waited_threads() {
+
+	const TidSet waited = waited_threads_;
+	for(auto tid = waited.rbegin(); tid != waited.rend(); ++tid) {
+		auto it = threads_.find(*tid);
+		if(it != threads_.end()) {
+			it.value()->resume();
+		}
+	}
+}
+
 //------------------------------------------------------------------------------
 // Name: stop_threads
-// Desc:
+// Desc: stops every thread which isn't stopped already
+// Note: all of the threads are signaled first and then reaped one by one, so
+//       stopping N threads costs one scheduling round trip instead of N of
+//       them. Only the threads being stopped (and any threads they create in
+//       the meantime) are waited for, other children of edb are left alone
 //------------------------------------------------------------------------------
 Status DebuggerCore::stop_threads() {
 
+	QElapsedTimer timer;
+	timer.start();
+
 	QString errorMessage;
 
 	if(process_) {
-		for(auto &thread: process_->threads()) {
-			const edb::tid_t tid = thread->tid();
+		TidSet stopping;
+		stopping.reserve(threads_.size());
+
+		for(auto it = threads_.begin(); it != threads_.end(); ++it) {
+			const edb::tid_t tid = it.key();
 
 			if(!waited_threads_.contains(tid)) {
+				const auto stopStatus = it.value()->stop();
+				if(stopStatus) {
+					stopping.insert(tid);
+				} else {
+					errorMessage+=QObject::tr("Failed to stop thread %1: %2\n").arg(tid).arg(stopStatus.toString());
+				}
+			}
+		}
+
+		const int stop_count = static_cast<int>(stopping.size());
+
+		// threads created while we were stopping the others, they are
+		// collected along with them
+		TidSet cloned;
 
-				if(auto thread_ptr = std::static_pointer_cast<PlatformThread>(thread)) {
-
-					const auto stopStatus=thread->stop();
-					if(!stopStatus)
-						errorMessage+=QObject::tr("Failed to stop thread %1: %2\n").arg(tid).arg(stopStatus.toString());
-
-					int thread_status;
-					if(native::waitpid(tid, &thread_status, __WALL) > 0) {
-						waited_threads_.insert(tid);
-						thread_ptr->status_ = thread_status;
-
-						// A thread could have exited between previous waitpid and the latest one...
-						if(WIFEXITED(thread_status)) {
-							handle_thread_exit(tid, thread_status);
-						}
-						// ..., otherwise it must have stopped.
-						else if(!WIFSTOPPED(thread_status) || WSTOPSIG(thread_status) != SIGSTOP) {
-							qWarning("stop_threads(): paused thread [%d] received an event besides SIGSTOP: status=0x%x", tid,thread_status);
-						}
-					}
+		while(!stopping.empty()) {
+			const edb::tid_t tid = *stopping.rbegin();
+
+			int thread_status;
+			if(native::waitpid(tid, &thread_status, __WALL) != tid) {
+				qWarning("stop_threads(): waitpid(%d) failed: %s", static_cast<int>(tid), std::strerror(errno));
+				stopping.remove(tid);
+				continue;
+			}
+
+			if(cloned.contains(tid)) {
+				stopping.remove(tid);
+				cloned.remove(tid);
+				if(!WIFEXITED(thread_status) && !WIFSIGNALED(thread_status)) {
+					waited_threads_.insert(tid);
+					add_thread(tid, thread_status);
+				}
+				continue;
+			}
+
+			auto it = threads_.find(tid);
+			if(it == threads_.end()) {
+				stopping.remove(tid);
+				continue;
+			}
+
+			// the thread created another one before our SIGSTOP got to it. Pick
+			// up the new thread too, and let this one run into the SIGSTOP
+			// which is still pending for it
+			if(is_clone_event(thread_status)) {
+				unsigned long new_tid;
+				if(ptrace_get_event_message(tid, &new_tid) && !threads_.contains(new_tid)) {
+					cloned.insert(new_tid);
+					stopping.insert(new_tid);
+				}
+
+				if(ptrace(PTRACE_CONT, tid, 0, 0) != -1) {
+					continue;
 				}
 			}
+
+			waited_threads_.insert(tid);
+			stopping.remove(tid);
+			it.value()->status_ = thread_status;
+
+			// A thread could have exited between previous waitpid and the latest one...
+			if(WIFEXITED(thread_status) || WIFSIGNALED(thread_status)) {
+				handle_thread_exit(tid, thread_status);
+			}
+			// ..., otherwise it must have stopped.
+			else if(!WIFSTOPPED(thread_status) || WSTOPSIG(thread_status) != SIGSTOP) {
+				qWarning("stop_threads(): paused thread [%d] received an event besides SIGSTOP: status=0x%x", tid,thread_status);
+			}
+		}
+
+		stop_nsecs_ = timer.nsecsElapsed();
+		if(stop_nsecs_ >= SlowStopThreshold) {
+			qCDebug(DebuggerTiming, "stopping %d of %d threads took %lld us", stop_count, threads_.size(), stop_nsecs_ / 1000);
 		}
 	}
 	if(errorMessage.isEmpty())
@@ -586,20 +850,293 @@ Status DebuggerCore::stop_threads() {
 //------------------------------------------------------------------------------
 std::shared_ptr<IDebugEvent> DebuggerCore::wait_debug_event(int msecs) {
 
+	// an event left over from trace_run is reported before anything else
+	if(pending_event_) {
+		std::shared_ptr<IDebugEvent> e;
+		e.swap(pending_event_);
+		return e;
+	}
+
+	if(waiter_->valid()) {
+		edb::tid_t tid = 0;
+		if(!waiter_->acknowledge(&tid)) {
+			if(!waiter_->wait(msecs) || !waiter_->acknowledge(&tid)) {
+				return nullptr;
+			}
+		}
+
+		// a stale wake up from a session which has ended since
+		if(!process_) {
+			return nullptr;
+		}
+
+		std::shared_ptr<IDebugEvent> e = reap_debug_event(tid);
+		waiter_->arm(pid_);
+		return e;
+	}
+
 	if(process_) {
 		if(!native::wait_for_sigchld(msecs)) {
-			for(auto &thread : process_->threads()) {
-				int status;
-				const edb::tid_t tid = native::waitpid(thread->tid(), &status, __WALL | WNOHANG);
-				if(tid > 0) {
-					return handle_event(tid, status);
-				}
-			}
+			return reap_debug_event(0);
 		}
 	}
 	return nullptr;
 }
 
+//------------------------------------------------------------------------------
+// Name: reap_debug_event
+// Desc: collects the event of <tid> if it is one of our threads, otherwise (or
+//       if it has already been collected elsewhere) checks every thread
+//------------------------------------------------------------------------------
+std::shared_ptr<IDebugEvent> DebuggerCore::reap_debug_event(edb::tid_t tid) {
+
+	int status;
+	if(tid > 0 && threads_.contains(tid)) {
+		if(native::waitpid(tid, &status, __WALL | WNOHANG) == tid) {
+			return handle_event(tid, status);
+		}
+	}
+
+	for(auto &thread : process_->threads()) {
+		const edb::tid_t waited = native::waitpid(thread->tid(), &status, __WALL | WNOHANG);
+		if(waited > 0) {
+			return handle_event(waited, status);
+		}
+	}
+
+	return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Name: debug_event_fd
+// Desc:
+//------------------------------------------------------------------------------
+int DebuggerCore::debug_event_fd() const {
+	return waiter_->fd();
+}
+
+//------------------------------------------------------------------------------
+// Name: wait_trace_step
+// Desc: waits for a step issued by trace_run to complete, returns false if the
+//       thread did not stop within TraceStepTimeout
+//------------------------------------------------------------------------------
+bool DebuggerCore::wait_trace_step(edb::tid_t tid, int *status) {
+
+	QElapsedTimer timer;
+	timer.start();
+
+	Q_FOREVER {
+		const edb::tid_t r = native::waitpid(tid, status, __WALL | WNOHANG);
+		if(r == tid) {
+			return true;
+		}
+
+		if(r == -1 || timer.elapsed() >= TraceStepTimeout) {
+			return false;
+		}
+
+		native::wait_for_sigchld(TraceStepTimeout - timer.elapsed());
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: trace_run
+// Desc: single steps the current thread in a tight loop without going through
+//       the GUI, recording every step in the trace log. Tracing ends when the
+//       stop predicate returns true, max_steps is reached, an enabled
+//       breakpoint is reached or anything but a plain step happens (a signal,
+//       a breakpoint trap, thread exit...). The final event is returned and
+//       queued so the next wait_debug_event reports it as usual. nullptr is
+//       returned if the thread was handed back to the regular event loop
+// Note: the GUI can't run while this loop does, so max_steps must be finite.
+//       A max_steps of 0 is rejected and nothing is traced. The trace log is
+//       kept across calls, so a long trace can be run in chunks
+// Note: every other thread is already stopped, so a step which ends with a
+//       plain single step trap needs none of handle_event's work. Only the
+//       stops which are something else go through it
+//------------------------------------------------------------------------------
+std::shared_ptr<IDebugEvent> DebuggerCore::trace_run(const TraceOptions &options) {
+
+	pending_event_ = nullptr;
+
+	if(!process_ || options.max_steps == 0) {
+		return nullptr;
+	}
+
+	auto thread = std::static_pointer_cast<PlatformThread>(process_->current_thread());
+	if(!thread || !waited_threads_.contains(thread->tid())) {
+		return nullptr;
+	}
+
+	const edb::tid_t tid = thread->tid();
+
+	State state;
+	auto fetch_state = [&thread, &state]() {
+#if defined(EDB_X86) || defined(EDB_X86_64)
+		// the predicate and the log only need the general purpose registers
+		thread->get_state(&state, PlatformThread::GeneralRegisters);
+#else
+		thread->get_state(&state);
+#endif
+	};
+
+	fetch_state();
+
+	// resolve the requested registers once, looking them up by name on
+	// every step would dominate the loop
+	std::vector<std::size_t> registers;
+	for(const QString &name : options.registers) {
+		if(registers.size() == MaxTraceRegisters) {
+			break;
+		}
+
+		for(std::size_t n = 0; ; ++n) {
+			const Register reg = state.gp_register(n);
+			if(!reg) {
+				break;
+			}
+
+			if(reg.name().compare(name, Qt::CaseInsensitive) == 0) {
+				registers.push_back(n);
+				break;
+			}
+		}
+	}
+
+	const std::size_t log_capacity = std::max<std::size_t>(options.log_capacity, 1);
+	if(trace_log_.size() != log_capacity) {
+		trace_log_.assign(log_capacity, TraceEntry());
+		trace_head_ = 0;
+		trace_size_ = 0;
+	}
+
+	// if we are sitting on a breakpoint, it has to be out of the way for the first step
+	std::shared_ptr<IBreakpoint> step_bp = find_breakpoint(state.instruction_pointer());
+	if(step_bp && step_bp->enabled()) {
+		step_bp->disable();
+	} else {
+		step_bp = nullptr;
+	}
+
+	std::shared_ptr<IDebugEvent> event;
+
+	// the last stop, if it was a plain step, has no event made for it yet
+	int       step_status = 0;
+	siginfo_t step_siginfo;
+	bool      stepped     = false;
+
+	for(std::size_t steps = 0; steps < options.max_steps; ++steps) {
+
+		if(!thread->step(edb::DEBUG_CONTINUE)) {
+			break;
+		}
+
+		int status;
+		if(!wait_trace_step(tid, &status)) {
+			event   = nullptr;
+			stepped = false;
+			break;
+		}
+
+		if(step_bp) {
+			step_bp->enable();
+			step_bp = nullptr;
+		}
+
+#if defined(EDB_X86) || defined(EDB_X86_64)
+		stepped = is_trace_trap(tid, status, &step_siginfo);
+#else
+		// stepping is done with a breakpoint here, handle_event cleans it up
+		stepped = false;
+#endif
+		if(stepped) {
+			++stop_epoch_;
+			waited_threads_.insert(tid);
+			thread->status_ = status;
+			step_status     = status;
+		} else {
+			event = handle_event(tid, status);
+
+			// thread creation, exit of a thread other than the last one, etc. are
+			// handled by the core itself and leave the thread running
+			if(!event) {
+				break;
+			}
+
+			if(!event->stopped() || !event->is_trap() || event->trap_reason() != IDebugEvent::TRAP_STEPPING) {
+				break;
+			}
+		}
+
+		fetch_state();
+
+		const edb::address_t ip = state.instruction_pointer();
+
+		TraceEntry &entry = trace_log_[trace_head_];
+		entry.ip = ip;
+		for(std::size_t i = 0; i < registers.size(); ++i) {
+			entry.registers[i] = state.gp_register(registers[i]).valueAsInteger();
+		}
+
+		trace_head_ = (trace_head_ + 1) % trace_log_.size();
+		trace_size_ = std::min(trace_size_ + 1, trace_log_.size());
+
+		if(options.stop_predicate && options.stop_predicate(state)) {
+			break;
+		}
+
+		if(std::shared_ptr<IBreakpoint> bp = find_breakpoint(ip)) {
+			if(bp->enabled()) {
+				break;
+			}
+		}
+	}
+
+	if(step_bp) {
+		step_bp->enable();
+	}
+
+	if(stepped) {
+		auto e = std::make_shared<PlatformEvent>();
+
+		e->pid_     = pid();
+		e->tid_     = tid;
+		e->status_  = step_status;
+		e->siginfo_ = step_siginfo;
+		event = e;
+	}
+
+	pending_event_ = event;
+	return event;
+}
+
+//------------------------------------------------------------------------------
+// Name: trace_log
+// Desc: returns the steps recorded by trace_run since the log was last cleared
+//       (or its capacity changed), oldest first
+//------------------------------------------------------------------------------
+auto DebuggerCore::trace_log() const -> std::vector<TraceEntry> {
+
+	std::vector<TraceEntry> ret;
+	ret.reserve(trace_size_);
+
+	const std::size_t first = (trace_head_ + trace_log_.size() - trace_size_) % std::max<std::size_t>(trace_log_.size(), 1);
+	for(std::size_t i = 0; i < trace_size_; ++i) {
+		ret.push_back(trace_log_[(first + i) % trace_log_.size()]);
+	}
+
+	return ret;
+}
+
+//------------------------------------------------------------------------------
+// Name: clear_trace_log
+// Desc: forgets every step recorded so far
+//------------------------------------------------------------------------------
+void DebuggerCore::clear_trace_log() {
+	trace_head_ = 0;
+	trace_size_ = 0;
+}
+
 //------------------------------------------------------------------------------
 // Name: attach_thread
 // Desc: returns 0 if successful, errno if failed
@@ -684,6 +1221,7 @@ Status DebuggerCore::attach(edb::pid_t pid) {
 		active_thread_  = pid;
 		binary_info_    = edb::v1::get_binary_info(edb::v1::primary_code_region());
 		detectCPUMode();
+		waiter_->arm(pid_);
 		return Status::Ok;
 	}
 
@@ -946,6 +1484,7 @@ Status DebuggerCore::open(const QString &path, const QString &cwd, const QList<Q
 			binary_info_    = edb::v1::get_binary_info(edb::v1::primary_code_region());
 
 			detectCPUMode();
+			waiter_->arm(pid_);
 
 			return Status::Ok;
 		} while(0);
@@ -969,9 +1508,14 @@ DebuggerCore::MeansOfCapture DebuggerCore::last_means_of_capture() const {
 void DebuggerCore::reset() {
 	threads_.clear();
 	waited_threads_.clear();
+	stepping_over_.clear();
+	pending_event_ = nullptr;
 	pid_           = 0;
 	active_thread_ = 0;
 	binary_info_   = nullptr;
+	debug_registers_.fill(0);
+	clear_conditions();
+	clear_trace_log();
 }
 
 //------------------------------------------------------------------------------
@@ -21,9 +21,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QObject>
 #include "DebuggerCoreUNIX.h"
+#include "TidSet.h"
 #include <QHash>
+#include <QLoggingCategory>
 #include <QSet>
 #include <csignal>
+#include <vector>
 #include <unistd.h>
 
 class IBinary;
@@ -31,6 +34,11 @@ class Status;
 
 namespace DebuggerCorePlugin {
 
+// slow thread stops and resumes are reported here, enable it with
+// QT_LOGGING_RULES="edb.debugger.timing.debug=true"
+Q_DECLARE_LOGGING_CATEGORY(DebuggerTiming)
+
+class DebugEventWaiter;
 class PlatformThread;
 
 class DebuggerCore : public DebuggerCoreUNIX {
@@ -40,6 +48,7 @@ class DebuggerCore : public DebuggerCoreUNIX {
 	Q_CLASSINFO("author", "Evan Teran")
 	Q_CLASSINFO("url", "http://www.codef00.com")
 	friend class PlatformProcess;
+	friend class PlatformState;
 	friend class PlatformThread;
 
 	CPUMode cpu_mode() const override { return cpu_mode_; }
@@ -52,6 +61,7 @@ public:
 	edb::address_t page_size() const override;
 	bool has_extension(quint64 ext) const override;
 	std::shared_ptr<IDebugEvent> wait_debug_event(int msecs) override;
+	int debug_event_fd() const override;
 	Status attach(edb::pid_t pid) override;
 	Status detach() override;
 	void kill() override;
@@ -60,6 +70,11 @@ public:
 	Status open(const QString &path, const QString &cwd, const QList<QByteArray> &args, const QString &tty) override;
     MeansOfCapture last_means_of_capture() const override;
 
+public:
+	std::shared_ptr<IDebugEvent> trace_run(const TraceOptions &options) override;
+	std::vector<TraceEntry> trace_log() const override;
+	void clear_trace_log() override;
+
 public:
 	edb::pid_t parent_pid(edb::pid_t pid) const override;
 
@@ -96,17 +111,28 @@ private:
 	void reset();
 	Status stop_threads();
 	std::shared_ptr<IDebugEvent> handle_event(edb::tid_t tid, int status);
+	std::shared_ptr<IDebugEvent> reap_debug_event(edb::tid_t tid);
 	void handle_thread_exit(edb::tid_t tid, int status);
+	std::shared_ptr<PlatformThread> add_thread(edb::tid_t tid, int status);
 	int attach_thread(edb::tid_t tid);
+	bool wait_trace_step(edb::tid_t tid, int *status);
+	bool skip_false_condition(edb::tid_t tid, int *status);
+	bool finish_step_over(edb::tid_t tid, int status);
+	bool is_trace_trap(edb::tid_t tid, int status, siginfo_t *siginfo = nullptr);
+	void resume_waited_threads();
     void detectCPUMode();
     long ptraceOptions() const;
 
 private:
 	typedef QHash<edb::tid_t, std::shared_ptr<PlatformThread>> threadmap_t;
 
+	// stopping or resuming every thread taking longer than this (in ns) is logged
+	static constexpr qint64 SlowStopThreshold = 5000000;
+
 private:
 	threadmap_t              threads_;
-	QSet<edb::tid_t>         waited_threads_;
+	TidSet                   waited_threads_;
+	QHash<edb::tid_t, std::shared_ptr<IBreakpoint>> stepping_over_; // breakpoints kept disabled until the thread stepping over them stops
 	edb::tid_t               active_thread_;
 	std::unique_ptr<IBinary> binary_info_;
 	IProcess                *process_;
@@ -122,6 +148,14 @@ private:
 	bool                     proc_mem_write_broken_;
 	bool                     proc_mem_read_broken_;
 	CPUMode					 cpu_mode_=CPUMode::Unknown;
+	quint64                  stop_epoch_ = 0;
+	qint64                   stop_nsecs_   = 0; // how long stopping every thread took for the last event
+	qint64                   resume_nsecs_ = 0; // how long the last resume of every thread took
+	std::shared_ptr<IDebugEvent> pending_event_;
+	std::unique_ptr<DebugEventWaiter> waiter_;
+	std::vector<TraceEntry>  trace_log_;
+	std::size_t              trace_head_ = 0;
+	std::size_t              trace_size_ = 0;
 };
 
 }
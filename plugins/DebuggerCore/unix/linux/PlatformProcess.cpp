@@ -34,13 +34,20 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QFileInfo>
 #include <QTextStream>
 #include <QDateTime>
+#include <QElapsedTimer>
 
-#include <boost/functional/hash.hpp>
-#include <fstream>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
 
 #include <sys/mman.h>
 #include <sys/ptrace.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <fcntl.h>
 #include <unistd.h>
 #include <pwd.h>
 #include <elf.h>
@@ -51,6 +58,12 @@ namespace {
 // Used as size of ptrace word
 #define EDB_WORDSIZE sizeof(long)
 
+// reads larger than this bypass the page cache
+constexpr std::size_t PageCacheMaxSpan = 0x4000;
+
+// upper bound on the number of pages the page cache will hold
+constexpr std::size_t PageCacheMaxPages = 1024;
+
 void set_ok(bool &ok, long value) {
 	ok = (value != -1) || (errno == 0);
 }
@@ -193,7 +206,7 @@ QList<Module> loaded_modules_(const IProcess* process, const std::unique_ptr<IBi
 // Name: PlatformProcess
 // Desc:
 //------------------------------------------------------------------------------
-PlatformProcess::PlatformProcess(DebuggerCore *core, edb::pid_t pid) : core_(core), pid_(pid), ro_mem_file_(0), rw_mem_file_(0) {
+PlatformProcess::PlatformProcess(DebuggerCore *core, edb::pid_t pid) : core_(core), pid_(pid), ro_mem_file_(0), rw_mem_file_(0), vm_readv_broken_(false), page_cache_epoch_(0), page_cache_hits_(0), page_cache_misses_(0) {
 	if (!core_->proc_mem_read_broken_) {
 		QFile* memory_file = new QFile(QString("/proc/%1/mem").arg(pid_));
 		auto flags = QIODevice::ReadOnly | QIODevice::Unbuffered;
@@ -245,81 +258,407 @@ void seek_addr(QFile& file, edb::address_t address) {
 // Note: if the read is short, only the first <N> bytes are defined
 //------------------------------------------------------------------------------
 std::size_t PlatformProcess::read_bytes(edb::address_t address, void* buf, std::size_t len) const {
-	quint64 read = 0;
 
 	Q_ASSERT(buf);
 	Q_ASSERT(core_->process_ == this);
 
-	auto ptr = reinterpret_cast<char *>(buf);
+	if(len == 0) {
+		return 0;
+	}
 
-	if(len != 0) {
+	// small reads take the fast path
+	if(len == 1) {
+		auto it = core_->breakpoints_.find(address);
+		if(it != core_->breakpoints_.end()) {
+			*reinterpret_cast<char *>(buf) = (*it)->original_bytes()[0];
+			return 1;
+		}
+	}
 
-		// small reads take the fast path
-		if(len == 1) {
+	ReadSpan span = { address, buf, len, 0 };
+	return read_spans(&span, 1);
+}
 
-			auto it = core_->breakpoints_.find(address);
-			if(it != core_->breakpoints_.end()) {
-				*ptr = (*it)->original_bytes()[0];
-				return 1;
-			}
+//------------------------------------------------------------------------------
+// Name: read_spans
+// Desc: reads each of the <count> spans in <spans>, batching them into as few
+//       system calls as possible
+// Note: returns the total number of bytes read, the number of bytes read for
+//       each individual span is stored in its <bytes_read> field, so a span
+//       which could not be read does not prevent the others from being read
+//------------------------------------------------------------------------------
+std::size_t PlatformProcess::read_spans(ReadSpan *spans, std::size_t count) const {
 
-			if(ro_mem_file_) {
-				seek_addr(*ro_mem_file_, address);
-				read = ro_mem_file_->read(ptr, 1);
-				if (read == 1) {
-					return 1;
-				}
-				return 0;
+	Q_ASSERT(spans || count == 0);
+	Q_ASSERT(core_->process_ == this);
+
+	for(std::size_t i = 0; i < count; ++i) {
+		Q_ASSERT(spans[i].buffer || spans[i].length == 0);
+		spans[i].bytes_read = 0;
+	}
+
+	QMutexLocker locker(&page_cache_mutex_);
+
+	// the cache is only good for as long as the debuggee stays stopped
+	if(page_cache_epoch_ != core_->stop_epoch_) {
+		page_cache_.clear();
+		page_cache_epoch_ = core_->stop_epoch_;
+	}
+
+	const edb::address_t page_size = core_->page_size();
+	const quint64        page_mask = ~(page_size - 1);
+
+	// small reads are served from the page cache, so first figure out which of
+	// the pages they need aren't cached yet and fetch those all in one go.
+	// large reads bypass the cache entirely
+	std::vector<edb::address_t> missing;
+	std::vector<ReadSpan>       uncached;
+	std::vector<std::size_t>    uncached_index;
+
+	for(std::size_t i = 0; i < count; ++i) {
+		const ReadSpan &span = spans[i];
+
+		if(span.length == 0) {
+			continue;
+		}
+
+		if(span.length > PageCacheMaxSpan) {
+			uncached.push_back(span);
+			uncached_index.push_back(i);
+			continue;
+		}
+
+		const edb::address_t first_page = span.address & page_mask;
+		const edb::address_t last_page  = (span.address + (span.length - 1)) & page_mask;
+		for(edb::address_t page = first_page; ; page += page_size) {
+			if(page_cache_.contains(page)) {
+				++page_cache_hits_;
 			} else {
-				bool ok;
-				quint8 x = read_byte_via_ptrace(address, &ok);
-				if(ok) {
-					*ptr = x;
-					return 1;
+				missing.push_back(page);
+			}
+
+			if(page == last_page) {
+				break;
+			}
+		}
+	}
+
+	if(!missing.empty()) {
+		std::sort(missing.begin(), missing.end());
+		missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+		page_cache_misses_ += missing.size();
+		fill_page_cache(missing);
+	}
+
+	if(!uncached.empty()) {
+		if(!vm_readv_broken_) {
+			read_spans_via_vm_readv(uncached.data(), uncached.size());
+		}
+
+		for(std::size_t i = 0; i < uncached.size(); ++i) {
+			ReadSpan &span = uncached[i];
+
+			// process_vm_readv honors page protections where /proc/<pid>/mem and
+			// ptrace do not, so give anything it came up short on a second chance
+			if(span.bytes_read < span.length) {
+				auto ptr = reinterpret_cast<char *>(span.buffer) + span.bytes_read;
+				const edb::address_t address = span.address + span.bytes_read;
+				const std::size_t remaining  = span.length - span.bytes_read;
+
+				if(ro_mem_file_) {
+					span.bytes_read += read_via_mem_file(address, ptr, remaining);
+				} else {
+					span.bytes_read += read_via_ptrace(address, ptr, remaining);
 				}
-				return 0;
 			}
+
+			spans[uncached_index[i]].bytes_read = span.bytes_read;
+		}
+	}
+
+	std::size_t total = 0;
+	for(std::size_t i = 0; i < count; ++i) {
+		ReadSpan &span = spans[i];
+
+		if(span.length != 0 && span.length <= PageCacheMaxSpan) {
+			span.bytes_read = read_from_page_cache(span.address, span.buffer, span.length);
 		}
 
-		if(ro_mem_file_) {
-			seek_addr(*ro_mem_file_, address);
-			read = ro_mem_file_->read(ptr, len);
-			if(read == 0 || read == quint64(-1)) {
-				return 0;
+		// show the original bytes in the buffer..
+		mask_breakpoints(span.address, span.buffer, span.bytes_read);
+		total += span.bytes_read;
+	}
+
+	return total;
+}
+
+//------------------------------------------------------------------------------
+// Name: fill_page_cache
+// Desc: reads the given (sorted, page aligned) <pages> into the page cache.
+//       Pages which can't be read in full are simply not cached
+//------------------------------------------------------------------------------
+void PlatformProcess::fill_page_cache(const std::vector<edb::address_t> &pages) const {
+
+	const std::size_t page_size = core_->page_size();
+
+	// keep the cache bounded, once it gets too large just start over
+	if(static_cast<std::size_t>(page_cache_.size()) + pages.size() > PageCacheMaxPages) {
+		page_cache_.clear();
+	}
+
+	std::vector<QByteArray> buffers;
+	std::vector<ReadSpan>   page_spans;
+	buffers.reserve(pages.size());
+	page_spans.reserve(pages.size());
+
+	for(const edb::address_t page : pages) {
+		buffers.push_back(QByteArray(static_cast<int>(page_size), 0));
+		page_spans.push_back({ page, buffers.back().data(), page_size, 0 });
+	}
+
+	if(!vm_readv_broken_) {
+		read_spans_via_vm_readv(page_spans.data(), page_spans.size());
+	}
+
+	for(std::size_t i = 0; i < page_spans.size(); ++i) {
+		ReadSpan &span = page_spans[i];
+
+		if(span.bytes_read != page_size) {
+			auto ptr = reinterpret_cast<char *>(span.buffer);
+			if(ro_mem_file_) {
+				span.bytes_read = read_via_mem_file(span.address, ptr, page_size);
+			} else {
+				span.bytes_read = read_via_ptrace(span.address, ptr, page_size);
 			}
-		} else {
-			for(std::size_t index = 0; index < len; ++index) {
+		}
 
-				// read a byte, if we failed, we are done
-				bool ok;
-				const quint8 x = read_byte_via_ptrace(address + index, &ok);
-				if(!ok) {
-					break;
-				}
+		if(span.bytes_read == page_size) {
+			page_cache_.insert(span.address, buffers[i]);
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: read_from_page_cache
+// Desc: copies up to <len> bytes at <address> out of the page cache, stopping
+//       at the first page which is not cached
+// Note: returns the number of bytes copied
+//------------------------------------------------------------------------------
+std::size_t PlatformProcess::read_from_page_cache(edb::address_t address, void *buf, std::size_t len) const {
+
+	const edb::address_t page_size = core_->page_size();
+	const quint64        page_mask = ~(page_size - 1);
+
+	auto ptr = reinterpret_cast<char *>(buf);
+	std::size_t read = 0;
+
+	while(read < len) {
+		const edb::address_t current = address + read;
+		const edb::address_t page    = current & page_mask;
+
+		auto it = page_cache_.find(page);
+		if(it == page_cache_.end()) {
+			break;
+		}
+
+		const std::size_t offset = current - page;
+		const std::size_t amount = std::min<std::size_t>(len - read, page_size - offset);
+		std::memcpy(ptr + read, it->constData() + offset, amount);
+		read += amount;
+	}
+
+	return read;
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate_page_cache
+// Desc: discards everything in the page cache
+//------------------------------------------------------------------------------
+void PlatformProcess::invalidate_page_cache() {
+	QMutexLocker locker(&page_cache_mutex_);
+	page_cache_.clear();
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate_page_cache
+// Desc: discards any cached pages overlapping the <len> bytes at <address>
+//------------------------------------------------------------------------------
+void PlatformProcess::invalidate_page_cache(edb::address_t address, std::size_t len) {
+	QMutexLocker locker(&page_cache_mutex_);
+	remove_cached_pages(address, len);
+}
+
+//------------------------------------------------------------------------------
+// Name: remove_cached_pages
+// Desc: discards any cached pages overlapping the <len> bytes at <address>
+// Note: page_cache_mutex_ must be held
+//------------------------------------------------------------------------------
+void PlatformProcess::remove_cached_pages(edb::address_t address, std::size_t len) {
+
+	if(len == 0 || page_cache_.isEmpty()) {
+		return;
+	}
+
+	const edb::address_t page_size  = core_->page_size();
+	const quint64        page_mask  = ~(page_size - 1);
+	const edb::address_t first_page = address & page_mask;
+	const edb::address_t last_page  = (address + (len - 1)) & page_mask;
+
+	for(edb::address_t page = first_page; ; page += page_size) {
+		page_cache_.remove(page);
+		if(page == last_page) {
+			break;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: read_spans_via_vm_readv
+// Desc: reads as much of <spans> as possible using process_vm_readv, one
+//       system call per IOV_MAX spans as long as no span faults
+// Note: spans which fault are left short, the caller is expected to retry them
+//       using another method
+//------------------------------------------------------------------------------
+std::size_t PlatformProcess::read_spans_via_vm_readv(ReadSpan *spans, std::size_t count) const {
 
-				// store it
-				reinterpret_cast<char*>(buf)[index] = x;
+	std::size_t total = 0;
+	std::size_t first = 0;
 
-				++read;
+	std::vector<struct iovec> local;
+	std::vector<struct iovec> remote;
+
+	while(first < count) {
+
+		local.clear();
+		remote.clear();
+
+		std::size_t last = first;
+		while(last < count && remote.size() < static_cast<std::size_t>(IOV_MAX)) {
+			const ReadSpan &span = spans[last];
+
+			// 32 bit edb can't address memory beyond 4GiB
+			if(EDB_IS_32_BIT && (span.address + span.length) > 0xffffffffULL) {
+				break;
+			}
+
+			if(span.length != 0) {
+				local.push_back({ span.buffer, span.length });
+				remote.push_back({ reinterpret_cast<void *>(span.address.toUint()), span.length });
 			}
+			++last;
 		}
 
-		// replace any breakpoints
-		Q_FOREACH(const std::shared_ptr<IBreakpoint> &bp, core_->breakpoints_) {
-			auto*const bpBytes=bp->original_bytes();
-			const auto bpAddr=bp->address();
-			// show the original bytes in the buffer..
-			for(size_t i=0; i < bp->size(); ++i) {
-				if(bpAddr + i >= address && bpAddr + i < address + read) {
-					ptr[bpAddr + i - address] = bpBytes[i];
+		if(last == first) {
+			// the span at <first> is unreachable this way, skip it
+			++first;
+			continue;
+		}
+
+		ssize_t n = 0;
+		if(!remote.empty()) {
+			n = ::process_vm_readv(pid_, local.data(), local.size(), remote.data(), remote.size(), 0);
+			if(n == -1) {
+				if(errno == ENOSYS || errno == EPERM) {
+					// either the kernel doesn't support it, or we aren't allowed to
+					// use it. Either way, there is no point in trying it again
+					vm_readv_broken_ = true;
+					return total;
 				}
+
+				// the first byte of the first non-empty span faulted
+				n = 0;
+			}
+		}
+
+		total += n;
+
+		// distribute what was read amongst the spans, stopping at the
+		// first span which came up short, everything after it needs retrying
+		std::size_t i = first;
+		for(; i < last; ++i) {
+			ReadSpan &span = spans[i];
+			const std::size_t amount = std::min<std::size_t>(n, span.length);
+			span.bytes_read = amount;
+			n -= amount;
+			if(amount != span.length) {
+				break;
 			}
 		}
+
+		first = (i < last) ? i + 1 : last;
+	}
+
+	return total;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_via_mem_file
+// Desc: reads <len> bytes at <address> using /proc/<pid>/mem
+//------------------------------------------------------------------------------
+std::size_t PlatformProcess::read_via_mem_file(edb::address_t address, void *buf, std::size_t len) const {
+
+	Q_ASSERT(ro_mem_file_);
+
+	if(address <= UINT64_MAX/2) {
+		// pread doesn't disturb the shared file position
+		const ssize_t n = ::pread64(ro_mem_file_->handle(), buf, len, static_cast<off64_t>(address.toUint()));
+		return n > 0 ? n : 0;
 	}
 
+	seek_addr(*ro_mem_file_, address);
+	const quint64 read = ro_mem_file_->read(reinterpret_cast<char *>(buf), len);
+	if(read == 0 || read == quint64(-1)) {
+		return 0;
+	}
 	return read;
 }
 
+//------------------------------------------------------------------------------
+// Name: read_via_ptrace
+// Desc: reads <len> bytes at <address> using ptrace, this is the slowest
+//       method and only used when /proc/<pid>/mem is not usable
+//------------------------------------------------------------------------------
+std::size_t PlatformProcess::read_via_ptrace(edb::address_t address, void *buf, std::size_t len) const {
+
+	std::size_t read = 0;
+	for(std::size_t index = 0; index < len; ++index) {
+
+		// read a byte, if we failed, we are done
+		bool ok;
+		const quint8 x = read_byte_via_ptrace(address + index, &ok);
+		if(!ok) {
+			break;
+		}
+
+		// store it
+		reinterpret_cast<char*>(buf)[index] = x;
+
+		++read;
+	}
+
+	return read;
+}
+
+//------------------------------------------------------------------------------
+// Name: mask_breakpoints
+// Desc: replaces any breakpoint bytes in the <len> bytes of <buf>, which were
+//       read from <address>, with the original bytes of the debuggee
+//------------------------------------------------------------------------------
+void PlatformProcess::mask_breakpoints(edb::address_t address, void *buf, std::size_t len) const {
+
+	auto ptr = reinterpret_cast<char *>(buf);
+
+	for(const std::shared_ptr<IBreakpoint> &bp : core_->overlapping_breakpoints(address, len)) {
+		auto*const bpBytes=bp->original_bytes();
+		const auto bpAddr=bp->address();
+		for(size_t i=0; i < bp->size(); ++i) {
+			if(bpAddr + i >= address && bpAddr + i < address + len) {
+				ptr[bpAddr + i - address] = bpBytes[i];
+			}
+		}
+	}
+}
+
 //------------------------------------------------------------------------------
 // Name: patch_bytes
 // Desc: same as write_bytes, except that it also records the original data
@@ -359,12 +698,16 @@ std::size_t PlatformProcess::write_bytes(edb::address_t address, const void *buf
 	Q_ASSERT(buf);
 	Q_ASSERT(core_->process_ == this);
 
+	// the lock is held until the affected pages are dropped from the cache, so
+	// that no reader can put the old bytes back in between
+	QMutexLocker locker(&page_cache_mutex_);
+
 	if(len != 0) {
 		if(rw_mem_file_) {
 			seek_addr(*rw_mem_file_,address);
 			written = rw_mem_file_->write(reinterpret_cast<const char *>(buf), len);
-			if(written == 0 || written == quint64(-1)) {
-				return 0;
+			if(written == quint64(-1)) {
+				written = 0;
 			}
 		}
 		else {
@@ -372,12 +715,13 @@ std::size_t PlatformProcess::write_bytes(edb::address_t address, const void *buf
 			for(std::size_t byteIndex=0;byteIndex<len;++byteIndex) {
 				bool ok=false;
 				write_byte_via_ptrace(address+byteIndex, *(reinterpret_cast<const char*>(buf)+byteIndex), &ok);
-				if(!ok) return written;
+				if(!ok) break;
 				++written;
 			}
 		}
 	}
 
+	remove_cached_pages(address, len);
 	return written;
 }
 
@@ -509,45 +853,123 @@ edb::address_t PlatformProcess::data_address() const {
 // Desc:
 //------------------------------------------------------------------------------
 QList<std::shared_ptr<IRegion>> PlatformProcess::regions() const {
-	static QList<std::shared_ptr<IRegion>> regions;
-	static size_t totalHash = 0;
 
-	const QString map_file(QString("/proc/%1/maps").arg(pid_));
+	if(!read_maps_file(&maps_buffer_)) {
+		maps_snapshot_.clear();
+		maps_lines_.clear();
+		regions_.clear();
+		return regions_;
+	}
+
+	// by far the most common case, nothing changed since last time
+	if(maps_buffer_ == maps_snapshot_) {
+		return regions_;
+	}
+
+	// it changed, so let's diff it against what we had. Both the old and the
+	// new maps are sorted by start address, so a single merge pass finds the
+	// lines which are unchanged, and their regions can be kept as is
+	QList<std::shared_ptr<IRegion>> regions;
+	std::vector<MapsLine>           lines;
+	regions.reserve(regions_.size());
+	lines.reserve(maps_lines_.size());
+
+	const char *const data = maps_buffer_.constData();
+	const int         size = maps_buffer_.size();
+
+	std::size_t old_index = 0;
+	int offset = 0;
 
-	// hash the region file to see if it changed or not
-	{
-		std::ifstream mf(map_file.toStdString());
-		size_t newHash = 0;
-		std::string line;
+	while(offset < size) {
+		const char *const line = data + offset;
+		const auto newline     = static_cast<const char *>(std::memchr(line, '\n', size - offset));
+		const int length       = newline ? static_cast<int>(newline - line) : (size - offset);
 
-		while(std::getline(mf,line)) {
-			boost::hash_combine(newHash, line);
+		const int line_offset = offset;
+		offset += length + 1;
+
+		char *last;
+		const edb::address_t start = std::strtoull(line, &last, 16);
+		if(last == line || *last != '-') {
+			continue;
+		}
+
+		// anything before this line in the old snapshot is gone now
+		while(old_index < maps_lines_.size() && maps_lines_[old_index].start < start) {
+			++old_index;
 		}
 
-		if(totalHash == newHash) {
-			return regions;
+		std::shared_ptr<IRegion> region;
+
+		if(old_index < maps_lines_.size()) {
+			const MapsLine &old_line = maps_lines_[old_index];
+			if(old_line.start == start && old_line.length == length && std::memcmp(maps_snapshot_.constData() + old_line.offset, line, length) == 0) {
+				region = regions_[static_cast<int>(old_index)];
+				++old_index;
+			}
 		}
 
-		totalHash = newHash;
-		regions.clear();
+		if(!region) {
+			region = process_map_line(QString::fromLocal8Bit(line, length));
+		}
+
+		if(region) {
+			regions.push_back(region);
+			lines.push_back({ start, line_offset, length });
+		}
 	}
 
-	// it changed, so let's process it
-	QFile file(map_file);
-    if(file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+	// keep the old snapshot's storage around to read into next time
+	qSwap(maps_snapshot_, maps_buffer_);
+	maps_lines_ = std::move(lines);
+	regions_    = regions;
 
-		QTextStream in(&file);
-		QString line = in.readLine();
+	return regions_;
+}
 
-		while(!line.isNull()) {
-			if(std::shared_ptr<IRegion> region = process_map_line(line)) {
-				regions.push_back(region);
-			}
-			line = in.readLine();
+//------------------------------------------------------------------------------
+// Name: read_maps_file
+// Desc: reads the entire /proc/<pid>/maps file into <buffer>, reusing
+//       whatever storage <buffer> already has
+//------------------------------------------------------------------------------
+bool PlatformProcess::read_maps_file(QByteArray *buffer) const {
+
+	Q_ASSERT(buffer);
+
+	const QByteArray map_file = QString("/proc/%1/maps").arg(pid_).toLatin1();
+
+	const int fd = ::open(map_file.constData(), O_RDONLY | O_CLOEXEC);
+	if(fd == -1) {
+		return false;
+	}
+
+	if(buffer->capacity() < 0x10000) {
+		buffer->reserve(0x10000);
+	}
+
+	int size = 0;
+	for(;;) {
+		if(buffer->capacity() - size < 0x1000) {
+			buffer->reserve(buffer->capacity() * 2);
+		}
+
+		buffer->resize(buffer->capacity());
+
+		const ssize_t n = ::read(fd, buffer->data() + size, buffer->size() - size);
+		if(n == -1 && errno == EINTR) {
+			continue;
+		}
+
+		if(n <= 0) {
+			break;
 		}
+
+		size += n;
 	}
 
-	return regions;
+	::close(fd);
+	buffer->resize(size);
+	return true;
 }
 
 //------------------------------------------------------------------------------
@@ -784,6 +1206,9 @@ Status PlatformProcess::resume(edb::EVENT_STATUS status) {
 	// TODO: assert that we are paused
 	Q_ASSERT(core_->process_ == this);
 
+	QElapsedTimer timer;
+	timer.start();
+
 	QString errorMessage;
 
 	if(status != edb::DEBUG_STOP) {
@@ -792,14 +1217,23 @@ Status PlatformProcess::resume(edb::EVENT_STATUS status) {
 			if(!resumeStatus)
 				errorMessage+=QObject::tr("Failed to resume thread %1: %2\n").arg(thread->tid()).arg(resumeStatus.toString());
 
-			// resume the other threads passing the signal they originally reported had
-			for(auto &other_thread : threads()) {
-				if(core_->waited_threads_.contains(other_thread->tid())) {
-					const auto resumeStatus=other_thread->resume();
+			// resume the other threads passing the signal they originally reported had.
+			// going from the highest tid down means each one comes off the end of
+			// the wait list
+			const TidSet waited = core_->waited_threads_;
+			for(auto it = waited.rbegin(); it != waited.rend(); ++it) {
+				auto other_thread = core_->threads_.find(*it);
+				if(other_thread != core_->threads_.end()) {
+					const auto resumeStatus=other_thread.value()->resume();
 					if(!resumeStatus)
-						errorMessage+=QObject::tr("Failed to resume thread %1: %2\n").arg(thread->tid()).arg(resumeStatus.toString());
+						errorMessage+=QObject::tr("Failed to resume thread %1: %2\n").arg(*it).arg(resumeStatus.toString());
 				}
 			}
+
+			core_->resume_nsecs_ = timer.nsecsElapsed();
+			if(core_->resume_nsecs_ >= DebuggerCore::SlowStopThreshold) {
+				qCDebug(DebuggerTiming, "resuming %d threads took %lld us", static_cast<int>(waited.size()), core_->resume_nsecs_ / 1000);
+			}
 		}
 	}
 	if(errorMessage.isEmpty())
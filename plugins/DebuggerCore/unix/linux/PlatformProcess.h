@@ -22,7 +22,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IProcess.h"
 #include "Status.h"
 
+#include <QByteArray>
 #include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <atomic>
+#include <vector>
 
 namespace DebuggerCorePlugin {
 
@@ -67,13 +72,28 @@ public:
 	std::size_t patch_bytes(edb::address_t address, const void *buf, size_t len) override;
 	std::size_t read_bytes(edb::address_t address, void *buf, size_t len) const override;
 	std::size_t read_pages(edb::address_t address, void *buf, size_t count) const override;
+	std::size_t read_spans(ReadSpan *spans, size_t count) const override;
 	QMap<edb::address_t, Patch> patches() const override;
 
+public:
+	void invalidate_page_cache();
+	void invalidate_page_cache(edb::address_t address, size_t len);
+	quint64 page_cache_hits() const   { return page_cache_hits_; }
+	quint64 page_cache_misses() const { return page_cache_misses_; }
+
 private:
 	bool ptrace_poke(edb::address_t address, long value);
 	long ptrace_peek(edb::address_t address, bool *ok) const;
 	quint8 read_byte_via_ptrace(edb::address_t address, bool *ok) const;
 	void write_byte_via_ptrace(edb::address_t address, quint8 value, bool *ok);
+	std::size_t read_spans_via_vm_readv(ReadSpan *spans, size_t count) const;
+	std::size_t read_via_mem_file(edb::address_t address, void *buf, size_t len) const;
+	std::size_t read_via_ptrace(edb::address_t address, void *buf, size_t len) const;
+	void mask_breakpoints(edb::address_t address, void *buf, size_t len) const;
+	void fill_page_cache(const std::vector<edb::address_t> &pages) const;
+	void remove_cached_pages(edb::address_t address, size_t len);
+	bool read_maps_file(QByteArray *buffer) const;
+	std::size_t read_from_page_cache(edb::address_t address, void *buf, size_t len) const;
 
 private:
 	DebuggerCore*               core_;
@@ -81,6 +101,33 @@ private:
 	QFile*                      ro_mem_file_;
 	QFile*                      rw_mem_file_;
 	QMap<edb::address_t, Patch> patches_;
+	mutable bool                vm_readv_broken_;
+
+private:
+	// raw (breakpoints not masked) page contents, only valid for a single stop.
+	// Reads can come from worker threads (the analyzer for one), so the cache
+	// and the memory file are only touched with page_cache_mutex_ held
+	mutable QHash<edb::address_t, QByteArray> page_cache_;
+	mutable quint64                           page_cache_epoch_;
+	mutable QMutex                            page_cache_mutex_;
+
+	// pages served from the cache and pages which had to be read, counted
+	// for as long as the process is attached
+	mutable std::atomic<quint64>              page_cache_hits_;
+	mutable std::atomic<quint64>              page_cache_misses_;
+
+private:
+	// where in maps_snapshot_ the line describing each of regions_ lives
+	struct MapsLine {
+		edb::address_t start;
+		int            offset;
+		int            length;
+	};
+
+	mutable QByteArray                      maps_buffer_;
+	mutable QByteArray                      maps_snapshot_;
+	mutable std::vector<MapsLine>           maps_lines_;
+	mutable QList<std::shared_ptr<IRegion>> regions_;
 };
 
 }
@@ -21,6 +21,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "IThread.h"
 #include "IBreakpoint.h"
+#include "IState.h"
 #include <memory>
 #include <QCoreApplication>
 
@@ -70,6 +71,27 @@ public:
 public:
 	bool isPaused() const override;
 
+#if defined EDB_X86 || defined EDB_X86_64
+public:
+	enum RegisterClass {
+		GeneralRegisters = 0x01,
+		FPURegisters     = 0x02,
+		DebugRegisters   = 0x04,
+		AllRegisters     = GeneralRegisters | FPURegisters | DebugRegisters
+	};
+
+public:
+	void get_state(State *state, int classes);
+	void load_state(PlatformState *state, int classes);
+	void invalidate_state_cache();
+
+private:
+	PlatformState *cached_state(int classes);
+	void fetch_general_registers(PlatformState *state);
+	void fetch_fpu_registers(PlatformState *state);
+	void fetch_debug_registers(PlatformState *state);
+#endif
+
 private:
 	void fillSegmentBases(PlatformState* state);
 	bool fillStateFromPrStatus(PlatformState* state);
@@ -89,6 +111,19 @@ private:
 	int                 status_;
 	SignalStatus        signal_status_;
 
+#if defined EDB_X86 || defined EDB_X86_64
+private:
+	static constexpr quint64 InvalidEpoch = ~quint64(0);
+
+	// register classes fetched during the current stop; each class remembers
+	// the stop epoch it was fetched in, so that a resume implicitly drops it
+	std::unique_ptr<IState> state_cache_;
+	quint64                 general_epoch_       = InvalidEpoch;
+	quint64                 fpu_epoch_           = InvalidEpoch;
+	quint64                 debug_epoch_         = InvalidEpoch;
+	bool                    debug_control_valid_ = false;
+#endif
+
 #if defined EDB_ARM32 || defined EDB_ARM64
 private:
 	Status doStep(edb::tid_t tid, long status);
@@ -0,0 +1,73 @@
+/*
+Copyright (C) 2017 - 2017 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef TID_SET_H_
+#define TID_SET_H_
+
+#include "OSTypes.h"
+#include <algorithm>
+#include <vector>
+
+namespace DebuggerCorePlugin {
+
+// A set of thread ids kept as a sorted array. Every debug event touches it
+// once per thread, so it is a single contiguous allocation which is searched
+// with a binary search. Removing the largest id is constant time, which is
+// what resuming everything in descending order relies on
+class TidSet {
+public:
+	using const_iterator         = std::vector<edb::tid_t>::const_iterator;
+	using const_reverse_iterator = std::vector<edb::tid_t>::const_reverse_iterator;
+
+public:
+	bool contains(edb::tid_t tid) const {
+		return std::binary_search(tids_.begin(), tids_.end(), tid);
+	}
+
+	void insert(edb::tid_t tid) {
+		auto it = std::lower_bound(tids_.begin(), tids_.end(), tid);
+		if(it == tids_.end() || *it != tid) {
+			tids_.insert(it, tid);
+		}
+	}
+
+	void remove(edb::tid_t tid) {
+		auto it = std::lower_bound(tids_.begin(), tids_.end(), tid);
+		if(it != tids_.end() && *it == tid) {
+			tids_.erase(it);
+		}
+	}
+
+	void clear()                  { tids_.clear(); }
+	void reserve(std::size_t n)   { tids_.reserve(n); }
+	bool empty() const            { return tids_.empty(); }
+	std::size_t size() const      { return tids_.size(); }
+
+public:
+	const_iterator begin() const          { return tids_.begin(); }
+	const_iterator end() const            { return tids_.end(); }
+	const_reverse_iterator rbegin() const { return tids_.rbegin(); }
+	const_reverse_iterator rend() const   { return tids_.rend(); }
+
+private:
+	std::vector<edb::tid_t> tids_;
+};
+
+}
+
+#endif
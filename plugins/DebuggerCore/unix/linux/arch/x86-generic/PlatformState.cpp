@@ -17,7 +17,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "PlatformState.h"
+#include "DebuggerCore.h"
 #include "FloatX.h"
+#include "PlatformThread.h"
 #include "Util.h"
 #include <QDebug>
 #include <QRegExp>
@@ -908,6 +910,7 @@ Register PlatformState::value(const QString &reg) const {
 			return make_Register<16>(x86.IP16Name, x86.IP, Register::TYPE_IP);
 	}
 
+	load(PlatformThread::DebugRegisters);
 	if (x86.gpr32Filled) {
 		QRegExp DRx("^dr([0-7])$");
 		if (DRx.indexIn(regName) != -1) {
@@ -925,6 +928,7 @@ Register PlatformState::value(const QString &reg) const {
 		}
 	}
 
+	load(PlatformThread::FPURegisters);
 	if (x87.filled) {
 		QRegExp Rx("^r([0-7])$");
 		if (Rx.indexIn(regName) != -1) {
@@ -1073,6 +1077,7 @@ edb::address_t PlatformState::stack_pointer() const {
 //------------------------------------------------------------------------------
 edb::reg_t PlatformState::debug_register(size_t n) const {
 	assert(dbgIndexValid(n));
+	load(PlatformThread::DebugRegisters);
 	return x86.dbgRegs[n];
 }
 
@@ -1103,6 +1108,7 @@ edb::reg_t PlatformState::flags() const {
 // Desc:
 //------------------------------------------------------------------------------
 int PlatformState::fpu_stack_pointer() const {
+	load(PlatformThread::FPURegisters);
 	return x87.stackPointer();
 }
 
@@ -1112,6 +1118,7 @@ int PlatformState::fpu_stack_pointer() const {
 //------------------------------------------------------------------------------
 edb::value80 PlatformState::fpu_register(size_t n) const {
 	assert(fpuIndexValid(n));
+	load(PlatformThread::FPURegisters);
 
 	if (!x87.filled) {
 		edb::value80        v;
@@ -1131,6 +1138,7 @@ edb::value80 PlatformState::fpu_register(size_t n) const {
 // Desc: Returns true if Rn register is empty when treated in terms of FPU stack
 //------------------------------------------------------------------------------
 bool PlatformState::fpu_register_is_empty(size_t n) const {
+	load(PlatformThread::FPURegisters);
 	return x87.tag(n) == X87::TAG_EMPTY;
 }
 
@@ -1139,6 +1147,7 @@ bool PlatformState::fpu_register_is_empty(size_t n) const {
 // Desc:
 //------------------------------------------------------------------------------
 QString PlatformState::fpu_register_tag_string(size_t n) const {
+	load(PlatformThread::FPURegisters);
 	int tag = x87.tag(n);
 	static const std::unordered_map<int, QString> names{
 		{X87::TAG_VALID,   "Valid"},
@@ -1151,14 +1160,17 @@ QString PlatformState::fpu_register_tag_string(size_t n) const {
 }
 
 edb::value16 PlatformState::fpu_control_word() const {
+	load(PlatformThread::FPURegisters);
 	return x87.controlWord;
 }
 
 edb::value16 PlatformState::fpu_status_word() const {
+	load(PlatformThread::FPURegisters);
 	return x87.statusWord;
 }
 
 edb::value16 PlatformState::fpu_tag_word() const {
+	load(PlatformThread::FPURegisters);
 	return x87.tagWord;
 }
 
@@ -1168,6 +1180,7 @@ edb::value16 PlatformState::fpu_tag_word() const {
 //------------------------------------------------------------------------------
 void PlatformState::adjust_stack(int bytes) {
 	x86.GPRegs[X86::RSP] += bytes;
+	dirty_ |= PlatformThread::GeneralRegisters;
 }
 
 //------------------------------------------------------------------------------
@@ -1178,6 +1191,9 @@ void PlatformState::clear() {
 	x86.clear();
 	x87.clear();
 	avx.clear();
+	dirty_       = 0;
+	from_thread_ = false;
+	pending_     = 0;
 }
 
 //------------------------------------------------------------------------------
@@ -1185,7 +1201,34 @@ void PlatformState::clear() {
 // Desc:
 //------------------------------------------------------------------------------
 bool PlatformState::empty() const {
-	return x86.empty() && x87.empty() && avx.empty();
+	return x86.empty() && x87.empty() && avx.empty() && !pending_;
+}
+
+//------------------------------------------------------------------------------
+// Name: load
+// Desc: reads those of <classes> which are still pending from the thread the
+//       state came from. That is only possible as long as the thread hasn't
+//       run since, otherwise they stay unfilled. Returns the classes of
+//       <classes> which are unfilled because of that
+//------------------------------------------------------------------------------
+int PlatformState::load(int classes) const {
+
+	const int wanted = pending_ & classes;
+	if(!wanted) {
+		return 0;
+	}
+
+	pending_ &= ~wanted;
+
+	if(source_core_->process_ && source_core_->stop_epoch_ == source_epoch_) {
+		if(const std::shared_ptr<PlatformThread> thread = source_core_->threads_.value(source_tid_)) {
+			// the state was never const to begin with, only this view of it is
+			thread->load_state(const_cast<PlatformState *>(this), wanted);
+			return 0;
+		}
+	}
+
+	return wanted;
 }
 
 //------------------------------------------------------------------------------
@@ -1194,7 +1237,9 @@ bool PlatformState::empty() const {
 //------------------------------------------------------------------------------
 void PlatformState::set_debug_register(size_t n, edb::reg_t value) {
 	assert(dbgIndexValid(n));
+	load(PlatformThread::DebugRegisters);
 	x86.dbgRegs[n] = value;
+	dirty_ |= PlatformThread::DebugRegisters;
 }
 
 //------------------------------------------------------------------------------
@@ -1203,6 +1248,7 @@ void PlatformState::set_debug_register(size_t n, edb::reg_t value) {
 //------------------------------------------------------------------------------
 void PlatformState::set_flags(edb::reg_t flags) {
 	x86.flags = flags;
+	dirty_ |= PlatformThread::GeneralRegisters;
 }
 
 //------------------------------------------------------------------------------
@@ -1212,6 +1258,7 @@ void PlatformState::set_flags(edb::reg_t flags) {
 void PlatformState::set_instruction_pointer(edb::address_t value) {
 	x86.IP      = value;
 	x86.orig_ax = -1;
+	dirty_ |= PlatformThread::GeneralRegisters;
 }
 
 //------------------------------------------------------------------------------
@@ -1244,6 +1291,7 @@ void PlatformState::set_register(const Register &reg) {
 	if (GPRegNameFoundIter != gpr_end) {
 		size_t index = GPRegNameFoundIter - GPRegNames().begin();
 		x86.GPRegs[index] = reg.value<edb::value64>();
+		dirty_ |= PlatformThread::GeneralRegisters;
 		return;
 	}
 
@@ -1252,21 +1300,26 @@ void PlatformState::set_register(const Register &reg) {
 	if (segRegNameFoundIter != x86.segRegNames.end()) {
 		size_t index  = segRegNameFoundIter - x86.segRegNames.begin();
 		x86.segRegs[index] = reg.value<edb::seg_reg_t>();
+		dirty_ |= PlatformThread::GeneralRegisters;
 		return;
 	}
 
 	if (regName == IPName()) {
 		x86.IP = reg.value<edb::value64>();
+		dirty_ |= PlatformThread::GeneralRegisters;
 		return;
 	}
 
 	if (regName == flagsName()) {
 		x86.flags = reg.value<edb::value64>();
+		dirty_ |= PlatformThread::GeneralRegisters;
 		return;
 	}
 
+	load(PlatformThread::FPURegisters);
 	if (regName == avx.mxcsrName) {
 		avx.mxcsr = reg.value<edb::value32>();
+		dirty_ |= PlatformThread::FPURegisters;
 		return;
 	}
 
@@ -1282,6 +1335,7 @@ void PlatformState::set_register(const Register &reg) {
 			std::memcpy(&x87.R[i], &value, sizeof value);
 			const uint16_t RiUpper = 0xffff;
 			std::memcpy(reinterpret_cast<char *>(&x87.R[i]) + sizeof value, &RiUpper, sizeof RiUpper);
+			dirty_ |= PlatformThread::FPURegisters;
 			return;
 		}
 	}
@@ -1296,6 +1350,7 @@ void PlatformState::set_register(const Register &reg) {
 			assert(fpuIndexValid(i));
 			const auto value = reg.value<edb::value80>();
 			std::memcpy(&x87.R[i], &value, sizeof value);
+			dirty_ |= PlatformThread::FPURegisters;
 			return;
 		}
 	}
@@ -1310,6 +1365,7 @@ void PlatformState::set_register(const Register &reg) {
 			assert(fpuIndexValid(i));
 			const auto value = reg.value<edb::value80>();
 			std::memcpy(&x87.st(i), &value, sizeof value);
+			dirty_ |= PlatformThread::FPURegisters;
 			return;
 		}
 	}
@@ -1322,6 +1378,7 @@ void PlatformState::set_register(const Register &reg) {
 			size_t i = XMMx.cap(1).toInt(&indexReadOK);
 			assert(indexReadOK && xmmIndexValid(i));
 			std::memcpy(&avx.zmmStorage[i], &value, sizeof value);
+			dirty_ |= PlatformThread::FPURegisters;
 			return;
 
 		}
@@ -1335,37 +1392,44 @@ void PlatformState::set_register(const Register &reg) {
 			size_t i = YMMx.cap(1).toInt(&indexReadOK);
 			assert(indexReadOK && ymmIndexValid(i));
 			std::memcpy(&avx.zmmStorage[i], &value, sizeof value);
+			dirty_ |= PlatformThread::FPURegisters;
 			return;
 		}
 	}
 
 	if (regName == "ftr" || regName == "ftw") {
 		x87.tagWord = reg.value<edb::value16>();
+		dirty_ |= PlatformThread::FPURegisters;
 		return;
 	}
 
 	if (regName == "fsr" || regName == "fsw") {
 		x87.statusWord = reg.value<edb::value16>();
+		dirty_ |= PlatformThread::FPURegisters;
 		return;
 	}
 
 	if (regName == "fcr" || regName == "fcw") {
 		x87.controlWord = reg.value<edb::value16>();
+		dirty_ |= PlatformThread::FPURegisters;
 		return;
 	}
 
 	if (regName == "fis" || regName == "fds") {
 		(regName == "fis" ? x87.instPtrSelector : x87.dataPtrSelector) = reg.value<edb::value16>();
+		dirty_ |= PlatformThread::FPURegisters;
 		return;
 	}
 
 	if (regName == "fip" || regName == "fdp") {
 		(regName == "fip" ? x87.instPtrOffset : x87.dataPtrOffset) = reg.valueAsAddress();
+		dirty_ |= PlatformThread::FPURegisters;
 		return;
 	}
 
 	if (regName == "fopcode" || regName == "fop") {
 		x87.opCode = reg.value<edb::value16>();
+		dirty_ |= PlatformThread::FPURegisters;
 		return;
 	}
 
@@ -1377,7 +1441,9 @@ void PlatformState::set_register(const Register &reg) {
 			char digitChar = digit.toLatin1();
 			size_t i = digitChar - '0';
 			assert(dbgIndexValid(i));
+			load(PlatformThread::DebugRegisters);
 			x86.dbgRegs[i] = reg.valueAsAddress();
+			dirty_ |= PlatformThread::DebugRegisters;
 			return;
 		}
 	}
@@ -1400,6 +1466,7 @@ void PlatformState::set_register(const QString &name, edb::reg_t value) {
 // Desc:
 //------------------------------------------------------------------------------
 Register PlatformState::mmx_register(size_t n) const {
+	load(PlatformThread::FPURegisters);
 	if (!mmxIndexValid(n)) {
 		return Register();
 	}
@@ -1413,6 +1480,7 @@ Register PlatformState::mmx_register(size_t n) const {
 // Desc:
 //------------------------------------------------------------------------------
 Register PlatformState::xmm_register(size_t n) const {
+	load(PlatformThread::FPURegisters);
 	if (!xmmIndexValid(n) || !avx.xmmFilledIA32) {
 		return Register();
 	}
@@ -1430,6 +1498,7 @@ Register PlatformState::xmm_register(size_t n) const {
 // Desc:
 //------------------------------------------------------------------------------
 Register PlatformState::ymm_register(size_t n) const {
+	load(PlatformThread::FPURegisters);
 	if (!ymmIndexValid(n) || !avx.ymmFilled) {
 		return Register();
 	}
@@ -28,6 +28,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 namespace DebuggerCorePlugin {
 
+class DebuggerCore;
+
 using std::size_t;
 
 static constexpr size_t IA32_GPR_COUNT                  = 8;
@@ -514,6 +516,24 @@ private:
 	void fillStruct(UserFPRegsStructX86_64 &regs) const;
 	void fillStruct(UserFPXRegsStructX86 &regs) const;
 	size_t fillStruct(X86XState &regs) const;
+
+private:
+	// the register classes (PlatformThread::RegisterClass) changed since this
+	// state was read from a thread, and which thread and stop it was read in.
+	// PlatformThread::set_state only has to write back the changed classes of
+	// a state it handed out during the current stop
+	int        dirty_        = 0;
+	bool       from_thread_  = false;
+	edb::tid_t source_tid_   = 0;
+	quint64    source_epoch_ = 0;
+
+	// the register classes which get_state left to be read from the source
+	// thread the first time they are looked at
+	mutable int   pending_     = 0;
+	DebuggerCore *source_core_ = nullptr;
+
+private:
+	int load(int classes) const;
 };
 
 }
@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "PlatformState.h"
 #include <QtDebug>
 #include "State.h"
+#include "Util.h"
 
 #ifndef _GNU_SOURCE
 #define _GNU_SOURCE        /* or _BSD_SOURCE or _SVID_SOURCE */
@@ -157,138 +158,370 @@ bool PlatformThread::fillStateFromSimpleRegs(PlatformState* state) {
 }
 
 //------------------------------------------------------------------------------
-// Name: get_state
-// Desc:
+// Name: fetch_general_registers
+// Desc: reads the general purpose and segment registers of this thread
 //------------------------------------------------------------------------------
-void PlatformThread::get_state(State *state) {
-	// TODO: assert that we are paused
+void PlatformThread::fetch_general_registers(PlatformState *state) {
 
 	core_->detectCPUMode();
 
-	if(auto state_impl = static_cast<PlatformState *>(state->impl_)) {
+	// the debug registers live in the same block but are tracked separately
+	const auto dbgRegs = state->x86.dbgRegs;
+	state->x86.clear();
+	state->x86.dbgRegs = dbgRegs;
+
+	if(EDB_IS_64_BIT) {
+		// 64-bit GETREGS call always returns 64-bit state, so use it
+		fillStateFromSimpleRegs(state);
+	} else if(!fillStateFromPrStatus(state)) {
+		// if EDB is 32 bit, use GETREGSET so that we get 64-bit state for 64-bit debuggee
+		fillStateFromSimpleRegs(state);
+		// failing that, try to just get what we can
+	}
+}
 
-		// State must be cleared before filling to zero all presence flags, otherwise something
-		// may remain not updated. Also, this way we'll mark all the unfilled values.
-		state_impl->clear();
+//------------------------------------------------------------------------------
+// Name: fetch_fpu_registers
+// Desc: reads the x87/SSE/AVX state of this thread
+//------------------------------------------------------------------------------
+void PlatformThread::fetch_fpu_registers(PlatformState *state) {
 
-		if(EDB_IS_64_BIT) {
-			// 64-bit GETREGS call always returns 64-bit state, so use it
-			fillStateFromSimpleRegs(state_impl);
-		} else if(!fillStateFromPrStatus(state_impl)) {
-			// if EDB is 32 bit, use GETREGSET so that we get 64-bit state for 64-bit debuggee
-			fillStateFromSimpleRegs(state_impl);
-			// failing that, try to just get what we can
-		}
+	state->x87.clear();
+	state->avx.clear();
 
-		// First try to get full XSTATE
-		X86XState xstate;
-		struct iovec iov = { &xstate, sizeof(xstate) };
+	// First try to get full XSTATE
+	X86XState xstate;
+	struct iovec iov = { &xstate, sizeof(xstate) };
 
-		long status = ptrace(PTRACE_GETREGSET, tid_, NT_X86_XSTATE, &iov);
+	long status = ptrace(PTRACE_GETREGSET, tid_, NT_X86_XSTATE, &iov);
 
-		if(status == -1 || !state_impl->fillFrom(xstate,iov.iov_len)) {
+	if(status == -1 || !state->fillFrom(xstate,iov.iov_len)) {
 
-			// No XSTATE available, get just floating point and SSE registers
-			static bool getFPXRegsSupported = EDB_IS_32_BIT;
+		// No XSTATE available, get just floating point and SSE registers
+		static bool getFPXRegsSupported = EDB_IS_32_BIT;
 
-			UserFPXRegsStructX86 fpxregs;
+		UserFPXRegsStructX86 fpxregs;
 
-			// This should be automatically optimized out on amd64. If not, not a big deal.
-			// Avoiding conditional compilation to facilitate syntax error checking
-			if(getFPXRegsSupported) {
-				getFPXRegsSupported = (ptrace(PTRACE_GETFPXREGS, tid_, 0, &fpxregs) != -1);
-			}
+		// This should be automatically optimized out on amd64. If not, not a big deal.
+		// Avoiding conditional compilation to facilitate syntax error checking
+		if(getFPXRegsSupported) {
+			getFPXRegsSupported = (ptrace(PTRACE_GETFPXREGS, tid_, 0, &fpxregs) != -1);
+		}
 
-			if(getFPXRegsSupported) {
-				state_impl->fillFrom(fpxregs);
-			} else {
-				// No GETFPXREGS: on x86 this means SSE is not supported
-				//                on x86_64 FPREGS already contain SSE state
-				struct user_fpregs_struct fpregs;
-				status = ptrace(PTRACE_GETFPREGS, tid_, 0, &fpregs);
+		if(getFPXRegsSupported) {
+			state->fillFrom(fpxregs);
+		} else {
+			// No GETFPXREGS: on x86 this means SSE is not supported
+			//                on x86_64 FPREGS already contain SSE state
+			struct user_fpregs_struct fpregs;
+			status = ptrace(PTRACE_GETFPREGS, tid_, 0, &fpregs);
 
-				if(status != -1) {
-					state_impl->fillFrom(fpregs);
-				} else {
-					perror("PTRACE_GETFPREGS failed");
-				}
+			if(status != -1) {
+				state->fillFrom(fpregs);
+			} else {
+				perror("PTRACE_GETFPREGS failed");
 			}
 		}
+	}
+}
 
-		// debug registers
+//------------------------------------------------------------------------------
+// Name: fetch_debug_registers
+// Desc: reads the debug registers of this thread
+// Note: DR0-DR3 and DR7 only ever change when we write them, so once they are
+//       known only DR6 (the status register) has to be re-read on each stop
+//------------------------------------------------------------------------------
+void PlatformThread::fetch_debug_registers(PlatformState *state) {
+
+	if(!debug_control_valid_) {
 		for(std::size_t i = 0; i < 8; ++i) {
-			state_impl->x86.dbgRegs[i] = get_debug_register(i);
+			state->x86.dbgRegs[i] = get_debug_register(i);
 		}
+		debug_control_valid_ = true;
+	} else {
+		state->x86.dbgRegs[6] = get_debug_register(6);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: cached_state
+// Desc: returns the register cache for this thread, making sure that the
+//       requested register classes have been fetched during the current stop
+//------------------------------------------------------------------------------
+PlatformState *PlatformThread::cached_state(int classes) {
+
+	if(!state_cache_) {
+		state_cache_ = std::make_unique<PlatformState>();
+	}
+
+	auto cache = static_cast<PlatformState *>(state_cache_.get());
+	const quint64 epoch = core_->stop_epoch_;
+
+	if((classes & GeneralRegisters) && general_epoch_ != epoch) {
+		fetch_general_registers(cache);
+		general_epoch_ = epoch;
+	}
+
+	if((classes & FPURegisters) && fpu_epoch_ != epoch) {
+		fetch_fpu_registers(cache);
+		fpu_epoch_ = epoch;
+	}
+
+	if((classes & DebugRegisters) && debug_epoch_ != epoch) {
+		fetch_debug_registers(cache);
+		debug_epoch_ = epoch;
+	}
+
+	return cache;
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate_state_cache
+// Desc: forces the next get_state to re-read everything from the kernel
+//------------------------------------------------------------------------------
+void PlatformThread::invalidate_state_cache() {
+	general_epoch_       = InvalidEpoch;
+	fpu_epoch_           = InvalidEpoch;
+	debug_epoch_         = InvalidEpoch;
+	debug_control_valid_ = false;
+}
+
+//------------------------------------------------------------------------------
+// Name: get_state
+// Desc: reads the general purpose registers, the other register classes are
+//       read by the state itself the first time they are looked at (as long as
+//       that is still during the current stop)
+//------------------------------------------------------------------------------
+void PlatformThread::get_state(State *state) {
+	get_state(state, GeneralRegisters);
+
+	if(auto state_impl = static_cast<PlatformState *>(state->impl_)) {
+		state_impl->pending_     = FPURegisters | DebugRegisters;
+		state_impl->source_core_ = core_;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: get_state
+// Desc: fills in only the requested register classes, the rest of the state is
+//       left cleared. Classes already fetched during this stop are served from
+//       the cache without touching the debuggee
+//------------------------------------------------------------------------------
+void PlatformThread::get_state(State *state, int classes) {
+	// TODO: assert that we are paused
+
+	if(auto state_impl = static_cast<PlatformState *>(state->impl_)) {
+
+		const PlatformState *const cache = cached_state(classes);
+
+		// State must be cleared before filling to zero all presence flags, otherwise something
+		// may remain not updated. Also, this way we'll mark all the unfilled values.
+		state_impl->clear();
+
+		// remember where the state came from, so that set_state can tell which
+		// register classes need to be written back
+		state_impl->from_thread_  = true;
+		state_impl->source_tid_   = tid_;
+		state_impl->source_epoch_ = core_->stop_epoch_;
+
+		if(classes & (GeneralRegisters | DebugRegisters)) {
+			state_impl->x86 = cache->x86;
+			if(!(classes & GeneralRegisters)) {
+				const auto dbgRegs = cache->x86.dbgRegs;
+				state_impl->x86.clear();
+				state_impl->x86.dbgRegs = dbgRegs;
+			} else if(!(classes & DebugRegisters)) {
+				util::markMemory(&state_impl->x86.dbgRegs, sizeof(state_impl->x86.dbgRegs));
+			}
+		}
+
+		if(classes & FPURegisters) {
+			state_impl->x87 = cache->x87;
+			state_impl->avx = cache->avx;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: load_state
+// Desc: fills in the requested register classes of <state>, leaving the rest
+//       of it as it is
+//------------------------------------------------------------------------------
+void PlatformThread::load_state(PlatformState *state, int classes) {
+
+	const PlatformState *const cache = cached_state(classes);
+
+	if(classes & DebugRegisters) {
+		state->x86.dbgRegs = cache->x86.dbgRegs;
+	}
+
+	if(classes & FPURegisters) {
+		state->x87 = cache->x87;
+		state->avx = cache->avx;
 	}
 }
 
 //------------------------------------------------------------------------------
 // Name: set_state
-// Desc:
+// Desc: writes the state to the thread and updates the register cache to match
+// Note: if the state was read from this thread during the current stop, only
+//       the register classes which were modified since then are written back.
+//       So rewinding the instruction pointer is a single PTRACE_SETREGS. The
+//       state is left as it is, writing it again writes those classes again
 //------------------------------------------------------------------------------
 void PlatformThread::set_state(const State &state) {
 
 	// TODO: assert that we are paused
 
 	if(auto state_impl = static_cast<PlatformState *>(state.impl_)) {
-		bool setPrStatusDone = false;
 
-		if(EDB_IS_32_BIT && state_impl->is64Bit()) {
-			// Try to set 64-bit state
-			PrStatus_X86_64 prstat64;
-			state_impl->fillStruct(prstat64);
+		const quint64 epoch = core_->stop_epoch_;
+
+		int classes = AllRegisters;
+		if(state_impl->from_thread_ && state_impl->source_tid_ == tid_ && state_impl->source_epoch_ == epoch) {
+			classes = state_impl->dirty_;
+		}
+
+		// classes the state never got to read from its thread have nothing to write
+		classes &= ~state_impl->load(classes);
+
+		if(!classes) {
+			return;
+		}
+
+		if(!state_cache_) {
+			state_cache_ = std::make_unique<PlatformState>();
+		}
+
+		auto cache = static_cast<PlatformState *>(state_cache_.get());
+
+		bool setGeneralDone = false;
+		bool setDebugDone   = false;
+		bool setFPUDone     = false;
+
+		if(classes & GeneralRegisters) {
+			bool setPrStatusDone = false;
+
+			if(EDB_IS_32_BIT && state_impl->is64Bit()) {
+				// Try to set 64-bit state
+				PrStatus_X86_64 prstat64;
+				state_impl->fillStruct(prstat64);
+
+				struct iovec prstat_iov = { &prstat64, sizeof(prstat64) };
+				if(ptrace(PTRACE_SETREGSET, tid_, NT_PRSTATUS, &prstat_iov) != -1) {
+					setPrStatusDone = true;
+				} else {
+					perror("PTRACE_SETREGSET failed");
+				}
+			}
 
-			struct iovec prstat_iov = { &prstat64, sizeof(prstat64) };
-			if(ptrace(PTRACE_SETREGSET, tid_, NT_PRSTATUS, &prstat_iov) != -1) {
-				setPrStatusDone = true;
+			// Fallback to setting 32-bit set
+			if(!setPrStatusDone) {
+				struct user_regs_struct regs;
+				state_impl->fillStruct(regs);
+				setGeneralDone = (ptrace(PTRACE_SETREGS, tid_, 0, &regs) != -1);
 			} else {
-				perror("PTRACE_SETREGSET failed");
+				setGeneralDone = true;
 			}
 		}
 
-		// Fallback to setting 32-bit set
-		if(!setPrStatusDone) {
-			struct user_regs_struct regs;
-			state_impl->fillStruct(regs);
-			ptrace(PTRACE_SETREGS, tid_, 0, &regs);
+		if(classes & DebugRegisters) {
+			// registers which the cache says already hold the value are skipped.
+			// DR0-DR3 and DR7 are known for as long as the control registers are,
+			// DR6 only during the stop in which it was read
+			setDebugDone = true;
+			for(std::size_t i = 0; i < 8; ++i) {
+				// DR4 and DR5 are reserved, the kernel always rejects writes to them
+				if(i == 4 || i == 5) {
+					continue;
+				}
+
+				const bool known = (i == 6) ? (debug_control_valid_ && debug_epoch_ == epoch) : debug_control_valid_;
+				if(known && cache->x86.dbgRegs[i] == state_impl->x86.dbgRegs[i]) {
+					continue;
+				}
+
+				if(set_debug_register(i, state_impl->x86.dbgRegs[i]) == -1) {
+					setDebugDone = false;
+				}
+			}
 		}
 
-		// debug registers
-		for(std::size_t i = 0;i < 8; ++i) {
-			set_debug_register(i, state_impl->x86.dbgRegs[i]);
+		if(classes & FPURegisters) {
+			// hope for the best, adjust for reality
+			static bool xsaveSupported = true;
+
+			if(xsaveSupported) {
+				X86XState xstate;
+				const auto size = state_impl->fillStruct(xstate);
+				struct iovec iov = { &xstate, size };
+				if(ptrace(PTRACE_SETREGSET, tid_, NT_X86_XSTATE, &iov) == -1) {
+					xsaveSupported = false;
+				} else {
+					setFPUDone = true;
+				}
+			}
+
+			// If xsave/xrstor appears unsupported, fallback to fxrstor
+			// NOTE: it's not "else", it's an independent check for possibly modified flag
+			if(!xsaveSupported) {
+				static bool setFPXRegsSupported = EDB_IS_32_BIT;
+				if(setFPXRegsSupported) {
+					UserFPXRegsStructX86 fpxregs;
+					state_impl->fillStruct(fpxregs);
+					setFPXRegsSupported = (ptrace(PTRACE_SETFPXREGS, tid_, 0, &fpxregs) != -1);
+					setFPUDone = setFPXRegsSupported;
+				}
+
+				if(!setFPXRegsSupported) {
+					// No SETFPXREGS: on x86 this means SSE is not supported
+					//                on x86_64 FPREGS already contain SSE state
+					// Just set fpregs then
+					struct user_fpregs_struct fpregs;
+					state_impl->fillStruct(fpregs);
+					if(ptrace(PTRACE_SETFPREGS, tid_, 0, &fpregs) == -1) {
+						perror("PTRACE_SETFPREGS failed");
+					} else {
+						setFPUDone = true;
+					}
+				}
+			}
 		}
 
-		// hope for the best, adjust for reality
-		static bool xsaveSupported = true;
+		// write through to the cache. Classes which were not written keep what
+		// the cache already has, anything that was not fully written (or not
+		// filled in the first place) will simply be fetched again when asked for
+		if(classes & GeneralRegisters) {
+			const auto dbgRegs = cache->x86.dbgRegs;
+			cache->x86 = state_impl->x86;
+			cache->x86.dbgRegs = dbgRegs;
 
-		if(xsaveSupported) {
-			X86XState xstate;
-			const auto size = state_impl->fillStruct(xstate);
-			struct iovec iov = { &xstate, size };
-			if(ptrace(PTRACE_SETREGSET, tid_, NT_X86_XSTATE, &iov) == -1) {
-				xsaveSupported = false;
+			if(setGeneralDone && !state_impl->x86.empty()) {
+				general_epoch_ = epoch;
+			} else {
+				general_epoch_ = InvalidEpoch;
 			}
 		}
 
-		// If xsave/xrstor appears unsupported, fallback to fxrstor
-		// NOTE: it's not "else", it's an independent check for possibly modified flag
-		if(!xsaveSupported) {
-			static bool setFPXRegsSupported = EDB_IS_32_BIT;
-			if(setFPXRegsSupported) {
-				UserFPXRegsStructX86 fpxregs;
-				state_impl->fillStruct(fpxregs);
-				setFPXRegsSupported = (ptrace(PTRACE_SETFPXREGS, tid_, 0, &fpxregs) != -1);
+		if(classes & DebugRegisters) {
+			cache->x86.dbgRegs = state_impl->x86.dbgRegs;
+
+			if(setDebugDone) {
+				debug_epoch_         = epoch;
+				debug_control_valid_ = true;
+			} else {
+				debug_epoch_         = InvalidEpoch;
+				debug_control_valid_ = false;
 			}
+		}
 
-			if(!setFPXRegsSupported) {
-				// No SETFPXREGS: on x86 this means SSE is not supported
-				//                on x86_64 FPREGS already contain SSE state
-				// Just set fpregs then
-				struct user_fpregs_struct fpregs;
-				state_impl->fillStruct(fpregs);
-				if(ptrace(PTRACE_SETFPREGS, tid_, 0, &fpregs) == -1) {
-					perror("PTRACE_SETFPREGS failed");
-				}
+		if(classes & FPURegisters) {
+			if(setFPUDone && !state_impl->x87.empty()) {
+				cache->x87 = state_impl->x87;
+				cache->avx = state_impl->avx;
+				fpu_epoch_ = epoch;
+			} else {
+				fpu_epoch_ = InvalidEpoch;
 			}
 		}
 	}
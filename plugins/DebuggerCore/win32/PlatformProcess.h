@@ -93,6 +93,9 @@ namespace DebuggerCorePlugin {
 		virtual std::size_t                      read_pages(edb::address_t address, void *buf, size_t count) const {
 			qDebug("TODO: implement PlatformProcess::read_pages"); return 0;
 		};
+		virtual std::size_t                      read_spans(ReadSpan *spans, size_t count) const {
+			qDebug("TODO: implement PlatformProcess::read_spans"); return 0;
+		};
 		virtual Status                           pause() {
 			qDebug("TODO: implement PlatformProcess::pause"); return Status("Not implemented");
 		};
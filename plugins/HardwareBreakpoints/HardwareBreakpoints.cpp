@@ -88,6 +88,27 @@ QMenu *HardwareBreakpoints::menu(QWidget *parent) {
 	return menu_;
 }
 
+//------------------------------------------------------------------------------
+// Name: publishDebugRegisters
+// Desc: tells the debugger core which debug registers the threads were given,
+//       so that it can hand the same breakpoints to threads created later on
+// Note: only DR0-DR3 and DR7 are kept, with no breakpoint enabled in DR7 the
+//       image is left empty and new threads cost nothing
+//------------------------------------------------------------------------------
+void HardwareBreakpoints::publishDebugRegisters(const State &state) {
+
+	IDebugger::DebugRegisters registers = {};
+
+	if((state.debug_register(7) & 0xff) != 0) {
+		for(int i = 0; i < RegisterCount; ++i) {
+			registers[i] = state.debug_register(i);
+		}
+		registers[7] = state.debug_register(7);
+	}
+
+	edb::v1::debugger_core->set_debug_registers(registers);
+}
+
 //------------------------------------------------------------------------------
 // Name: setupBreakpoints
 // Desc:
@@ -183,6 +204,7 @@ void HardwareBreakpoints::setupBreakpoints() {
 				}
 
 				thread->set_state(state);
+				publishDebugRegisters(state);
 			}
 
 		} else {
@@ -194,6 +216,8 @@ void HardwareBreakpoints::setupBreakpoints() {
 				thread->set_state(state);
 			}
 
+			edb::v1::debugger_core->set_debug_registers({});
+
 			// we want to be disabled and we have hooked, so unhook
 			edb::v1::remove_debug_event_handler(this);
 		}
@@ -391,6 +415,7 @@ void HardwareBreakpoints::setExecuteBP(int index, bool inUse) {
 			thread->get_state(&state);
 			setBreakpointState(&state, index, { true, address, 0, 0 });
 			thread->set_state(state);
+			publishDebugRegisters(state);
 		}
 	}
 
@@ -446,6 +471,7 @@ void HardwareBreakpoints::setWriteBP(int index, bool inUse, edb::address_t addre
 			}
 
 			thread->set_state(state);
+			publishDebugRegisters(state);
 		}
 	}
 
@@ -501,6 +527,7 @@ void HardwareBreakpoints::setReadWriteBP(int index, bool inUse, edb::address_t a
 			}
 
 			thread->set_state(state);
+			publishDebugRegisters(state);
 		}
 	}
 
@@ -86,6 +86,7 @@ private:
 	void set_write(int index);
 	void set_access(int index);
 
+	void publishDebugRegisters(const State &state);
 
 private:
 	QMenu *              menu_;
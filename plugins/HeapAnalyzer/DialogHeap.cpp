@@ -23,6 +23,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "ISymbolManager.h"
 #include "MemoryRegions.h"
 #include "Module.h"
+#include "StringSearch.h"
 #include "Symbol.h"
 #include "IRegion.h"
 #include "Util.h"
@@ -43,7 +44,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QVector>
 #include <QtDebug>
 #include <algorithm>
+#include <cstring>
 #include <functional>
+#include <vector>
 
 #include <QtConcurrent>
 #include "ui_DialogHeap.h"
@@ -92,6 +95,246 @@ edb::address_t block_start(const Result &result) {
 	return block_start(result.block);
 }
 
+// the heap is captured this many bytes at a time, so that progress can be
+// shown while reading a large one
+const std::size_t SNAPSHOT_READ_SIZE = 0x1000000;
+
+// a copy of the heap taken while the debuggee is stopped, everything after
+// the initial read works on this instead of on the process
+struct HeapSnapshot {
+	edb::address_t      start;
+	std::vector<quint8> memory;
+
+	//------------------------------------------------------------------------------
+	// Name: data
+	// Desc: returns a pointer to the captured bytes at <address> if at least
+	//       <size> of them are available, nullptr otherwise
+	//------------------------------------------------------------------------------
+	const quint8 *data(edb::address_t address, std::size_t size) const {
+		if(address < start) {
+			return nullptr;
+		}
+
+		const quint64 offset = address - start;
+		if(offset > memory.size() || memory.size() - offset < size) {
+			return nullptr;
+		}
+
+		return memory.data() + offset;
+	}
+
+	//------------------------------------------------------------------------------
+	// Name: available
+	// Desc: returns how many captured bytes there are starting at <address>
+	//------------------------------------------------------------------------------
+	std::size_t available(edb::address_t address) const {
+		if(address < start) {
+			return 0;
+		}
+
+		const quint64 offset = address - start;
+		return offset < memory.size() ? memory.size() - offset : 0;
+	}
+
+	//------------------------------------------------------------------------------
+	// Name: read
+	// Desc: copies a T out of the snapshot, returns false if it isn't all there
+	//------------------------------------------------------------------------------
+	template <class T>
+	bool read(edb::address_t address, T *value) const {
+		if(const quint8 *p = data(address, sizeof(T))) {
+			std::memcpy(value, p, sizeof(T));
+			return true;
+		}
+		return false;
+	}
+};
+
+// the data area of a block, pointers to any word of it are considered to
+// point to the block itself
+struct PointerTarget {
+	edb::address_t first;
+	edb::address_t last;
+	edb::address_t block;
+};
+
+//------------------------------------------------------------------------------
+// Name: progress_percentage
+// Desc: like util::percentage, but without the int range limit, heaps can be
+//       larger than 2GB
+//------------------------------------------------------------------------------
+int progress_percentage(quint64 done, quint64 total) {
+	return total ? static_cast<int>(done * 100 / total) : 100;
+}
+
+//------------------------------------------------------------------------------
+// Name: snapshot_string
+// Desc: the snapshot equivalent of edb::v1::get_ascii_string_at_address and
+//       edb::v1::get_utf16_string_at_address
+//------------------------------------------------------------------------------
+bool snapshot_string(const HeapSnapshot &snapshot, edb::address_t address, int min_length, int max_length, bool utf16, QString *s) {
+
+	s->clear();
+
+	if(min_length <= max_length) {
+		const std::size_t char_size = utf16 ? 2 : 1;
+		const std::size_t count     = std::min<std::size_t>(max_length, snapshot.available(address) / char_size);
+		if(const quint8 *p = snapshot.data(address, count * char_size)) {
+			const int length = edb::StringSearch::string_length(p, count * char_size, static_cast<int>(count), utf16);
+			*s = edb::StringSearch::string_text(p, length, utf16);
+		}
+	}
+
+	if(s->length() >= min_length) {
+		*s = edb::StringSearch::escape_string(*s);
+		return true;
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: identify_data
+// Desc: looks at the first few bytes of a block for well known file signatures
+//------------------------------------------------------------------------------
+QString identify_data(const HeapSnapshot &snapshot, edb::address_t address) {
+
+	struct Signature {
+		const char *magic;
+		std::size_t size;
+		const char *name;
+	};
+
+	static const Signature signatures[] = {
+		{ "\x89\x50\x4e\x47",                     4, "PNG IMAGE"     },
+		{ "\x2f\x2a\x20\x58\x50\x4d\x20\x2a\x2f", 9, "XPM IMAGE"     },
+		{ "\x42\x5a",                             2, "BZIP FILE"     },
+		{ "\x1f\x9d",                             2, "COMPRESS FILE" },
+		{ "\x1f\x8b",                             2, "GZIP FILE"     },
+	};
+
+	for(const Signature &signature : signatures) {
+		const quint8 *p = snapshot.data(address, signature.size);
+		if(p && std::memcmp(p, signature.magic, signature.size) == 0) {
+			return signature.name;
+		}
+	}
+
+	return QString();
+}
+
+//------------------------------------------------------------------------------
+// Name: take_snapshot
+// Desc: reads [start_address, end_address) of the heap, if part of it can't be
+//       read, the snapshot ends where the readable part does
+//------------------------------------------------------------------------------
+template <class F>
+HeapSnapshot take_snapshot(IProcess *process, edb::address_t start_address, edb::address_t end_address, F progress) {
+
+	HeapSnapshot snapshot;
+	snapshot.start = start_address;
+
+	const std::size_t size = end_address - start_address;
+	snapshot.memory.resize(size);
+
+	std::size_t offset = 0;
+	while(offset < size) {
+		const std::size_t length = std::min(SNAPSHOT_READ_SIZE, size - offset);
+		const std::size_t n      = process->read_bytes(start_address + offset, snapshot.memory.data() + offset, length);
+
+		offset += n;
+		progress(progress_percentage(offset, size));
+
+		if(n != length) {
+			break;
+		}
+	}
+
+	snapshot.memory.resize(offset);
+	return snapshot;
+}
+
+//------------------------------------------------------------------------------
+// Name: find_pointers
+// Desc: fills in the pointers to other blocks which are stored in <result>
+// Note: this runs on worker threads, it only reads the snapshot and the
+//       targets, and only writes to <result>
+//------------------------------------------------------------------------------
+void find_pointers(const HeapSnapshot &snapshot, const std::vector<PointerTarget> &targets, std::size_t pointer_size, Result &result) {
+
+	if(!result.data.isEmpty()) {
+		return;
+	}
+
+	const edb::address_t block_ptr = block_start(result);
+	const edb::address_t block_end = block_ptr + result.size;
+
+	for(edb::address_t address = block_ptr; address < block_end; address += pointer_size) {
+
+		quint64 value = 0;
+		const quint8 *p = snapshot.data(address, pointer_size);
+		if(!p) {
+			break;
+		}
+
+		std::memcpy(&value, p, pointer_size);
+		const edb::address_t pointer = value;
+
+		// find the last target starting at or before the pointer
+		auto it = std::upper_bound(targets.begin(), targets.end(), pointer, [](edb::address_t address, const PointerTarget &target) {
+			return address < target.first;
+		});
+
+		if(it == targets.begin()) {
+			continue;
+		}
+
+		--it;
+
+		if(pointer < it->last && (pointer - it->first) % pointer_size == 0) {
+		#if QT_POINTER_SIZE == 4
+			result.data += QString("dword ptr [%1] |").arg(edb::v1::format_pointer(pointer));
+		#elif QT_POINTER_SIZE == 8
+			result.data += QString("qword ptr [%1] |").arg(edb::v1::format_pointer(pointer));
+		#endif
+			result.points_to.push_back(it->block);
+		}
+	}
+
+	result.data.truncate(result.data.size() - 2);
+}
+
+//------------------------------------------------------------------------------
+// Name: detect_pointers
+// Desc: finds which blocks point to other blocks
+//------------------------------------------------------------------------------
+void detect_pointers(const HeapSnapshot &snapshot, QVector<Result> &results) {
+
+	qDebug() << "[Heap Analyzer] detecting pointers in heap blocks";
+
+	const std::size_t pointer_size = edb::v1::pointer_size();
+
+	// the potential targets, the blocks were found walking the heap so they are
+	// already in address order, a later block wins where two of them overlap
+	qDebug() << "[Heap Analyzer] collecting possible targets addresses";
+
+	std::vector<PointerTarget> targets;
+	targets.reserve(results.size());
+
+	for(const Result &result: results) {
+		const edb::address_t block_ptr = block_start(result);
+		targets.push_back({ block_ptr, block_ptr + result.size, result.block });
+	}
+
+	std::stable_sort(targets.begin(), targets.end(), [](const PointerTarget &lhs, const PointerTarget &rhs) {
+		return lhs.first < rhs.first;
+	});
+
+	QtConcurrent::blockingMap(results, [&snapshot, &targets, pointer_size](Result &result) {
+		find_pointers(snapshot, targets, pointer_size, result);
+	});
+}
+
 }
 
 //------------------------------------------------------------------------------
@@ -191,72 +434,9 @@ void DialogHeap::get_library_names(QString *libcName, QString *ldName) const {
 	}
 }
 
-//------------------------------------------------------------------------------
-// Name: process_potential_pointer
-// Desc:
-//------------------------------------------------------------------------------
-void DialogHeap::process_potential_pointer(const QHash<edb::address_t, edb::address_t> &targets, Result &result) {
-
-	if(IProcess *process = edb::v1::debugger_core->process()) {
-		if(result.data.isEmpty()) {
-			edb::address_t pointer(0);
-			edb::address_t block_ptr = block_start(result);
-			edb::address_t block_end = block_ptr + result.size;
-
-			while(block_ptr < block_end) {
-
-				if(process->read_bytes(block_ptr, &pointer, edb::v1::pointer_size())) {
-					auto it = targets.find(pointer);
-					if(it != targets.end()) {
-					#if QT_POINTER_SIZE == 4
-						result.data += QString("dword ptr [%1] |").arg(edb::v1::format_pointer(it.key()));
-					#elif QT_POINTER_SIZE == 8
-						result.data += QString("qword ptr [%1] |").arg(edb::v1::format_pointer(it.key()));
-					#endif
-					result.points_to.push_back(it.value());
-					}
-				}
-
-				block_ptr += edb::v1::pointer_size();
-			}
-
-			result.data.truncate(result.data.size() - 2);
-		}
-	}
-}
-
-//------------------------------------------------------------------------------
-// Name: detect_pointers
-// Desc:
-//------------------------------------------------------------------------------
-void DialogHeap::detect_pointers() {
-
-	qDebug() << "[Heap Analyzer] detecting pointers in heap blocks";
-
-	QHash<edb::address_t, edb::address_t> targets;
-	QVector<Result> &results = model_->results();
-
-	// the potential targets
-	qDebug() << "[Heap Analyzer] collecting possible targets addresses";
-	for(const Result &result: results) {
-		edb::address_t block_ptr = block_start(result);
-		edb::address_t block_end = block_ptr + result.size;
-		while(block_ptr < block_end) {
-			targets.insert(block_ptr, result.block);
-			block_ptr += edb::v1::pointer_size();
-		}
-	}
-
-	QtConcurrent::blockingMap(results, [this, targets](Result &result) {
-		process_potential_pointer(targets, result);
-	});
-
-	model_->update();
-}
-
 //------------------------------------------------------------------------------
 // Name: collect_blocks
-// Desc:
+// Desc: captures the heap once and walks its chunks in the local copy
 //------------------------------------------------------------------------------
 template<class Addr>
 void DialogHeap::collect_blocks(edb::address_t start_address, edb::address_t end_address) {
@@ -265,8 +445,15 @@ void DialogHeap::collect_blocks(edb::address_t start_address, edb::address_t end
 	if(IProcess *process = edb::v1::debugger_core->process()) {
 		const int min_string_length = edb::v1::config().min_string_length;
 
-		if(start_address != 0 && end_address != 0) {
+		if(start_address != 0 && end_address != 0 && start_address < end_address) {
 	#if defined(Q_OS_LINUX) || defined(Q_OS_FREEBSD) || defined(Q_OS_OPENBSD)
+
+			qDebug() << "[Heap Analyzer] reading heap contents";
+
+			const HeapSnapshot snapshot = take_snapshot(process, start_address, end_address, [this](int percent) {
+				ui->progressBar->setValue(percent);
+			});
+
 			malloc_chunk<Addr> currentChunk;
 			malloc_chunk<Addr> nextChunk;
 			edb::address_t currentChunkAddress = start_address;
@@ -274,9 +461,13 @@ void DialogHeap::collect_blocks(edb::address_t start_address, edb::address_t end
 			model_->setUpdatesEnabled(false);
 
 			const edb::address_t how_many = end_address - start_address;
+			int last_percent = -1;
+
 			while(currentChunkAddress != end_address) {
 				// read in the current chunk..
-				process->read_bytes(currentChunkAddress, &currentChunk, sizeof(currentChunk));
+				if(!snapshot.read(currentChunkAddress, &currentChunk)) {
+					break;
+				}
 
 				// figure out the address of the next chunk
 				const edb::address_t nextChunkAddress = next_chunk(currentChunkAddress, currentChunk);
@@ -298,51 +489,21 @@ void DialogHeap::collect_blocks(edb::address_t start_address, edb::address_t end
 						break;
 					}
 
-					QString data;
-
 					// read in the next chunk
-					process->read_bytes(nextChunkAddress, &nextChunk, sizeof(nextChunk));
+					if(!snapshot.read(nextChunkAddress, &nextChunk)) {
+						break;
+					}
 
 					// if this block is a container for an ascii string, display it...
 					// there is a lot of room for improvement here, but it's a start
-					QString asciiData;
-					QString utf16Data;
-					int asciisz;
-					int utf16sz;
-					if(edb::v1::get_ascii_string_at_address(
-							block_start(currentChunkAddress),
-							asciiData,
-							min_string_length,
-							currentChunk.chunk_size(),
-							asciisz)) {
-
-						data = QString("ASCII \"%1\"").arg(asciiData);
-					} else if(edb::v1::get_utf16_string_at_address(
-							block_start(currentChunkAddress),
-							utf16Data,
-							min_string_length,
-							currentChunk.chunk_size(),
-							utf16sz)) {
-						data = QString("UTF-16 \"%1\"").arg(utf16Data);
+					QString data;
+					QString stringData;
+					if(snapshot_string(snapshot, block_start(currentChunkAddress), min_string_length, currentChunk.chunk_size(), false, &stringData)) {
+						data = QString("ASCII \"%1\"").arg(stringData);
+					} else if(snapshot_string(snapshot, block_start(currentChunkAddress), min_string_length, currentChunk.chunk_size(), true, &stringData)) {
+						data = QString("UTF-16 \"%1\"").arg(stringData);
 					} else {
-
-						using std::memcmp;
-
-						quint8 bytes[16];
-						process->read_bytes(block_start(currentChunkAddress), bytes, sizeof(bytes));
-
-						if(memcmp(bytes, "\x89\x50\x4e\x47", 4) == 0) {
-							data = "PNG IMAGE";
-						} else if(memcmp(bytes, "\x2f\x2a\x20\x58\x50\x4d\x20\x2a\x2f", 9) == 0) {
-							data = "XPM IMAGE";
-						} else if(memcmp(bytes, "\x42\x5a", 2) == 0) {
-							data = "BZIP FILE";
-						} else if(memcmp(bytes, "\x1f\x9d", 2) == 0) {
-							data = "COMPRESS FILE";
-						} else if(memcmp(bytes, "\x1f\x8b", 2) == 0) {
-							data = "GZIP FILE";
-						}
-
+						data = identify_data(snapshot, block_start(currentChunkAddress));
 					}
 
 					const Result r(
@@ -361,10 +522,14 @@ void DialogHeap::collect_blocks(edb::address_t start_address, edb::address_t end
 
 				currentChunkAddress = nextChunkAddress;
 
-				ui->progressBar->setValue(util::percentage(currentChunkAddress - start_address, how_many));
+				const int percent = progress_percentage(currentChunkAddress - start_address, how_many);
+				if(percent != last_percent) {
+					ui->progressBar->setValue(percent);
+					last_percent = percent;
+				}
 			}
 
-			detect_pointers();
+			detect_pointers(snapshot, model_->results());
 			model_->setUpdatesEnabled(true);
 
 
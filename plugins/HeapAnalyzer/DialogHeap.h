@@ -49,10 +49,8 @@ private:
 	void get_library_names(QString *libcName, QString *ldName) const;
 	template<class Addr>
 	void collect_blocks(edb::address_t start_address, edb::address_t end_address);
-	void detect_pointers();
 	template<class Addr>
 	void do_find();
-	void process_potential_pointer(const QHash<edb::address_t, edb::address_t> &targets, Result &result);
 
 	edb::address_t find_heap_start_heuristic(edb::address_t end_address, size_t offset) const;
 
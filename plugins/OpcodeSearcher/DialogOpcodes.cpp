@@ -17,12 +17,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "DialogOpcodes.h"
-#include "ByteShiftArray.h"
 #include "IDebugger.h"
 #include "IProcess.h"
 #include "IRegion.h"
 #include "MemoryRegions.h"
-#include "ShiftBuffer.h"
 #include "Util.h"
 #include "edb.h"
 
@@ -31,6 +29,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QSortFilterProxyModel>
 #include <QListWidgetItem>
 #include <QDebug>
+#include <QThread>
+#include <algorithm>
+#include <bitset>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+
+#ifdef QT_CONCURRENT_LIB
+#include <QtConcurrent>
+#endif
 
 #include "ui_DialogOpcodes.h"
 
@@ -46,147 +54,47 @@ const int STACK_REG = ARM_REG_SP;
 #elif defined EDB_ARM64
 const int STACK_REG = ARM64_REG_SP;
 #endif
-}
 
-//------------------------------------------------------------------------------
-// Name: DialogOpcodes
-// Desc:
-//------------------------------------------------------------------------------
-DialogOpcodes::DialogOpcodes(QWidget *parent) : QDialog(parent), ui(new Ui::DialogOpcodes) {
-	ui->setupUi(this);
-	ui->tableView->verticalHeader()->hide();
-	ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+// we currently only support opcodes sequences up to 8 bytes big
+const std::size_t MAX_OPCODE_SIZE = sizeof(quint64);
 
-	filter_model_ = new QSortFilterProxyModel(this);
-	connect(ui->txtSearch, SIGNAL(textChanged(const QString &)), filter_model_, SLOT(setFilterFixedString(const QString &)));
-}
+// regions are read this much at a time, each chunk also carries the first few
+// bytes of the next one so that sequences crossing the edge are still found
+const std::size_t SEARCH_CHUNK_SIZE = 0x40000;
 
-//------------------------------------------------------------------------------
-// Name: ~DialogOpcodes
-// Desc:
-//------------------------------------------------------------------------------
-DialogOpcodes::~DialogOpcodes() {
-	delete ui;
-}
+// which bytes are able to start a sequence of the selected class, every other
+// offset is skipped without being disassembled
+using FirstByteTable = std::bitset<256>;
 
-//------------------------------------------------------------------------------
-// Name: on_listWidget_itemDoubleClicked
-// Desc: follows the found item in the data view
-//------------------------------------------------------------------------------
-void DialogOpcodes::on_listWidget_itemDoubleClicked(QListWidgetItem *item) {
-	bool ok;
-	const edb::address_t addr = item->data(Qt::UserRole).toULongLong(&ok);
-	if(ok) {
-		edb::v1::jump_to_address(addr);
-	}
-}
-
-//------------------------------------------------------------------------------
-// Name: showEvent
-// Desc:
-//------------------------------------------------------------------------------
-void DialogOpcodes::showEvent(QShowEvent *) {
-	filter_model_->setFilterKeyColumn(3);
-	filter_model_->setSourceModel(&edb::v1::memory_regions());
-	ui->tableView->setModel(filter_model_);
-	ui->progressBar->setValue(0);
-	ui->listWidget->clear();
+struct Result {
+	edb::address_t address;
+	QString        text;
+};
 
-
-	ui->comboBox->clear();
-	
-#if defined(EDB_X86) || defined(EDB_X86_64)
-	if(edb::v1::debuggeeIs64Bit()) {
-		ui->comboBox->addItem("RAX -> RIP", 1);
-		ui->comboBox->addItem("RBX -> RIP", 2);
-		ui->comboBox->addItem("RCX -> RIP", 3);
-		ui->comboBox->addItem("RDX -> RIP", 4);
-		ui->comboBox->addItem("RBP -> RIP", 5);
-		ui->comboBox->addItem("RSP -> RIP", 6);
-		ui->comboBox->addItem("RSI -> RIP", 7);
-		ui->comboBox->addItem("RDI -> RIP", 8);
-		ui->comboBox->addItem("R8 -> RIP", 9);
-		ui->comboBox->addItem("R9 -> RIP", 10);
-		ui->comboBox->addItem("R10 -> RIP", 11);
-		ui->comboBox->addItem("R11 -> RIP", 12);
-		ui->comboBox->addItem("R12 -> RIP", 13);
-		ui->comboBox->addItem("R13 -> RIP", 14);
-		ui->comboBox->addItem("R14 -> RIP", 15);
-		ui->comboBox->addItem("R15 -> RIP", 16);
-		ui->comboBox->addItem("ANY REGISTER -> RIP", 17);
-		ui->comboBox->addItem("[RSP] -> RIP", 18);
-		ui->comboBox->addItem("[RSP + 8] -> RIP", 19);
-		ui->comboBox->addItem("[RSP + 16] -> RIP", 20);
-		ui->comboBox->addItem("[RSP - 8] -> RIP", 21);
-		ui->comboBox->addItem("[RAX] -> RIP", 22);
-		ui->comboBox->addItem("[RBX] -> RIP", 23);
-		ui->comboBox->addItem("[RCX] -> RIP", 24);
-		ui->comboBox->addItem("[RDX] -> RIP", 25);
-		ui->comboBox->addItem("[RBP] -> RIP", 26);
-		ui->comboBox->addItem("[RSI] -> RIP", 28);
-		ui->comboBox->addItem("[RDI] -> RIP", 29);
-		ui->comboBox->addItem("[R8] -> RIP", 30);
-		ui->comboBox->addItem("[R9] -> RIP", 31);
-		ui->comboBox->addItem("[R10] -> RIP", 32);
-		ui->comboBox->addItem("[R11] -> RIP", 33);
-		ui->comboBox->addItem("[R12] -> RIP", 34);
-		ui->comboBox->addItem("[R13] -> RIP", 35);
-		ui->comboBox->addItem("[R14] -> RIP", 36);
-		ui->comboBox->addItem("[R15] -> RIP", 37);
-	} else {
-		ui->comboBox->addItem("EAX -> EIP", 1);
-		ui->comboBox->addItem("EBX -> EIP", 2);
-		ui->comboBox->addItem("ECX -> EIP", 3);
-		ui->comboBox->addItem("EDX -> EIP", 4);
-		ui->comboBox->addItem("EBP -> EIP", 5);
-		ui->comboBox->addItem("ESP -> EIP", 6);
-		ui->comboBox->addItem("ESI -> EIP", 7);
-		ui->comboBox->addItem("EDI -> EIP", 8);
-		ui->comboBox->addItem("ANY REGISTER -> EIP", 17);
-		ui->comboBox->addItem("[ESP] -> EIP", 18);
-		ui->comboBox->addItem("[ESP + 4] -> EIP", 19);
-		ui->comboBox->addItem("[ESP + 8] -> EIP", 20);
-		ui->comboBox->addItem("[ESP - 4] -> EIP", 21);
-
-		ui->comboBox->addItem("[EAX] -> EIP", 22);
-		ui->comboBox->addItem("[EBX] -> EIP", 23);
-		ui->comboBox->addItem("[ECX] -> EIP", 24);
-		ui->comboBox->addItem("[EDX] -> EIP", 25);
-		ui->comboBox->addItem("[EBP] -> EIP", 26);
-		ui->comboBox->addItem("[ESI] -> EIP", 28);
-		ui->comboBox->addItem("[EDI] -> EIP", 29);
-	}
-#elif defined(EDB_ARM32)
-	// TODO(eteran): implement
-#elif defined(EDB_ARM64)
-	// TODO(eteran): implement
-#endif
-}
+struct SearchChunk {
+	edb::address_t  address;
+	std::size_t     size;  // how many offsets to test
+	QVector<quint8> bytes; // size + MAX_OPCODE_SIZE, zero filled past the end of the region
+};
 
 //------------------------------------------------------------------------------
 // Name: add_result
 // Desc:
 //------------------------------------------------------------------------------
-void DialogOpcodes::add_result(const InstructionList &instructions, edb::address_t rva) {
-	if(!instructions.empty()) {
-	
+void add_result(QVector<Result> *results, std::initializer_list<const edb::Instruction *> instructions, edb::address_t rva) {
+	if(instructions.size() != 0) {
+
 		auto it = instructions.begin();
 		const edb::Instruction *inst1 = *it++;
 
-		QString instruction_string = QString("%1: %2").arg(
-			edb::v1::format_pointer(rva),
-			QString::fromStdString(edb::v1::formatter().to_string(*inst1)));
-
+		QString instruction_string = QString::fromStdString(edb::v1::formatter().to_string(*inst1));
 
 		for(; it != instructions.end(); ++it) {
 			const edb::Instruction *inst = *it;
 			instruction_string.append(QString("; %1").arg(QString::fromStdString(edb::v1::formatter().to_string(*inst))));
 		}
 
-		auto item = new QListWidgetItem(instruction_string);
-
-		item->setData(Qt::UserRole, rva);
-		ui->listWidget->addItem(item);
+		results->push_back({ rva, instruction_string });
 	}
 }
 
@@ -195,9 +103,7 @@ void DialogOpcodes::add_result(const InstructionList &instructions, edb::address
 // Desc:
 //------------------------------------------------------------------------------
 template <int REG>
-void DialogOpcodes::test_deref_reg_to_ip(const OpcodeData &data, edb::address_t start_address) {
-	const quint8 *p = data.data;
-	const quint8 *last = p + sizeof(data);
+void test_deref_reg_to_ip(const quint8 *p, const quint8 *last, edb::address_t start_address, QVector<Result> *results) {
 
 	edb::Instruction inst(p, last, 0);
 
@@ -210,12 +116,12 @@ void DialogOpcodes::test_deref_reg_to_ip(const OpcodeData &data, edb::address_t
 				if(op1->mem.disp == 0) {
 
 					if(op1->mem.base == REG && op1->mem.index == X86_REG_INVALID && op1->mem.scale == 1) {
-						add_result({ &inst }, start_address);
+						add_result(results, { &inst }, start_address);
 						return;
 					}
 
 					if(op1->mem.index == REG && op1->mem.base == X86_REG_INVALID && op1->mem.scale == 1) {
-						add_result({ &inst }, start_address);
+						add_result(results, { &inst }, start_address);
 						return;
 					}
 				}
@@ -230,10 +136,7 @@ void DialogOpcodes::test_deref_reg_to_ip(const OpcodeData &data, edb::address_t
 // Desc:
 //------------------------------------------------------------------------------
 template <int REG>
-void DialogOpcodes::test_reg_to_ip(const DialogOpcodes::OpcodeData &data, edb::address_t start_address) {
-
-	const quint8 *p = data.data;
-	const quint8 *last = p + sizeof(data);
+void test_reg_to_ip(const quint8 *p, const quint8 *last, edb::address_t start_address, QVector<Result> *results) {
 
 	edb::Instruction inst(p, last, 0);
 
@@ -242,7 +145,7 @@ void DialogOpcodes::test_reg_to_ip(const DialogOpcodes::OpcodeData &data, edb::a
 			const auto op1 = inst[0];
 			if(is_register(op1)) {
 				if(op1->reg == REG) {
-					add_result({ &inst }, start_address);
+					add_result(results, { &inst }, start_address);
 					return;
 				}
 			}
@@ -259,7 +162,7 @@ void DialogOpcodes::test_reg_to_ip(const DialogOpcodes::OpcodeData &data, edb::a
 							const auto op2 = inst2[0];
 
 							if(is_ret(inst2)) {
-								add_result({ &inst, &inst2 }, start_address);
+								add_result(results, { &inst, &inst2 }, start_address);
 							} else {
 								switch(inst2.operation()) {
 								case X86_INS_JMP:
@@ -270,12 +173,12 @@ void DialogOpcodes::test_reg_to_ip(const DialogOpcodes::OpcodeData &data, edb::a
 										if(op2->mem.disp == 0) {
 
 											if(op2->mem.base == STACK_REG && op2->mem.index == X86_REG_INVALID) {
-												add_result({ &inst, &inst2 }, start_address);
+												add_result(results, { &inst, &inst2 }, start_address);
 												return;
 											}
 
 											if(op2->mem.index == STACK_REG && op2->mem.base == X86_REG_INVALID) {
-												add_result({ &inst, &inst2 }, start_address);
+												add_result(results, { &inst, &inst2 }, start_address);
 												return;
 											}
 										}
@@ -300,29 +203,26 @@ void DialogOpcodes::test_reg_to_ip(const DialogOpcodes::OpcodeData &data, edb::a
 // Name: test_esp_add_0
 // Desc:
 //------------------------------------------------------------------------------
-void DialogOpcodes::test_esp_add_0(const OpcodeData &data, edb::address_t start_address) {
-
-	const quint8 *p = data.data;
-	const quint8 *last = p + sizeof(data);
+void test_esp_add_0(const quint8 *p, const quint8 *last, edb::address_t start_address, QVector<Result> *results) {
 
 	edb::Instruction inst(p, last, 0);
 
 	if(inst) {
 		const auto op1 = inst[0];
 		if(is_ret(inst)) {
-			add_result({ &inst }, start_address);
+			add_result(results, { &inst }, start_address);
 		} else if(is_call(inst) || is_jump(inst)) {
 				if(is_expression(op1)) {
 
 					if(op1->mem.disp == 0) {
 
 						if(op1->mem.base == STACK_REG && op1->mem.index == X86_REG_INVALID) {
-							add_result({ &inst }, start_address);
+							add_result(results, { &inst }, start_address);
 							return;
 						}
 
 						if(op1->mem.index == STACK_REG && op1->mem.base == X86_REG_INVALID) {
-							add_result({ &inst }, start_address);
+							add_result(results, { &inst }, start_address);
 							return;
 						}
 					}
@@ -343,7 +243,7 @@ void DialogOpcodes::test_esp_add_0(const OpcodeData &data, edb::address_t start_
 							if(is_register(op2)) {
 
 								if(op1->reg == op2->reg) {
-									add_result({ &inst, &inst2 }, start_address);
+									add_result(results, { &inst, &inst2 }, start_address);
 								}
 							}
 							break;
@@ -364,10 +264,7 @@ void DialogOpcodes::test_esp_add_0(const OpcodeData &data, edb::address_t start_
 // Name: test_esp_add_regx1
 // Desc:
 //------------------------------------------------------------------------------
-void DialogOpcodes::test_esp_add_regx1(const OpcodeData &data, edb::address_t start_address) {
-
-	const quint8 *p = data.data;
-	const quint8 *last = p + sizeof(data);
+void test_esp_add_regx1(const quint8 *p, const quint8 *last, edb::address_t start_address, QVector<Result> *results) {
 
 	edb::Instruction inst(p, last, 0);
 
@@ -378,9 +275,9 @@ void DialogOpcodes::test_esp_add_regx1(const OpcodeData &data, edb::address_t st
 
 					if(op1->mem.disp == 4) {
 						if(op1->mem.base == STACK_REG && op1->mem.index == X86_REG_INVALID) {
-							add_result({ &inst }, start_address);
+							add_result(results, { &inst }, start_address);
 						} else if(op1->mem.base == X86_REG_INVALID && op1->mem.index == STACK_REG && op1->mem.scale == 1) {
-							add_result({ &inst }, start_address);
+							add_result(results, { &inst }, start_address);
 						}
 
 					}
@@ -394,7 +291,7 @@ void DialogOpcodes::test_esp_add_regx1(const OpcodeData &data, edb::address_t st
 					edb::Instruction inst2(p, last, 0);
 					if(inst2) {
 						if(is_ret(inst2)) {
-							add_result({ &inst, &inst2 }, start_address);
+							add_result(results, { &inst, &inst2 }, start_address);
 						}
 					}
 				}
@@ -410,7 +307,7 @@ void DialogOpcodes::test_esp_add_regx1(const OpcodeData &data, edb::address_t st
 							edb::Instruction inst2(p, last, 0);
 							if(inst2) {
 								if(is_ret(inst2)) {
-									add_result({ &inst, &inst2 }, start_address);
+									add_result(results, { &inst, &inst2 }, start_address);
 								}
 							}
 						}
@@ -428,7 +325,7 @@ void DialogOpcodes::test_esp_add_regx1(const OpcodeData &data, edb::address_t st
 							edb::Instruction inst2(p, last, 0);
 							if(inst2) {
 								if(is_ret(inst2)) {
-									add_result({ &inst, &inst2 }, start_address);
+									add_result(results, { &inst, &inst2 }, start_address);
 								}
 							}
 						}
@@ -447,10 +344,7 @@ void DialogOpcodes::test_esp_add_regx1(const OpcodeData &data, edb::address_t st
 // Name: test_esp_add_regx2
 // Desc:
 //------------------------------------------------------------------------------
-void DialogOpcodes::test_esp_add_regx2(const OpcodeData &data, edb::address_t start_address) {
-
-	const quint8 *p = data.data;
-	const quint8 *last = p + sizeof(data);
+void test_esp_add_regx2(const quint8 *p, const quint8 *last, edb::address_t start_address, QVector<Result> *results) {
 
 	edb::Instruction inst(p, last, 0);
 
@@ -461,9 +355,9 @@ void DialogOpcodes::test_esp_add_regx2(const OpcodeData &data, edb::address_t st
 
 				if(op1->mem.disp == (sizeof(edb::reg_t) * 2)) {
 					if(op1->mem.base == STACK_REG && op1->mem.index == X86_REG_INVALID) {
-						add_result({ &inst }, start_address);
+						add_result(results, { &inst }, start_address);
 					} else if(op1->mem.base == X86_REG_INVALID && op1->mem.index == STACK_REG && op1->mem.scale == 1) {
-						add_result({ &inst }, start_address);
+						add_result(results, { &inst }, start_address);
 					}
 
 				}
@@ -485,7 +379,7 @@ void DialogOpcodes::test_esp_add_regx2(const OpcodeData &data, edb::address_t st
 								edb::Instruction inst3(p, last, 0);
 								if(inst3) {
 									if(is_ret(inst3)) {
-										add_result({ &inst, &inst2, &inst3 }, start_address);
+										add_result(results, { &inst, &inst2, &inst3 }, start_address);
 									}
 								}
 							}
@@ -507,7 +401,7 @@ void DialogOpcodes::test_esp_add_regx2(const OpcodeData &data, edb::address_t st
 							edb::Instruction inst2(p, last, 0);
 							if(inst2) {
 								if(is_ret(inst2)) {
-									add_result({ &inst, &inst2 }, start_address);
+									add_result(results, { &inst, &inst2 }, start_address);
 								}
 							}
 						}
@@ -526,7 +420,7 @@ void DialogOpcodes::test_esp_add_regx2(const OpcodeData &data, edb::address_t st
 							edb::Instruction inst2(p, last, 0);
 							if(inst2) {
 								if(is_ret(inst2)) {
-									add_result({ &inst, &inst2 }, start_address);
+									add_result(results, { &inst, &inst2 }, start_address);
 								}
 							}
 						}
@@ -545,10 +439,7 @@ void DialogOpcodes::test_esp_add_regx2(const OpcodeData &data, edb::address_t st
 // Name: test_esp_sub_regx1
 // Desc:
 //------------------------------------------------------------------------------
-void DialogOpcodes::test_esp_sub_regx1(const OpcodeData &data, edb::address_t start_address) {
-
-	const quint8 *p = data.data;
-	const quint8 *last = p + sizeof(data);
+void test_esp_sub_regx1(const quint8 *p, const quint8 *last, edb::address_t start_address, QVector<Result> *results) {
 
 	edb::Instruction inst(p, last, 0);
 
@@ -559,9 +450,9 @@ void DialogOpcodes::test_esp_sub_regx1(const OpcodeData &data, edb::address_t st
 
 				if(op1->mem.disp == -static_cast<int>(sizeof(edb::reg_t))) {
 					if(op1->mem.base == STACK_REG && op1->mem.index == X86_REG_INVALID) {
-						add_result({ &inst }, start_address);
+						add_result(results, { &inst }, start_address);
 					} else if(op1->mem.base == X86_REG_INVALID && op1->mem.index == STACK_REG && op1->mem.scale == 1) {
-						add_result({ &inst }, start_address);
+						add_result(results, { &inst }, start_address);
 					}
 
 				}
@@ -579,7 +470,7 @@ void DialogOpcodes::test_esp_sub_regx1(const OpcodeData &data, edb::address_t st
 							edb::Instruction inst2(p, last, 0);
 							if(inst2) {
 								if(is_ret(inst2)) {
-									add_result({ &inst, &inst2 }, start_address);
+									add_result(results, { &inst, &inst2 }, start_address);
 								}
 							}
 						}
@@ -598,7 +489,7 @@ void DialogOpcodes::test_esp_sub_regx1(const OpcodeData &data, edb::address_t st
 							edb::Instruction inst2(p, last, 0);
 							if(inst2) {
 								if(is_ret(inst2)) {
-									add_result({ &inst, &inst2 }, start_address);
+									add_result(results, { &inst, &inst2 }, start_address);
 								}
 							}
 						}
@@ -614,103 +505,306 @@ void DialogOpcodes::test_esp_sub_regx1(const OpcodeData &data, edb::address_t st
 }
 
 //------------------------------------------------------------------------------
-// Name:
-// Desc:
+// Name: run_tests
+// Desc: runs the decoder based checks of <classtype> on the bytes at <p>
 //------------------------------------------------------------------------------
-void DialogOpcodes::run_tests(int classtype, const OpcodeData &opcode, edb::address_t address) {
+void run_tests(int classtype, const quint8 *p, const quint8 *last, edb::address_t address, QVector<Result> *results) {
 
 	switch(classtype) {
 #if defined(EDB_X86)
-	case 1: test_reg_to_ip<X86_REG_EAX>(opcode, address); break;
-	case 2: test_reg_to_ip<X86_REG_EBX>(opcode, address); break;
-	case 3: test_reg_to_ip<X86_REG_ECX>(opcode, address); break;
-	case 4: test_reg_to_ip<X86_REG_EDX>(opcode, address); break;
-	case 5: test_reg_to_ip<X86_REG_EBP>(opcode, address); break;
-	case 6: test_reg_to_ip<X86_REG_ESP>(opcode, address); break;
-	case 7: test_reg_to_ip<X86_REG_ESI>(opcode, address); break;
-	case 8: test_reg_to_ip<X86_REG_EDI>(opcode, address); break;
+	case 1: test_reg_to_ip<X86_REG_EAX>(p, last, address, results); break;
+	case 2: test_reg_to_ip<X86_REG_EBX>(p, last, address, results); break;
+	case 3: test_reg_to_ip<X86_REG_ECX>(p, last, address, results); break;
+	case 4: test_reg_to_ip<X86_REG_EDX>(p, last, address, results); break;
+	case 5: test_reg_to_ip<X86_REG_EBP>(p, last, address, results); break;
+	case 6: test_reg_to_ip<X86_REG_ESP>(p, last, address, results); break;
+	case 7: test_reg_to_ip<X86_REG_ESI>(p, last, address, results); break;
+	case 8: test_reg_to_ip<X86_REG_EDI>(p, last, address, results); break;
 #elif defined(EDB_X86_64)
-	case 1: test_reg_to_ip<X86_REG_RAX>(opcode, address); break;
-	case 2: test_reg_to_ip<X86_REG_RBX>(opcode, address); break;
-	case 3: test_reg_to_ip<X86_REG_RCX>(opcode, address); break;
-	case 4: test_reg_to_ip<X86_REG_RDX>(opcode, address); break;
-	case 5: test_reg_to_ip<X86_REG_RBP>(opcode, address); break;
-	case 6: test_reg_to_ip<X86_REG_RSP>(opcode, address); break;
-	case 7: test_reg_to_ip<X86_REG_RSI>(opcode, address); break;
-	case 8: test_reg_to_ip<X86_REG_RDI>(opcode, address); break;
-	case 9: test_reg_to_ip<X86_REG_R8>(opcode, address); break;
-	case 10: test_reg_to_ip<X86_REG_R9>(opcode, address); break;
-	case 11: test_reg_to_ip<X86_REG_R10>(opcode, address); break;
-	case 12: test_reg_to_ip<X86_REG_R11>(opcode, address); break;
-	case 13: test_reg_to_ip<X86_REG_R12>(opcode, address); break;
-	case 14: test_reg_to_ip<X86_REG_R13>(opcode, address); break;
-	case 15: test_reg_to_ip<X86_REG_R14>(opcode, address); break;
-	case 16: test_reg_to_ip<X86_REG_R15>(opcode, address); break;
+	case 1: test_reg_to_ip<X86_REG_RAX>(p, last, address, results); break;
+	case 2: test_reg_to_ip<X86_REG_RBX>(p, last, address, results); break;
+	case 3: test_reg_to_ip<X86_REG_RCX>(p, last, address, results); break;
+	case 4: test_reg_to_ip<X86_REG_RDX>(p, last, address, results); break;
+	case 5: test_reg_to_ip<X86_REG_RBP>(p, last, address, results); break;
+	case 6: test_reg_to_ip<X86_REG_RSP>(p, last, address, results); break;
+	case 7: test_reg_to_ip<X86_REG_RSI>(p, last, address, results); break;
+	case 8: test_reg_to_ip<X86_REG_RDI>(p, last, address, results); break;
+	case 9: test_reg_to_ip<X86_REG_R8>(p, last, address, results); break;
+	case 10: test_reg_to_ip<X86_REG_R9>(p, last, address, results); break;
+	case 11: test_reg_to_ip<X86_REG_R10>(p, last, address, results); break;
+	case 12: test_reg_to_ip<X86_REG_R11>(p, last, address, results); break;
+	case 13: test_reg_to_ip<X86_REG_R12>(p, last, address, results); break;
+	case 14: test_reg_to_ip<X86_REG_R13>(p, last, address, results); break;
+	case 15: test_reg_to_ip<X86_REG_R14>(p, last, address, results); break;
+	case 16: test_reg_to_ip<X86_REG_R15>(p, last, address, results); break;
 #endif
 
 	case 17:
 	#if defined(EDB_X86)
-		test_reg_to_ip<X86_REG_EAX>(opcode, address);
-		test_reg_to_ip<X86_REG_EBX>(opcode, address);
-		test_reg_to_ip<X86_REG_ECX>(opcode, address);
-		test_reg_to_ip<X86_REG_EDX>(opcode, address);
-		test_reg_to_ip<X86_REG_EBP>(opcode, address);
-		test_reg_to_ip<X86_REG_ESP>(opcode, address);
-		test_reg_to_ip<X86_REG_ESI>(opcode, address);
-		test_reg_to_ip<X86_REG_EDI>(opcode, address);
+		test_reg_to_ip<X86_REG_EAX>(p, last, address, results);
+		test_reg_to_ip<X86_REG_EBX>(p, last, address, results);
+		test_reg_to_ip<X86_REG_ECX>(p, last, address, results);
+		test_reg_to_ip<X86_REG_EDX>(p, last, address, results);
+		test_reg_to_ip<X86_REG_EBP>(p, last, address, results);
+		test_reg_to_ip<X86_REG_ESP>(p, last, address, results);
+		test_reg_to_ip<X86_REG_ESI>(p, last, address, results);
+		test_reg_to_ip<X86_REG_EDI>(p, last, address, results);
 	#elif defined(EDB_X86_64)
-		test_reg_to_ip<X86_REG_RAX>(opcode, address);
-		test_reg_to_ip<X86_REG_RBX>(opcode, address);
-		test_reg_to_ip<X86_REG_RCX>(opcode, address);
-		test_reg_to_ip<X86_REG_RDX>(opcode, address);
-		test_reg_to_ip<X86_REG_RBP>(opcode, address);
-		test_reg_to_ip<X86_REG_RSP>(opcode, address);
-		test_reg_to_ip<X86_REG_RSI>(opcode, address);
-		test_reg_to_ip<X86_REG_RDI>(opcode, address);
-		test_reg_to_ip<X86_REG_R8>(opcode, address);
-		test_reg_to_ip<X86_REG_R9>(opcode, address);
-		test_reg_to_ip<X86_REG_R10>(opcode, address);
-		test_reg_to_ip<X86_REG_R11>(opcode, address);
-		test_reg_to_ip<X86_REG_R12>(opcode, address);
-		test_reg_to_ip<X86_REG_R13>(opcode, address);
-		test_reg_to_ip<X86_REG_R14>(opcode, address);
-		test_reg_to_ip<X86_REG_R15>(opcode, address);
+		test_reg_to_ip<X86_REG_RAX>(p, last, address, results);
+		test_reg_to_ip<X86_REG_RBX>(p, last, address, results);
+		test_reg_to_ip<X86_REG_RCX>(p, last, address, results);
+		test_reg_to_ip<X86_REG_RDX>(p, last, address, results);
+		test_reg_to_ip<X86_REG_RBP>(p, last, address, results);
+		test_reg_to_ip<X86_REG_RSP>(p, last, address, results);
+		test_reg_to_ip<X86_REG_RSI>(p, last, address, results);
+		test_reg_to_ip<X86_REG_RDI>(p, last, address, results);
+		test_reg_to_ip<X86_REG_R8>(p, last, address, results);
+		test_reg_to_ip<X86_REG_R9>(p, last, address, results);
+		test_reg_to_ip<X86_REG_R10>(p, last, address, results);
+		test_reg_to_ip<X86_REG_R11>(p, last, address, results);
+		test_reg_to_ip<X86_REG_R12>(p, last, address, results);
+		test_reg_to_ip<X86_REG_R13>(p, last, address, results);
+		test_reg_to_ip<X86_REG_R14>(p, last, address, results);
+		test_reg_to_ip<X86_REG_R15>(p, last, address, results);
 	#endif
 		break;
 	case 18:
 		// [ESP] -> EIP
-		test_esp_add_0(opcode, address);
+		test_esp_add_0(p, last, address, results);
 		break;
 	case 19:
 		// [ESP + 4] -> EIP
-		test_esp_add_regx1(opcode, address);
+		test_esp_add_regx1(p, last, address, results);
 		break;
 	case 20:
 		// [ESP + 8] -> EIP
-		test_esp_add_regx2(opcode, address);
+		test_esp_add_regx2(p, last, address, results);
 		break;
 	case 21:
 		// [ESP - 4] -> EIP
-		test_esp_sub_regx1(opcode, address);
+		test_esp_sub_regx1(p, last, address, results);
+		break;
+
+
+	case 22: test_deref_reg_to_ip<X86_REG_RAX>(p, last, address, results); break;
+	case 23: test_deref_reg_to_ip<X86_REG_RBX>(p, last, address, results); break;
+	case 24: test_deref_reg_to_ip<X86_REG_RCX>(p, last, address, results); break;
+	case 25: test_deref_reg_to_ip<X86_REG_RDX>(p, last, address, results); break;
+	case 26: test_deref_reg_to_ip<X86_REG_RBP>(p, last, address, results); break;
+	case 28: test_deref_reg_to_ip<X86_REG_RSI>(p, last, address, results); break;
+	case 29: test_deref_reg_to_ip<X86_REG_RDI>(p, last, address, results); break;
+	case 30: test_deref_reg_to_ip<X86_REG_R8>(p, last, address, results); break;
+	case 31: test_deref_reg_to_ip<X86_REG_R9>(p, last, address, results); break;
+	case 32: test_deref_reg_to_ip<X86_REG_R10>(p, last, address, results); break;
+	case 33: test_deref_reg_to_ip<X86_REG_R11>(p, last, address, results); break;
+	case 34: test_deref_reg_to_ip<X86_REG_R12>(p, last, address, results); break;
+	case 35: test_deref_reg_to_ip<X86_REG_R13>(p, last, address, results); break;
+	case 36: test_deref_reg_to_ip<X86_REG_R14>(p, last, address, results); break;
+	case 37: test_deref_reg_to_ip<X86_REG_R15>(p, last, address, results); break;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: compile_first_bytes
+// Desc: builds the table of opcode bytes which the instructions checked by
+//       run_tests for <classtype> can start with
+//------------------------------------------------------------------------------
+FirstByteTable compile_first_bytes(int classtype) {
+
+	FirstByteTable table;
+
+	// any of the instructions may be prefixed
+	for(quint8 prefix : { 0x26, 0x2e, 0x36, 0x3e, 0x64, 0x65, 0x66, 0x67, 0xf0, 0xf2, 0xf3 }) {
+		table.set(prefix);
+	}
+
+	if(edb::v1::debuggeeIs64Bit()) {
+		// REX
+		for(int rex = 0x40; rex <= 0x4f; ++rex) {
+			table.set(rex);
+		}
+	}
+
+	// call/jmp reg, call/jmp [reg], push r/m
+	table.set(0xff);
+
+	switch(classtype) {
+	case 18:
+		// ret, pop reg
+		table.set(0xc2);
+		table.set(0xc3);
+		table.set(0x8f);
+		for(int reg = 0x58; reg <= 0x5f; ++reg) {
+			table.set(reg);
+		}
+		break;
+	case 19:
+	case 20:
+		// pop reg, pop r/m, pop sreg, add/sub esp, imm
+		table.set(0x07);
+		table.set(0x0f);
+		table.set(0x17);
+		table.set(0x1f);
+		table.set(0x8f);
+		table.set(0x81);
+		table.set(0x83);
+		for(int reg = 0x58; reg <= 0x5f; ++reg) {
+			table.set(reg);
+		}
+		break;
+	case 21:
+		// add/sub esp, imm
+		table.set(0x81);
+		table.set(0x83);
+		break;
+	default:
+		if(classtype <= 17) {
+			// push reg
+			for(int reg = 0x50; reg <= 0x57; ++reg) {
+				table.set(reg);
+			}
+		}
 		break;
+	}
 
+	return table;
+}
 
-	case 22: test_deref_reg_to_ip<X86_REG_RAX>(opcode, address); break;
-	case 23: test_deref_reg_to_ip<X86_REG_RBX>(opcode, address); break;
-	case 24: test_deref_reg_to_ip<X86_REG_RCX>(opcode, address); break;
-	case 25: test_deref_reg_to_ip<X86_REG_RDX>(opcode, address); break;
-	case 26: test_deref_reg_to_ip<X86_REG_RBP>(opcode, address); break;
-	case 28: test_deref_reg_to_ip<X86_REG_RSI>(opcode, address); break;
-	case 29: test_deref_reg_to_ip<X86_REG_RDI>(opcode, address); break;
-	case 30: test_deref_reg_to_ip<X86_REG_R8>(opcode, address); break;
-	case 31: test_deref_reg_to_ip<X86_REG_R9>(opcode, address); break;
-	case 32: test_deref_reg_to_ip<X86_REG_R10>(opcode, address); break;
-	case 33: test_deref_reg_to_ip<X86_REG_R11>(opcode, address); break;
-	case 34: test_deref_reg_to_ip<X86_REG_R12>(opcode, address); break;
-	case 35: test_deref_reg_to_ip<X86_REG_R13>(opcode, address); break;
-	case 36: test_deref_reg_to_ip<X86_REG_R14>(opcode, address); break;
-	case 37: test_deref_reg_to_ip<X86_REG_R15>(opcode, address); break;
+//------------------------------------------------------------------------------
+// Name: search_chunk
+// Desc: runs the tests at every offset of <chunk> which passes the prefilter
+// Note: this runs on worker threads, so it may only look at its arguments
+//------------------------------------------------------------------------------
+QVector<Result> search_chunk(const SearchChunk &chunk, int classtype, const FirstByteTable &first_bytes) {
+
+	QVector<Result> results;
+
+	const quint8 *const data = chunk.bytes.constData();
+	for(std::size_t i = 0; i < chunk.size; ++i) {
+		if(first_bytes[data[i]]) {
+			run_tests(classtype, data + i, data + i + MAX_OPCODE_SIZE, chunk.address + i, &results);
+		}
 	}
+
+	return results;
+}
+
+}
+
+
+//------------------------------------------------------------------------------
+// Name: DialogOpcodes
+// Desc:
+//------------------------------------------------------------------------------
+DialogOpcodes::DialogOpcodes(QWidget *parent) : QDialog(parent), ui(new Ui::DialogOpcodes) {
+	ui->setupUi(this);
+	ui->tableView->verticalHeader()->hide();
+	ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+	filter_model_ = new QSortFilterProxyModel(this);
+	connect(ui->txtSearch, SIGNAL(textChanged(const QString &)), filter_model_, SLOT(setFilterFixedString(const QString &)));
+}
+
+//------------------------------------------------------------------------------
+// Name: ~DialogOpcodes
+// Desc:
+//------------------------------------------------------------------------------
+DialogOpcodes::~DialogOpcodes() {
+	delete ui;
+}
+
+//------------------------------------------------------------------------------
+// Name: on_listWidget_itemDoubleClicked
+// Desc: follows the found item in the data view
+//------------------------------------------------------------------------------
+void DialogOpcodes::on_listWidget_itemDoubleClicked(QListWidgetItem *item) {
+	bool ok;
+	const edb::address_t addr = item->data(Qt::UserRole).toULongLong(&ok);
+	if(ok) {
+		edb::v1::jump_to_address(addr);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: showEvent
+// Desc:
+//------------------------------------------------------------------------------
+void DialogOpcodes::showEvent(QShowEvent *) {
+	filter_model_->setFilterKeyColumn(3);
+	filter_model_->setSourceModel(&edb::v1::memory_regions());
+	ui->tableView->setModel(filter_model_);
+	ui->progressBar->setValue(0);
+	ui->listWidget->clear();
+
+
+	ui->comboBox->clear();
+	
+#if defined(EDB_X86) || defined(EDB_X86_64)
+	if(edb::v1::debuggeeIs64Bit()) {
+		ui->comboBox->addItem("RAX -> RIP", 1);
+		ui->comboBox->addItem("RBX -> RIP", 2);
+		ui->comboBox->addItem("RCX -> RIP", 3);
+		ui->comboBox->addItem("RDX -> RIP", 4);
+		ui->comboBox->addItem("RBP -> RIP", 5);
+		ui->comboBox->addItem("RSP -> RIP", 6);
+		ui->comboBox->addItem("RSI -> RIP", 7);
+		ui->comboBox->addItem("RDI -> RIP", 8);
+		ui->comboBox->addItem("R8 -> RIP", 9);
+		ui->comboBox->addItem("R9 -> RIP", 10);
+		ui->comboBox->addItem("R10 -> RIP", 11);
+		ui->comboBox->addItem("R11 -> RIP", 12);
+		ui->comboBox->addItem("R12 -> RIP", 13);
+		ui->comboBox->addItem("R13 -> RIP", 14);
+		ui->comboBox->addItem("R14 -> RIP", 15);
+		ui->comboBox->addItem("R15 -> RIP", 16);
+		ui->comboBox->addItem("ANY REGISTER -> RIP", 17);
+		ui->comboBox->addItem("[RSP] -> RIP", 18);
+		ui->comboBox->addItem("[RSP + 8] -> RIP", 19);
+		ui->comboBox->addItem("[RSP + 16] -> RIP", 20);
+		ui->comboBox->addItem("[RSP - 8] -> RIP", 21);
+		ui->comboBox->addItem("[RAX] -> RIP", 22);
+		ui->comboBox->addItem("[RBX] -> RIP", 23);
+		ui->comboBox->addItem("[RCX] -> RIP", 24);
+		ui->comboBox->addItem("[RDX] -> RIP", 25);
+		ui->comboBox->addItem("[RBP] -> RIP", 26);
+		ui->comboBox->addItem("[RSI] -> RIP", 28);
+		ui->comboBox->addItem("[RDI] -> RIP", 29);
+		ui->comboBox->addItem("[R8] -> RIP", 30);
+		ui->comboBox->addItem("[R9] -> RIP", 31);
+		ui->comboBox->addItem("[R10] -> RIP", 32);
+		ui->comboBox->addItem("[R11] -> RIP", 33);
+		ui->comboBox->addItem("[R12] -> RIP", 34);
+		ui->comboBox->addItem("[R13] -> RIP", 35);
+		ui->comboBox->addItem("[R14] -> RIP", 36);
+		ui->comboBox->addItem("[R15] -> RIP", 37);
+	} else {
+		ui->comboBox->addItem("EAX -> EIP", 1);
+		ui->comboBox->addItem("EBX -> EIP", 2);
+		ui->comboBox->addItem("ECX -> EIP", 3);
+		ui->comboBox->addItem("EDX -> EIP", 4);
+		ui->comboBox->addItem("EBP -> EIP", 5);
+		ui->comboBox->addItem("ESP -> EIP", 6);
+		ui->comboBox->addItem("ESI -> EIP", 7);
+		ui->comboBox->addItem("EDI -> EIP", 8);
+		ui->comboBox->addItem("ANY REGISTER -> EIP", 17);
+		ui->comboBox->addItem("[ESP] -> EIP", 18);
+		ui->comboBox->addItem("[ESP + 4] -> EIP", 19);
+		ui->comboBox->addItem("[ESP + 8] -> EIP", 20);
+		ui->comboBox->addItem("[ESP - 4] -> EIP", 21);
+
+		ui->comboBox->addItem("[EAX] -> EIP", 22);
+		ui->comboBox->addItem("[EBX] -> EIP", 23);
+		ui->comboBox->addItem("[ECX] -> EIP", 24);
+		ui->comboBox->addItem("[EDX] -> EIP", 25);
+		ui->comboBox->addItem("[EBP] -> EIP", 26);
+		ui->comboBox->addItem("[ESI] -> EIP", 28);
+		ui->comboBox->addItem("[EDI] -> EIP", 29);
+	}
+#elif defined(EDB_ARM32)
+	// TODO(eteran): implement
+#elif defined(EDB_ARM64)
+	// TODO(eteran): implement
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -732,57 +826,68 @@ void DialogOpcodes::do_find() {
 	} else {
 
 		if(IProcess *process = edb::v1::debugger_core->process()) {
+
+			struct Piece {
+				edb::address_t address;
+				std::size_t    size;
+				std::size_t    overlap; // how much of the next piece of the region is readable
+			};
+
+			// split all of the selected regions up front, so that the workers
+			// can be handed pieces of several regions at once
+			QVector<Piece> pieces;
 			for(const QModelIndex &selected_item: sel) {
 
 				const QModelIndex index = filter_model_->mapToSource(selected_item);
 
 				if(auto region = *reinterpret_cast<const std::shared_ptr<IRegion> *>(index.internalPointer())) {
+					for(edb::address_t address = region->start(); address < region->end(); address += SEARCH_CHUNK_SIZE) {
+						const std::size_t size = std::min<std::size_t>(SEARCH_CHUNK_SIZE, region->end() - address);
+						const std::size_t rest = region->end() - address - size;
+						pieces.push_back({ address, size, std::min(rest, MAX_OPCODE_SIZE) });
+					}
+				}
+			}
 
-					edb::address_t start_address     = region->start();
-					edb::address_t address           = region->start();
-					const edb::address_t end_address = region->end();
-					const edb::address_t orig_start  = region->start();
-
-					ShiftBuffer<sizeof(OpcodeData)> shift_buffer;
-
-					// this will read the rest of the region
-					size_t i = 0;
-					while(start_address < end_address) {
+			const FirstByteTable first_bytes = compile_first_bytes(classtype);
 
-						// create a reference to the bsa's data so we can pass it to the testXXXX functions
-						// but only do so if we have read enough bytes to fill our shift buffer
-						if(i >= shift_buffer.size()) {
-							auto opcode = *reinterpret_cast<const OpcodeData *>(&shift_buffer[0]);
-							run_tests(classtype, opcode, address - shift_buffer.size());
-						}
+			const std::function<QVector<Result>(const SearchChunk &)> search = [classtype, &first_bytes](const SearchChunk &chunk) {
+				return search_chunk(chunk, classtype, first_bytes);
+			};
 
-						quint8 byte;
-						process->read_bytes(start_address, &byte, 1);
-						shift_buffer.shl();
-						shift_buffer[shift_buffer.size() - 1] = byte;
+			const int chunks_per_batch = std::max(1, QThread::idealThreadCount()) * 2;
 
-						++start_address;
+			for(int i = 0; i < pieces.size(); i += chunks_per_batch) {
 
-						ui->progressBar->setValue(util::percentage(address - orig_start, region->size()));
-						++address;
-						++i;
-					}
+				// reading stays on this thread, only the searching is spread out
+				QVector<SearchChunk> batch;
+				for(int j = i; j < std::min(i + chunks_per_batch, pieces.size()); ++j) {
+					const Piece &piece = pieces[j];
 
-					// test the stuff at the regions edge
-					for(size_t i = 0; i < shift_buffer.size(); ++i) {
-
-						// create a reference to the bsa's data so we can pass it to the testXXXX functions
-						auto opcode = *reinterpret_cast<const OpcodeData *>(&shift_buffer[0]);
-						run_tests(classtype, opcode, address - shift_buffer.size());
+					SearchChunk chunk;
+					chunk.address = piece.address;
+					chunk.size    = piece.size;
+					chunk.bytes.resize(piece.size + MAX_OPCODE_SIZE);
+					process->read_bytes(piece.address, chunk.bytes.data(), piece.size + piece.overlap);
+					batch.push_back(chunk);
+				}
 
-						// we just shift in 0's and hope it doesn't give false positives
-						shift_buffer.shl();
-						shift_buffer[shift_buffer.size() - 1] = 0x00;
+#if defined(QT_CONCURRENT_LIB)
+				const QVector<QVector<Result>> results = QtConcurrent::blockingMapped<QVector<QVector<Result>>>(batch, search);
+#else
+				QVector<QVector<Result>> results;
+				std::transform(batch.begin(), batch.end(), std::back_inserter(results), search);
+#endif
 
-						ui->progressBar->setValue(util::percentage(address - orig_start, region->size()));
-						++address;
+				for(const QVector<Result> &chunk_results : results) {
+					for(const Result &result : chunk_results) {
+						auto item = new QListWidgetItem(QString("%1: %2").arg(edb::v1::format_pointer(result.address), result.text));
+						item->setData(Qt::UserRole, static_cast<qulonglong>(result.address));
+						ui->listWidget->addItem(item);
 					}
 				}
+
+				ui->progressBar->setValue(util::percentage(i + batch.size(), pieces.size()));
 			}
 		}
 	}
@@ -20,11 +20,9 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define DIALOGOPCODES_20061101_H_
 
 #include "Types.h"
-#include "Instruction.h"
 
 #include <QDialog>
 #include <QList>
-#include <vector>
 
 class QSortFilterProxyModel;
 class QListWidgetItem;
@@ -45,29 +43,7 @@ public Q_SLOTS:
 	void on_listWidget_itemDoubleClicked(QListWidgetItem *);
 
 private:
-	using InstructionList = std::vector<edb::Instruction *>;
-
-private:
-	// we currently only support opcodes sequences up to 8 bytes big
-	union OpcodeData {
-		quint32 dword;
-		quint64 qword;
-		quint8  data[sizeof(quint64)];
-	};
-
-	void test_esp_add_0(const OpcodeData &data, edb::address_t start_address);
-	void test_esp_add_regx1(const OpcodeData &data, edb::address_t start_address);
-	void test_esp_add_regx2(const OpcodeData &data, edb::address_t start_address);
-	void test_esp_sub_regx1(const OpcodeData &data, edb::address_t start_address);
 	void do_find();
-	void add_result(const InstructionList &instructions, edb::address_t rva);
-	void run_tests(int classtype, const OpcodeData &opcode, edb::address_t address);
-
-	template <int REG>
-	void test_reg_to_ip(const OpcodeData &data, edb::address_t start_address);
-
-	template <int REG>
-	void test_deref_reg_to_ip(const OpcodeData &data, edb::address_t start_address);
 
 private:
     void showEvent(QShowEvent *event) override;
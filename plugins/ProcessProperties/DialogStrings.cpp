@@ -20,7 +20,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Configuration.h"
 #include "IRegion.h"
 #include "MemoryRegions.h"
-#include "Util.h"
+#include "StringSearch.h"
+#include "StringsModel.h"
 #include "edb.h"
 
 #include <QHeaderView>
@@ -42,6 +43,9 @@ DialogStrings::DialogStrings(QWidget *parent) : QDialog(parent), ui(new Ui::Dial
 
 	filter_model_ = new QSortFilterProxyModel(this);
 	connect(ui->txtSearch, SIGNAL(textChanged(const QString &)), filter_model_, SLOT(setFilterFixedString(const QString &)));
+
+	strings_model_ = new StringsModel(this);
+	ui->listView->setModel(strings_model_);
 }
 
 //------------------------------------------------------------------------------
@@ -53,12 +57,12 @@ DialogStrings::~DialogStrings() {
 }
 
 //------------------------------------------------------------------------------
-// Name: on_listWidget_itemDoubleClicked
+// Name: on_listView_doubleClicked
 // Desc: follows the found item in the data view
 //------------------------------------------------------------------------------
-void DialogStrings::on_listWidget_itemDoubleClicked(QListWidgetItem *item) {
+void DialogStrings::on_listView_doubleClicked(const QModelIndex &index) {
 	bool ok;
-	const edb::address_t addr = item->data(Qt::UserRole).toULongLong(&ok);
+	const edb::address_t addr = index.data(Qt::UserRole).toULongLong(&ok);
 	if(ok) {
 		edb::v1::dump_data(addr, false);
 	}
@@ -74,22 +78,19 @@ void DialogStrings::showEvent(QShowEvent *) {
 	ui->tableView->setModel(filter_model_);
 
 	ui->progressBar->setValue(0);
-	ui->listWidget->clear();
+	strings_model_->clear();
 }
 
 //------------------------------------------------------------------------------
 // Name: do_find
-// Desc:
+// Desc: the selected regions are read in bulk and searched in parallel, the
+//       strings are added to the list a batch at a time
 //------------------------------------------------------------------------------
 void DialogStrings::do_find() {
 
-	const int min_string_length = edb::v1::config().min_string_length;
-
 	const QItemSelectionModel *const selection_model = ui->tableView->selectionModel();
 	const QModelIndexList sel = selection_model->selectedRows();
 
-	QString str;
-
 	if(sel.size() == 0) {
 		QMessageBox::critical(
 			this,
@@ -97,48 +98,23 @@ void DialogStrings::do_find() {
 			tr("You must select a region which is to be scanned for strings."));
 	}
 
+	QList<std::shared_ptr<IRegion>> regions;
 	for(const QModelIndex &selected_item: sel) {
 
 		const QModelIndex index = filter_model_->mapToSource(selected_item);
 
 		if(auto region = *reinterpret_cast<const std::shared_ptr<IRegion> *>(index.internalPointer())) {
-
-			edb::address_t start_address     = region->start();
-			const edb::address_t end_address = region->end();
-			const edb::address_t orig_start  = start_address;
-
-			// do the search for this region!
-			while(start_address < end_address) {
-
-				int string_length = 0;
-				bool ok = edb::v1::get_ascii_string_at_address(start_address, str, min_string_length, 256, string_length);
-				if(ok) {
-					auto item = new QListWidgetItem(QString("%1: [ASCII] %2").arg(edb::v1::format_pointer(start_address), str));
-					item->setData(Qt::UserRole, start_address);
-					ui->listWidget->addItem(item);
-				} else {
-
-					if(ui->search_unicode->isChecked()) {
-						string_length = 0;
-						ok = edb::v1::get_utf16_string_at_address(start_address, str, min_string_length, 256, string_length);
-						if(ok) {
-							auto item = new QListWidgetItem(QString("%1: [UTF16] %2").arg(edb::v1::format_pointer(start_address), str));
-							item->setData(Qt::UserRole, start_address);
-							ui->listWidget->addItem(item);
-						}
-					}
-				}
-
-				ui->progressBar->setValue(util::percentage((start_address - orig_start), region->size()));
-
-				if(ok) {
-					start_address += string_length;
-				} else {
-					++start_address;
-				}
-			}
+			regions.push_back(region);
 		}
 	}
+
+	const edb::StringSearch search(edb::v1::config().min_string_length, 256, ui->search_unicode->isChecked());
+
+	search.search_regions(regions, [this](const QVector<edb::StringHit> &strings, int percent) {
+		strings_model_->addStrings(strings);
+		ui->progressBar->setValue(percent);
+		return true;
+	});
 }
 
 //------------------------------------------------------------------------------
@@ -147,7 +123,7 @@ void DialogStrings::do_find() {
 //------------------------------------------------------------------------------
 void DialogStrings::on_btnFind_clicked() {
 	ui->btnFind->setEnabled(false);
-	ui->listWidget->clear();
+	strings_model_->clear();
 	ui->progressBar->setValue(0);
 	do_find();
 	ui->progressBar->setValue(100);
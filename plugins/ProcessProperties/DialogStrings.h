@@ -23,12 +23,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Types.h"
 
 class QSortFilterProxyModel;
-class QListWidgetItem;
+class QModelIndex;
 
 namespace ProcessPropertiesPlugin {
 
 namespace Ui { class DialogStrings; }
 
+class StringsModel;
+
 class DialogStrings : public QDialog {
 	Q_OBJECT
 
@@ -38,7 +40,7 @@ public:
 
 public Q_SLOTS:
 	void on_btnFind_clicked();
-	void on_listWidget_itemDoubleClicked(QListWidgetItem *);
+	void on_listView_doubleClicked(const QModelIndex &index);
 
 private:
     void showEvent(QShowEvent *event) override;
@@ -49,6 +51,7 @@ private:
 private:
 	 Ui::DialogStrings *const ui;
 	 QSortFilterProxyModel *  filter_model_;
+	 StringsModel *           strings_model_;
 };
 
 }
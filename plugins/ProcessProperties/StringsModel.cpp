@@ -0,0 +1,91 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StringsModel.h"
+#include "edb.h"
+
+namespace ProcessPropertiesPlugin {
+
+//------------------------------------------------------------------------------
+// Name: StringsModel
+// Desc:
+//------------------------------------------------------------------------------
+StringsModel::StringsModel(QObject *parent) : QAbstractListModel(parent) {
+}
+
+//------------------------------------------------------------------------------
+// Name: data
+// Desc:
+//------------------------------------------------------------------------------
+QVariant StringsModel::data(const QModelIndex &index, int role) const {
+
+	if(!index.isValid() || index.row() >= strings_.size()) {
+		return QVariant();
+	}
+
+	const edb::StringHit &string = strings_[index.row()];
+
+	switch(role) {
+	case Qt::DisplayRole:
+		return QString("%1: [%2] %3").arg(edb::v1::format_pointer(string.address), string.utf16 ? "UTF16" : "ASCII", string.text);
+	case Qt::UserRole:
+		return static_cast<qulonglong>(string.address);
+	default:
+		return QVariant();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: rowCount
+// Desc:
+//------------------------------------------------------------------------------
+int StringsModel::rowCount(const QModelIndex &parent) const {
+
+	if(parent.isValid()) {
+		return 0;
+	}
+
+	return strings_.size();
+}
+
+//------------------------------------------------------------------------------
+// Name: addStrings
+// Desc: appends a batch of results
+//------------------------------------------------------------------------------
+void StringsModel::addStrings(const QVector<edb::StringHit> &strings) {
+
+	if(strings.isEmpty()) {
+		return;
+	}
+
+	beginInsertRows(QModelIndex(), strings_.size(), strings_.size() + strings.size() - 1);
+	strings_ += strings;
+	endInsertRows();
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc:
+//------------------------------------------------------------------------------
+void StringsModel::clear() {
+	beginResetModel();
+	strings_.clear();
+	endResetModel();
+}
+
+}
@@ -0,0 +1,50 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef STRINGS_MODEL_20181106_H_
+#define STRINGS_MODEL_20181106_H_
+
+#include "StringSearch.h"
+#include <QAbstractListModel>
+#include <QVector>
+
+namespace ProcessPropertiesPlugin {
+
+// holds the strings found by a search, the text shown for each one is only
+// put together when the view asks for it
+class StringsModel : public QAbstractListModel {
+	Q_OBJECT
+
+public:
+	explicit StringsModel(QObject *parent = nullptr);
+
+public:
+	QVariant data(const QModelIndex &index, int role) const override;
+	int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+
+public:
+	void addStrings(const QVector<edb::StringHit> &strings);
+	void clear();
+
+private:
+	QVector<edb::StringHit> strings_;
+};
+
+}
+
+#endif
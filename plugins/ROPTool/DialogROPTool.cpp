@@ -17,10 +17,10 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "DialogROPTool.h"
-#include "ByteShiftArray.h"
 #include "IDebugger.h"
 #include "IProcess.h"
 #include "IRegion.h"
+#include "Instruction.h"
 #include "MemoryRegions.h"
 #include "Util.h"
 #include "edb.h"
@@ -31,6 +31,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QModelIndex>
 #include <QSortFilterProxyModel>
 #include <QStandardItemModel>
+#include <QThread>
+#include <algorithm>
+#include <functional>
+#include <iterator>
+
+#ifdef QT_CONCURRENT_LIB
+#include <QtConcurrent>
+#endif
 
 #include "ui_DialogROPTool.h"
 
@@ -153,112 +161,54 @@ bool is_effective_nop(const edb::Instruction &inst) {
 	}
 }
 
-}
-
-//------------------------------------------------------------------------------
-// Name: DialogROPTool
-// Desc:
-//------------------------------------------------------------------------------
-DialogROPTool::DialogROPTool(QWidget *parent) : QDialog(parent), ui(new Ui::DialogROPTool) {
-	ui->setupUi(this);
-	ui->tableView->verticalHeader()->hide();
-	ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
-
-	filter_model_ = new QSortFilterProxyModel(this);
-	connect(ui->txtSearch, SIGNAL(textChanged(const QString &)), filter_model_, SLOT(setFilterFixedString(const QString &)));
-
-	result_model_ = new QStandardItemModel(this);
-	result_filter_ = new ResultFilterProxy(this);
-	result_filter_->setSourceModel(result_model_);
-	ui->listView->setModel(result_filter_);
-}
-
-//------------------------------------------------------------------------------
-// Name: ~DialogROPTool
-// Desc:
-//------------------------------------------------------------------------------
-DialogROPTool::~DialogROPTool() {
-	delete ui;
-}
-
-//------------------------------------------------------------------------------
-// Name: on_listView_itemDoubleClicked
-// Desc: follows the found item in the data view
-//------------------------------------------------------------------------------
-void DialogROPTool::on_listView_doubleClicked(const QModelIndex &index) {
-	bool ok;
-	const edb::address_t addr = index.data(Qt::UserRole).toULongLong(&ok);
-	if(ok) {
-		edb::v1::jump_to_address(addr);
-	}
-}
-
-//------------------------------------------------------------------------------
-// Name: showEvent
-// Desc:
-//------------------------------------------------------------------------------
-void DialogROPTool::showEvent(QShowEvent *) {
-	filter_model_->setFilterKeyColumn(3);
-	filter_model_->setSourceModel(&edb::v1::memory_regions());
-	ui->tableView->setModel(filter_model_);
-	ui->progressBar->setValue(0);
-
-	result_filter_->set_mask_bit(0x01, ui->chkShowALU->isChecked());
-	result_filter_->set_mask_bit(0x02, ui->chkShowStack->isChecked());
-	result_filter_->set_mask_bit(0x04, ui->chkShowLogic->isChecked());
-	result_filter_->set_mask_bit(0x08, ui->chkShowData->isChecked());
-	result_filter_->set_mask_bit(0x10, ui->chkShowOther->isChecked());
-
-	result_model_->clear();
-}
-
-//------------------------------------------------------------------------------
-// Name: on_chkShowALU_stateChanged
-// Desc:
-//------------------------------------------------------------------------------
-void DialogROPTool::on_chkShowALU_stateChanged(int state) {
-	result_filter_->set_mask_bit(0x01, state);
-}
-
-//------------------------------------------------------------------------------
-// Name: on_chkShowStack_stateChanged
-// Desc:
-//------------------------------------------------------------------------------
-void DialogROPTool::on_chkShowStack_stateChanged(int state) {
-	result_filter_->set_mask_bit(0x02, state);
-}
-
-//------------------------------------------------------------------------------
-// Name: on_chkShowLogic_stateChanged
-// Desc:
-//------------------------------------------------------------------------------
-void DialogROPTool::on_chkShowLogic_stateChanged(int state) {
-	result_filter_->set_mask_bit(0x04, state);
-}
-
-//------------------------------------------------------------------------------
-// Name: on_chkShowData_stateChanged
-// Desc:
-//------------------------------------------------------------------------------
-void DialogROPTool::on_chkShowData_stateChanged(int state) {
-	result_filter_->set_mask_bit(0x08, state);
-}
-
-//------------------------------------------------------------------------------
-// Name: on_chkShowOther_stateChanged
-// Desc:
-//------------------------------------------------------------------------------
-void DialogROPTool::on_chkShowOther_stateChanged(int state) {
-	result_filter_->set_mask_bit(0x10, state);
-}
+// how many bytes of the region are handed to a worker at once, terminators
+// are indexed inside of a chunk but gadgets may start before it
+const std::size_t SCAN_CHUNK_SIZE = 0x10000;
+
+// the role of a gadget, this is what the "Show" filters select on
+enum GadgetRole : quint32 {
+	RoleALU   = 0x01,
+	RoleStack = 0x02,
+	RoleLogic = 0x04,
+	RoleData  = 0x08,
+	RoleOther = 0x10
+};
+
+enum class TerminatorType {
+	Return,       // ret
+	JumpRegister, // pop r; jmp r
+	Syscall       // int 0x80, sysenter, syscall
+};
+
+// an instruction which ends a gadget
+struct Terminator {
+	std::size_t    offset;
+	std::size_t    size;
+	TerminatorType type;
+	int            reg; // the target of a register jump
+};
+
+// the captured copy of a region
+struct RegionImage {
+	edb::address_t start;
+	std::size_t    size;
+	const quint8  *memory;
+};
+
+struct Gadget {
+	edb::address_t address;
+	QByteArray     bytes;
+	QString        text;
+	quint32        role;
+};
 
 //------------------------------------------------------------------------------
-// Name: set_gadget_role
-// Desc:
+// Name: gadget_role
+// Desc: classifies the first instruction of a gadget which does actual work
 //------------------------------------------------------------------------------
-void DialogROPTool::set_gadget_role(QStandardItem *item, const edb::Instruction &inst1) {
+quint32 gadget_role(const edb::Instruction &inst) {
 
-	switch(inst1.operation()) {
+	switch(inst.operation()) {
 	case X86_INS_ADD:
 	case X86_INS_ADC:
 	case X86_INS_SUB:
@@ -278,8 +228,7 @@ void DialogROPTool::set_gadget_role(QStandardItem *item, const edb::Instruction
 	case X86_INS_AAM:
 	case X86_INS_AAD:
 		// ALU ops
-		item->setData(0x01, Qt::UserRole + 1);
-		break;
+		return RoleALU;
 	case X86_INS_PUSH:
 	case X86_INS_PUSHAW:
 	case X86_INS_PUSHAL:
@@ -287,8 +236,7 @@ void DialogROPTool::set_gadget_role(QStandardItem *item, const edb::Instruction
 	case X86_INS_POPAW:
 	case X86_INS_POPAL:
 		// stack ops
-		item->setData(0x02, Qt::UserRole + 1);
-		break;
+		return RoleStack;
 	case X86_INS_AND:
 	case X86_INS_OR:
 	case X86_INS_XOR:
@@ -310,8 +258,7 @@ void DialogROPTool::set_gadget_role(QStandardItem *item, const edb::Instruction
 	case X86_INS_BSF:
 	case X86_INS_BSR:
 		// logic ops
-		item->setData(0x04, Qt::UserRole + 1);
-		break;
+		return RoleLogic;
 	case X86_INS_MOV:
 	case X86_INS_MOVABS:
 	case X86_INS_CMOVA:
@@ -367,47 +314,297 @@ void DialogROPTool::set_gadget_role(QStandardItem *item, const edb::Instruction
 	case X86_INS_CMPXCHG8B:
 	case X86_INS_CMPXCHG16B:
 		// data ops
-		item->setData(0x08, Qt::UserRole + 1);
-		break;
+		return RoleData;
 	default:
 		// other ops
-		item->setData(0x10, Qt::UserRole + 1);
+		return RoleOther;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: classify_terminator
+// Desc: returns true if <inst> is able to end a gadget
+//------------------------------------------------------------------------------
+bool classify_terminator(const edb::Instruction &inst, TerminatorType *type, int *reg) {
+
+	if(is_ret(inst)) {
+		*type = TerminatorType::Return;
+		return true;
+	}
+
+	if((is_int(inst) && is_immediate(inst[0]) && (inst[0]->imm & 0xff) == 0x80) || is_sysenter(inst) || is_syscall(inst)) {
+		*type = TerminatorType::Syscall;
+		return true;
+	}
+
+	if(is_jump(inst) && inst.operand_count() == 1 && is_register(inst[0])) {
+		*type = TerminatorType::JumpRegister;
+		*reg  = inst[0]->reg;
+		return true;
+	}
+
+	return false;
+}
+
+//------------------------------------------------------------------------------
+// Name: is_terminator_candidate
+// Desc: a cheap look at the opcode bytes, so that only the few offsets which
+//       could possibly be a ret, jmp reg or syscall get disassembled
+//------------------------------------------------------------------------------
+bool is_terminator_candidate(const quint8 *p, const quint8 *last) {
+
+	switch(p[0]) {
+	case 0xc2: // ret imm16
+	case 0xc3: // ret
+		return true;
+	case 0xcd: // int 0x80
+		return p + 1 < last && p[1] == 0x80;
+	case 0x0f: // syscall, sysenter
+		return p + 1 < last && (p[1] == 0x05 || p[1] == 0x34);
+	case 0xff: // jmp reg
+		return p + 1 < last && (p[1] & 0xf8) == 0xe0;
+	default:
+		// REX prefixed jmp r8-r15
+		return (p[0] & 0xf0) == 0x40 && p + 2 < last && p[1] == 0xff && (p[2] & 0xf8) == 0xe0;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: build_gadget
+// Desc: disassembles the bytes from <first> up to <terminator> and checks that
+//       they make a gadget of at most <depth> instructions
+// Note: the caller has already made sure that the instructions end exactly
+//       where the terminator starts
+//------------------------------------------------------------------------------
+bool build_gadget(const RegionImage &image, std::size_t first, const Terminator &terminator, int depth, edb::InstructionBuffer &buffer, Gadget *gadget) {
+
+	const quint8 *const memory = image.memory;
+	const quint8 *const last   = memory + terminator.offset;
+
+	QStringList instructions;
+	quint32     role     = 0;
+	int         count    = 0;
+	int         last_pop = X86_REG_INVALID;
+
+	for(std::size_t offset = first; offset < terminator.offset; ) {
+
+		edb::Instruction inst(buffer, memory + offset, last, image.start + offset);
+		if(!inst) {
+			return false;
+		}
+
+		if(!is_effective_nop(inst)) {
+
+			// anything which leaves the gadget early breaks it, the pop of a
+			// "pop r; jmp r" doesn't count towards the depth
+			if(is_jump(inst) || ++count > depth + 1) {
+				return false;
+			}
+
+			if(!role) {
+				role = gadget_role(inst);
+			}
+
+			last_pop = (inst.operation() == X86_INS_POP && inst.operand_count() == 1 && is_register(inst[0])) ? inst[0]->reg : X86_REG_INVALID;
+		}
+
+		instructions.push_back(QString::fromStdString(edb::v1::formatter().to_string(inst)));
+		offset += inst.byte_size();
+	}
+
+	switch(terminator.type) {
+	case TerminatorType::Return:
+		if(count < 1 || count > depth) {
+			return false;
+		}
+		break;
+	case TerminatorType::JumpRegister:
+		if(last_pop != terminator.reg || count < 2) {
+			return false;
+		}
+		break;
+	case TerminatorType::Syscall:
+		// the syscall does the work of the gadget itself
+		if(count >= depth) {
+			return false;
+		}
 		break;
+	}
 
+	edb::Instruction inst(buffer, last, last + terminator.size, image.start + terminator.offset);
+	if(!role) {
+		role = gadget_role(inst);
 	}
+
+	instructions.push_back(QString::fromStdString(edb::v1::formatter().to_string(inst)));
+
+	gadget->address = image.start + first;
+	gadget->bytes   = QByteArray(reinterpret_cast<const char *>(memory + first), static_cast<int>(terminator.offset + terminator.size - first));
+	gadget->text    = instructions.join("; ");
+	gadget->role    = role;
+	return true;
 }
 
 //------------------------------------------------------------------------------
-// Name: add_gadget
-// Desc:
+// Name: find_gadgets
+// Desc: indexes the terminators which start in [first, last) and decodes
+//       backwards from each of them
+// Note: this runs on worker threads, so it may only look at its arguments
 //------------------------------------------------------------------------------
-void DialogROPTool::add_gadget(const InstructionList &instructions) {
+QVector<Gadget> find_gadgets(const RegionImage &image, std::size_t first, std::size_t last, int depth) {
+
+	const std::size_t max_size = edb::Instruction::MAX_SIZE;
+	const std::size_t window   = max_size * (depth + 1);
+
+	const quint8 *const memory = image.memory;
+	const quint8 *const end    = memory + image.size;
+
+	edb::InstructionBuffer buffer;
+	QVector<Gadget>        gadgets;
 
-	if(!instructions.empty()) {
+	for(std::size_t offset = first; offset < last; ++offset) {
 
-		auto it = instructions.begin();
-		auto inst1 = *it++;
+		if(!is_terminator_candidate(memory + offset, end)) {
+			continue;
+		}
+
+		Terminator terminator;
+		terminator.offset = offset;
+		terminator.reg    = X86_REG_INVALID;
+
+		{
+			edb::Instruction inst(buffer, memory + offset, memory + std::min(offset + max_size, image.size), image.start + offset);
+			if(!inst || !classify_terminator(inst, &terminator.type, &terminator.reg)) {
+				continue;
+			}
 
-		QString instruction_string = QString("%1").arg(QString::fromStdString(edb::v1::formatter().to_string(*inst1)));
-		for(; it != instructions.end(); ++it) {
-			auto inst = *it;
-			instruction_string.append(QString("; %1").arg(QString::fromStdString(edb::v1::formatter().to_string(*inst))));
+			terminator.size = inst.byte_size();
 		}
 
-		if(!ui->checkUnique->isChecked() || !unique_results_.contains(instruction_string)) {
-			unique_results_.insert(instruction_string);
+		// try every start in front of the terminator, first with only the
+		// length decoder since almost all of them fall out of sync with it
+		const std::size_t lowest = (offset > window) ? offset - window : 0;
 
-			// found a gadget
-			auto item = new QStandardItem(QString("%1: %2").arg(edb::v1::format_pointer(inst1->rva()), instruction_string));
+		for(std::size_t start = lowest; start <= offset; ++start) {
 
-			item->setData(static_cast<qulonglong>(inst1->rva()), Qt::UserRole);
+			std::size_t position = start;
+			while(position < offset) {
+				edb::FlowClass flow;
+				const std::size_t length = edb::decode_length(buffer, memory + position, memory + offset, image.start + position, &flow);
+				if(length == 0 || flow == edb::FlowClass::Call || flow == edb::FlowClass::Return || flow == edb::FlowClass::Interrupt || flow == edb::FlowClass::Halt) {
+					break;
+				}
 
-			// TODO: make this look for 1st non-NOP
-			set_gadget_role(item, *inst1);
+				position += length;
+			}
 
-			result_model_->insertRow(result_model_->rowCount(), item);
+			Gadget gadget;
+			if(position == offset && build_gadget(image, start, terminator, depth, buffer, &gadget)) {
+				gadgets.push_back(gadget);
+			}
 		}
 	}
+
+	return gadgets;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: DialogROPTool
+// Desc:
+//------------------------------------------------------------------------------
+DialogROPTool::DialogROPTool(QWidget *parent) : QDialog(parent), ui(new Ui::DialogROPTool) {
+	ui->setupUi(this);
+	ui->tableView->verticalHeader()->hide();
+	ui->tableView->horizontalHeader()->setSectionResizeMode(QHeaderView::ResizeToContents);
+
+	filter_model_ = new QSortFilterProxyModel(this);
+	connect(ui->txtSearch, SIGNAL(textChanged(const QString &)), filter_model_, SLOT(setFilterFixedString(const QString &)));
+
+	result_model_ = new QStandardItemModel(this);
+	result_filter_ = new ResultFilterProxy(this);
+	result_filter_->setSourceModel(result_model_);
+	ui->listView->setModel(result_filter_);
+}
+
+//------------------------------------------------------------------------------
+// Name: ~DialogROPTool
+// Desc:
+//------------------------------------------------------------------------------
+DialogROPTool::~DialogROPTool() {
+	delete ui;
+}
+
+//------------------------------------------------------------------------------
+// Name: on_listView_itemDoubleClicked
+// Desc: follows the found item in the data view
+//------------------------------------------------------------------------------
+void DialogROPTool::on_listView_doubleClicked(const QModelIndex &index) {
+	bool ok;
+	const edb::address_t addr = index.data(Qt::UserRole).toULongLong(&ok);
+	if(ok) {
+		edb::v1::jump_to_address(addr);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: showEvent
+// Desc:
+//------------------------------------------------------------------------------
+void DialogROPTool::showEvent(QShowEvent *) {
+	filter_model_->setFilterKeyColumn(3);
+	filter_model_->setSourceModel(&edb::v1::memory_regions());
+	ui->tableView->setModel(filter_model_);
+	ui->progressBar->setValue(0);
+
+	result_filter_->set_mask_bit(RoleALU, ui->chkShowALU->isChecked());
+	result_filter_->set_mask_bit(RoleStack, ui->chkShowStack->isChecked());
+	result_filter_->set_mask_bit(RoleLogic, ui->chkShowLogic->isChecked());
+	result_filter_->set_mask_bit(RoleData, ui->chkShowData->isChecked());
+	result_filter_->set_mask_bit(RoleOther, ui->chkShowOther->isChecked());
+
+	result_model_->clear();
+}
+
+//------------------------------------------------------------------------------
+// Name: on_chkShowALU_stateChanged
+// Desc:
+//------------------------------------------------------------------------------
+void DialogROPTool::on_chkShowALU_stateChanged(int state) {
+	result_filter_->set_mask_bit(RoleALU, state);
+}
+
+//------------------------------------------------------------------------------
+// Name: on_chkShowStack_stateChanged
+// Desc:
+//------------------------------------------------------------------------------
+void DialogROPTool::on_chkShowStack_stateChanged(int state) {
+	result_filter_->set_mask_bit(RoleStack, state);
+}
+
+//------------------------------------------------------------------------------
+// Name: on_chkShowLogic_stateChanged
+// Desc:
+//------------------------------------------------------------------------------
+void DialogROPTool::on_chkShowLogic_stateChanged(int state) {
+	result_filter_->set_mask_bit(RoleLogic, state);
+}
+
+//------------------------------------------------------------------------------
+// Name: on_chkShowData_stateChanged
+// Desc:
+//------------------------------------------------------------------------------
+void DialogROPTool::on_chkShowData_stateChanged(int state) {
+	result_filter_->set_mask_bit(RoleData, state);
+}
+
+//------------------------------------------------------------------------------
+// Name: on_chkShowOther_stateChanged
+// Desc:
+//------------------------------------------------------------------------------
+void DialogROPTool::on_chkShowOther_stateChanged(int state) {
+	result_filter_->set_mask_bit(RoleOther, state);
 }
 
 //------------------------------------------------------------------------------
@@ -428,112 +625,76 @@ void DialogROPTool::do_find() {
 
 		unique_results_.clear();
 
-		if(IProcess *process = edb::v1::debugger_core->process()) {
-			for(const QModelIndex &selected_item: sel) {
-
-				const QModelIndex index = filter_model_->mapToSource(selected_item);
-				if(auto region = *reinterpret_cast<const std::shared_ptr<IRegion> *>(index.internalPointer())) {
-
-					edb::address_t start_address     = region->start();
-					const edb::address_t end_address = region->end();
-					const edb::address_t orig_start  = start_address;
-
-					ByteShiftArray bsa(32);
+		const int depth                = ui->spinDepth->value();
+		const bool unique              = ui->checkUnique->isChecked();
+		const edb::address_t page_size = edb::v1::debugger_core->page_size();
 
-					while(start_address < end_address) {
+		// keep all workers busy, but hand results to the model often enough
+		// that they show up while the scan is still running
+		const int chunks_per_batch = std::max(1, QThread::idealThreadCount()) * 4;
 
-						// read in the next byte
-						quint8 byte;
-						if(process->read_bytes(start_address, &byte, 1)) {
-							bsa << byte;
+		int regions_done = 0;
 
-							const quint8       *p = bsa.data();
-							const quint8 *const l = p + bsa.size();
-							edb::address_t    rva = start_address - bsa.size() + 1;
+		for(const QModelIndex &selected_item: sel) {
 
-							InstructionList instruction_list;
+			const QModelIndex index = filter_model_->mapToSource(selected_item);
+			if(auto region = *reinterpret_cast<const std::shared_ptr<IRegion> *>(index.internalPointer())) {
 
-							// eat up any NOPs in front...
-							Q_FOREVER {
-								auto inst = std::make_shared<edb::Instruction>(p, l, rva);
-								if(!is_effective_nop(*inst)) {
-									break;
-								}
+				const QVector<quint8> memory = edb::v1::read_pages(region->start(), region->size() / page_size);
+				if(!memory.isEmpty()) {
 
-								instruction_list.push_back(inst);
-								p   += inst->byte_size();
-								rva += inst->byte_size();
-							}
+					const RegionImage image = { region->start(), static_cast<std::size_t>(memory.size()), memory.constData() };
 
+					QVector<QPair<std::size_t, std::size_t>> chunks;
+					for(std::size_t offset = 0; offset < image.size; offset += SCAN_CHUNK_SIZE) {
+						chunks.push_back(qMakePair(offset, std::min(offset + SCAN_CHUNK_SIZE, image.size)));
+					}
 
-							auto inst1 = std::make_shared<edb::Instruction>(p, l, rva);
-							if(inst1->valid()) {
-								instruction_list.push_back(inst1);
-
-								if(is_int(*inst1) && is_immediate(inst1->operand(0)) && (inst1->operand(0)->imm & 0xff) == 0x80) {
-									add_gadget(instruction_list);
-								} else if(is_sysenter(*inst1)) {
-									add_gadget(instruction_list);
-								} else if(is_syscall(*inst1)) {
-									add_gadget(instruction_list);
-								} else if(is_ret(*inst1)) {
-									ui->progressBar->setValue(util::percentage(start_address - orig_start, region->size()));
-									++start_address;
-									continue;
-								} else {
-
-									p   += inst1->byte_size();
-									rva += inst1->byte_size();
-
-									// eat up any NOPs in between...
-									Q_FOREVER {
-										auto inst = std::make_shared<edb::Instruction>(p, l, rva);
-										if(!is_effective_nop(*inst)) {
-											break;
-										}
-
-										instruction_list.push_back(inst);
-										p   += inst->byte_size();
-										rva += inst->byte_size();
-									}
+					const std::function<QVector<Gadget>(const QPair<std::size_t, std::size_t> &)> scan = [&image, depth](const QPair<std::size_t, std::size_t> &chunk) {
+						return find_gadgets(image, chunk.first, chunk.second, depth);
+					};
 
-									auto inst2 = std::make_shared<edb::Instruction>(p, l, rva);
+					for(int i = 0; i < chunks.size(); i += chunks_per_batch) {
 
-									if(is_ret(*inst2)) {
-										instruction_list.push_back(inst2);
-										add_gadget(instruction_list);
-									} else if(inst2->valid() && inst2->operation() == X86_INS_POP) {
-										instruction_list.push_back(inst2);
-										p   += inst2->byte_size();
-										rva += inst2->byte_size();
+						const QVector<QPair<std::size_t, std::size_t>> batch = chunks.mid(i, chunks_per_batch);
 
-										auto inst3 = std::make_shared<edb::Instruction>(p, l, rva);
+#if defined(QT_CONCURRENT_LIB)
+						const QVector<QVector<Gadget>> results = QtConcurrent::blockingMapped<QVector<QVector<Gadget>>>(batch, scan);
+#else
+						QVector<QVector<Gadget>> results;
+						std::transform(batch.begin(), batch.end(), std::back_inserter(results), scan);
+#endif
 
-										if(inst3->valid() && is_jump(*inst3)) {
+						QList<QStandardItem *> items;
 
-											instruction_list.push_back(inst3);
+						for(const QVector<Gadget> &gadgets : results) {
+							for(const Gadget &gadget : gadgets) {
 
-											if(inst2->operand_count() == 1 && is_register(inst2->operand(0))) {
-												if(inst3->operand_count() == 1 && is_register(inst3->operand(0))) {
-													if(inst2->operand(0)->reg == inst3->operand(0)->reg) {
-														add_gadget(instruction_list);
-													}
-												}
-											}
-										}
+								if(unique) {
+									if(unique_results_.contains(gadget.bytes)) {
+										continue;
 									}
+
+									unique_results_.insert(gadget.bytes);
 								}
 
-								// TODO(eteran): catch things like "add rsp, 8; jmp [rsp - 8]" and similar, it's rare,
-								// but could happen
+								auto item = new QStandardItem(QString("%1: %2").arg(edb::v1::format_pointer(gadget.address), gadget.text));
+								item->setData(static_cast<qulonglong>(gadget.address), Qt::UserRole);
+								item->setData(gadget.role, Qt::UserRole + 1);
+								items.push_back(item);
 							}
 						}
 
-						ui->progressBar->setValue(util::percentage(start_address - orig_start, region->size()));
-						++start_address;
+						if(!items.isEmpty()) {
+							result_model_->invisibleRootItem()->appendRows(items);
+						}
+
+						ui->progressBar->setValue(util::percentage(regions_done, sel.size(), i + batch.size(), chunks.size()));
 					}
 				}
 			}
+
+			++regions_done;
 		}
 	}
 }
@@ -20,14 +20,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #define DIALOG_ROPTOOL_20100817_H_
 
 #include "Types.h"
-#include "Instruction.h"
 
 #include <QDialog>
+#include <QByteArray>
 #include <QSet>
 #include <QList>
 #include <QSortFilterProxyModel>
-#include <vector>
-#include <memory>
 
 class QListWidgetItem;
 class QModelIndex;
@@ -90,13 +88,8 @@ public Q_SLOTS:
 	void on_chkShowData_stateChanged(int state);
 	void on_chkShowOther_stateChanged(int state);
 
-private:
-	using InstructionList = std::vector<std::shared_ptr<edb::Instruction>>;
-	
 private:
 	void do_find();
-	void add_gadget(const InstructionList &instructions);
-	void set_gadget_role(QStandardItem *item, const edb::Instruction &inst1);
 
 private:
     void showEvent(QShowEvent *event) override;
@@ -106,7 +99,7 @@ private:
 	QSortFilterProxyModel *  filter_model_;
 	QStandardItemModel *     result_model_;
 	ResultFilterProxy *      result_filter_;
-	QSet<QString>            unique_results_;
+	QSet<QByteArray>         unique_results_;
 };
 
 }
@@ -17,13 +17,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 #include "DialogReferences.h"
-#include "IDebugger.h"
 #include "MemoryRegions.h"
-#include "Util.h"
 #include "edb.h"
 
 #include <QMessageBox>
-#include <QVector>
+#include <algorithm>
 
 #include "ui_DialogReferences.h"
 
@@ -41,6 +39,13 @@ enum Role {
 DialogReferences::DialogReferences(QWidget *parent) : QDialog(parent), ui(new Ui::DialogReferences) {
 	ui->setupUi(this);
 	connect(this, SIGNAL(updateProgress(int)), ui->progressBar, SLOT(setValue(int)));
+
+	// the index is kept between searches, it only has to look at the
+	// debuggee's memory again once the debuggee had a chance to change it
+	connect(edb::v1::debugger_ui, SIGNAL(debugEvent()), this, SLOT(invalidateIndex()));
+	connect(edb::v1::debugger_ui, SIGNAL(gui_updated()), this, SLOT(invalidateIndex()));
+	connect(edb::v1::debugger_ui, SIGNAL(attachEvent()), this, SLOT(clearIndex()));
+	connect(edb::v1::debugger_ui, SIGNAL(detachEvent()), this, SLOT(clearIndex()));
 }
 
 //------------------------------------------------------------------------------
@@ -67,7 +72,6 @@ void DialogReferences::showEvent(QShowEvent *) {
 void DialogReferences::do_find() {
 	bool ok = false;
 	edb::address_t address;
-	const edb::address_t page_size = edb::v1::debugger_core->page_size();
 
 	const QString text = ui->txtAddress->text();
 	if(!text.isEmpty()) {
@@ -77,95 +81,46 @@ void DialogReferences::do_find() {
 
 	if(ok) {
 		edb::v1::memory_regions().sync();
-		const QList<std::shared_ptr<IRegion>> regions = edb::v1::memory_regions().regions();
-
-		int i = 0;
-		for(const std::shared_ptr<IRegion> &region: regions) {
-			// a short circut for speading things up
-			if(region->accessible() || !ui->chkSkipNoAccess->isChecked()) {
-
-				const edb::address_t page_count = region->size() / page_size;
-				const QVector<quint8> pages = edb::v1::read_pages(region->start(), page_count);
-
-				if(!pages.isEmpty()) {
-					const quint8 *p = &pages[0];
-					const quint8 *const pages_end = &pages[0] + region->size();
-
-					while(p != pages_end) {
-
-						if(pages_end - p < edb::v1::pointer_size()) {
-							break;
-						}
-
-						const edb::address_t addr = p - &pages[0] + region->start();
-
-						edb::address_t test_address(0);
-						memcpy(&test_address, p, edb::v1::pointer_size());
-
-						if(test_address == address) {
-							auto item = new QListWidgetItem(edb::v1::format_pointer(addr));
-							item->setData(TypeRole, 'D');
-							item->setData(AddressRole, addr);
-							ui->listWidget->addItem(item);
-						}
-
-						edb::Instruction inst(p, pages_end, addr);
-
-						if(inst) {
-							switch(inst.operation()) {
-							case X86_INS_MOV:
-								// instructions of the form: mov [ADDR], 0xNNNNNNNN
-								Q_ASSERT(inst.operand_count() == 2);
-
-								if(is_expression(inst[0])) {
-									if(is_immediate(inst[1]) && static_cast<edb::address_t>(inst[1]->imm) == address) {
-										auto item = new QListWidgetItem(edb::v1::format_pointer(addr));
-										item->setData(TypeRole, 'C');
-										item->setData(AddressRole, addr);
-										ui->listWidget->addItem(item);
-									}
-								}
-
-								break;
-							case X86_INS_PUSH:
-								// instructions of the form: push 0xNNNNNNNN
-								Q_ASSERT(inst.operand_count() == 1);
-
-								if(is_immediate(inst[0]) && static_cast<edb::address_t>(inst[0]->imm) == address) {
-									auto item = new QListWidgetItem(edb::v1::format_pointer(addr));
-									item->setData(TypeRole, 'C');
-									item->setData(AddressRole, addr);
-									ui->listWidget->addItem(item);
-								}
-								break;
-							default:
-								if(is_jump(inst) || is_call(inst)) {
-									if(is_immediate(inst[0])) {
-										if(static_cast<edb::address_t>(inst[0]->imm) == address) {
-											auto item = new QListWidgetItem(edb::v1::format_pointer(addr));
-											item->setData(TypeRole, 'C');
-											item->setData(AddressRole, addr);
-											ui->listWidget->addItem(item);
-										}
-									}
-								}
-								break;
-							}
-						}
-
-						Q_EMIT updateProgress(util::percentage(i, regions.size(), p - &pages[0], region->size()));
-						++p;
-					}
-				}
-
-			} else {
-				Q_EMIT updateProgress(util::percentage(i, regions.size()));
-			}
-			++i;
+		QList<std::shared_ptr<IRegion>> regions = edb::v1::memory_regions().regions();
+
+		// a short circut for speading things up
+		if(ui->chkSkipNoAccess->isChecked()) {
+			regions.erase(std::remove_if(regions.begin(), regions.end(), [](const std::shared_ptr<IRegion> &region) {
+				return !region->accessible();
+			}), regions.end());
+		}
+
+		// only the regions which changed since they were last indexed get scanned
+		index_.refresh(regions, [this](int percent) {
+			Q_EMIT updateProgress(percent);
+		});
+
+		for(const ReferenceIndex::Reference &reference : index_.find(address)) {
+			auto item = new QListWidgetItem(edb::v1::format_pointer(reference.site));
+			item->setData(TypeRole, reference.type);
+			item->setData(AddressRole, static_cast<qulonglong>(reference.site));
+			ui->listWidget->addItem(item);
 		}
 	}
 }
 
+//------------------------------------------------------------------------------
+// Name: invalidateIndex
+// Desc: the debuggee's memory may have changed, the next search checks which
+//       regions need to be indexed again
+//------------------------------------------------------------------------------
+void DialogReferences::invalidateIndex() {
+	index_.invalidate();
+}
+
+//------------------------------------------------------------------------------
+// Name: clearIndex
+// Desc: a different process is (or no process is) being debugged now
+//------------------------------------------------------------------------------
+void DialogReferences::clearIndex() {
+	index_.clear();
+}
+
 //------------------------------------------------------------------------------
 // Name: on_btnFind_clicked
 // Desc: find button event handler
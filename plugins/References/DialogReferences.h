@@ -22,6 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDialog>
 #include "Types.h"
 #include "IRegion.h"
+#include "ReferenceIndex.h"
 
 class QListWidgetItem;
 
@@ -40,6 +41,10 @@ public Q_SLOTS:
 	void on_btnFind_clicked();
 	void on_listWidget_itemDoubleClicked(QListWidgetItem *item);
 
+private Q_SLOTS:
+	void invalidateIndex();
+	void clearIndex();
+
 Q_SIGNALS:
 	void updateProgress(int);
 
@@ -51,6 +56,7 @@ private:
 
 private:
 	 Ui::DialogReferences *const ui;
+	 ReferenceIndex               index_;
 };
 
 }
@@ -0,0 +1,383 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "ReferenceIndex.h"
+#include "IDebugger.h"
+#include "IRegion.h"
+#include "Instruction.h"
+#include "MemoryRegions.h"
+#include "Util.h"
+#include "edb.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+
+#ifdef QT_CONCURRENT_LIB
+#include <QtConcurrent>
+#endif
+
+namespace ReferencesPlugin {
+
+namespace {
+
+using Reference = ReferenceIndex::Reference;
+using RangeList = QVector<QPair<edb::address_t, edb::address_t>>;
+
+// regions are split into pieces of this size so that a single large region
+// still keeps all of the workers busy
+const std::size_t SCAN_CHUNK_SIZE = 0x100000;
+
+// how much captured memory may wait to be scanned at once
+const std::size_t SNAPSHOT_BATCH_SIZE = 0x10000000;
+
+struct Snapshot {
+	edb::address_t  start;
+	edb::address_t  end;
+	bool            executable;
+	QByteArray      md5;
+	QVector<quint8> memory;
+};
+
+struct ScanJob {
+	const Snapshot *snapshot;
+	std::size_t     first;
+	std::size_t     last;
+};
+
+struct TargetLess {
+	bool operator()(const Reference &reference, edb::address_t target) const {
+		return reference.target < target;
+	}
+
+	bool operator()(edb::address_t target, const Reference &reference) const {
+		return target < reference.target;
+	}
+};
+
+//------------------------------------------------------------------------------
+// Name: is_mapped
+// Desc: returns true if <address> is inside of one of <ranges>
+//------------------------------------------------------------------------------
+bool is_mapped(const RangeList &ranges, edb::address_t address) {
+
+	auto it = std::upper_bound(ranges.begin(), ranges.end(), address, [](edb::address_t value, const QPair<edb::address_t, edb::address_t> &range) {
+		return value < range.first;
+	});
+
+	if(it == ranges.begin()) {
+		return false;
+	}
+
+	--it;
+	return address < it->second;
+}
+
+//------------------------------------------------------------------------------
+// Name: scan_chunk
+// Desc: finds the references made from [first, last) of a snapshot, only
+//       the ones whose target is accepted by <accept> are kept
+// Note: this runs on worker threads, so it may only look at its arguments
+//------------------------------------------------------------------------------
+template <class Accept>
+QVector<Reference> scan_chunk(const ScanJob &job, Accept accept, std::size_t pointer_size) {
+
+	QVector<Reference> references;
+
+	const Snapshot &snapshot   = *job.snapshot;
+	const quint8 *const memory = snapshot.memory.constData();
+	const std::size_t size     = snapshot.memory.size();
+
+	auto add = [&](edb::address_t target, edb::address_t site, char type) {
+		if(accept(target)) {
+			references.push_back({ target, site, type });
+		}
+	};
+
+	// every byte gets decoded, so reuse the same storage for all of them
+	edb::InstructionBuffer buffer;
+
+	for(std::size_t offset = job.first; offset < job.last; ++offset) {
+
+		const edb::address_t site = snapshot.start + offset;
+
+		if(offset + pointer_size <= size) {
+			quint64 value = 0;
+			std::memcpy(&value, memory + offset, pointer_size);
+			add(value, site, ReferenceIndex::DataReference);
+		}
+
+		if(!snapshot.executable) {
+			continue;
+		}
+
+		const edb::Instruction inst(buffer, memory + offset, memory + size, site);
+
+		if(inst) {
+			switch(inst.operation()) {
+			case X86_INS_MOV:
+				// instructions of the form: mov [ADDR], 0xNNNNNNNN
+				Q_ASSERT(inst.operand_count() == 2);
+
+				if(is_expression(inst[0]) && is_immediate(inst[1])) {
+					add(static_cast<edb::address_t>(inst[1]->imm), site, ReferenceIndex::CodeReference);
+				}
+				break;
+			case X86_INS_PUSH:
+				// instructions of the form: push 0xNNNNNNNN
+				Q_ASSERT(inst.operand_count() == 1);
+
+				if(is_immediate(inst[0])) {
+					add(static_cast<edb::address_t>(inst[0]->imm), site, ReferenceIndex::CodeReference);
+				}
+				break;
+			default:
+				if((is_jump(inst) || is_call(inst)) && is_immediate(inst[0])) {
+					add(static_cast<edb::address_t>(inst[0]->imm), site, ReferenceIndex::CodeReference);
+				}
+				break;
+			}
+		}
+	}
+
+	return references;
+}
+
+//------------------------------------------------------------------------------
+// Name: split_jobs
+// Desc: appends the jobs which together cover all of <snapshot> to <jobs>
+//------------------------------------------------------------------------------
+void split_jobs(const Snapshot *snapshot, QVector<ScanJob> *jobs) {
+	const std::size_t size = snapshot->memory.size();
+	for(std::size_t first = 0; first < size; first += SCAN_CHUNK_SIZE) {
+		jobs->push_back({ snapshot, first, std::min(first + SCAN_CHUNK_SIZE, size) });
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: sort_references
+// Desc: orders references by target, then by site
+//------------------------------------------------------------------------------
+void sort_references(QVector<Reference> *references) {
+	std::sort(references->begin(), references->end(), [](const Reference &lhs, const Reference &rhs) {
+		return lhs.target < rhs.target || (lhs.target == rhs.target && lhs.site < rhs.site);
+	});
+}
+
+//------------------------------------------------------------------------------
+// Name: current_memory_map
+// Desc: returns the ranges of every mapped region, in address order
+//------------------------------------------------------------------------------
+RangeList current_memory_map() {
+
+	RangeList mapped;
+	for(const std::shared_ptr<IRegion> &region : edb::v1::memory_regions().regions()) {
+		mapped.push_back(qMakePair(region->start(), region->end()));
+	}
+
+	std::sort(mapped.begin(), mapped.end());
+	return mapped;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: refresh
+// Desc: brings the index up to date with the current contents of <regions>.
+//       Unless the index was marked stale, regions which are already indexed
+//       are kept as they are. Otherwise a region is only scanned again if its
+//       md5 changed
+// Note: only values which point into mapped memory are indexed, which keeps
+//       the index bounded. Each region remembers the memory map it was
+//       indexed against, so a change to the map doesn't invalidate it
+//------------------------------------------------------------------------------
+void ReferenceIndex::refresh(const QList<std::shared_ptr<IRegion>> &regions, const std::function<void(int)> &progress) {
+
+	const edb::address_t page_size = edb::v1::debugger_core->page_size();
+	const std::size_t pointer_size = edb::v1::pointer_size();
+
+	RangeList mapped = current_memory_map();
+	if(!mapped_ || *mapped_ != mapped) {
+		mapped_ = std::make_shared<const RangeList>(std::move(mapped));
+	}
+
+	const std::shared_ptr<const RangeList> ranges = mapped_;
+
+	QMap<edb::address_t, RegionIndex> updated;
+	QVector<std::shared_ptr<Snapshot>> pending;
+	std::size_t pending_size = 0;
+
+	const std::function<QVector<Reference>(const ScanJob &)> scan = [&ranges, pointer_size](const ScanJob &job) {
+		return scan_chunk(job, [&ranges](edb::address_t target) { return is_mapped(*ranges, target); }, pointer_size);
+	};
+
+	auto flush = [&]() {
+		QVector<ScanJob> jobs;
+		for(const std::shared_ptr<Snapshot> &snapshot : pending) {
+			split_jobs(snapshot.get(), &jobs);
+		}
+
+#if defined(QT_CONCURRENT_LIB)
+		const QVector<QVector<Reference>> results = QtConcurrent::blockingMapped<QVector<QVector<Reference>>>(jobs, scan);
+#else
+		QVector<QVector<Reference>> results;
+		std::transform(jobs.begin(), jobs.end(), std::back_inserter(results), scan);
+#endif
+
+		// the jobs of a snapshot are next to each other, in order
+		int job = 0;
+		for(const std::shared_ptr<Snapshot> &snapshot : pending) {
+			RegionIndex index;
+			index.end        = snapshot->end;
+			index.executable = snapshot->executable;
+			index.md5        = snapshot->md5;
+			index.mapped     = ranges;
+
+			for(; job < jobs.size() && jobs[job].snapshot == snapshot.get(); ++job) {
+				index.references += results[job];
+			}
+
+			sort_references(&index.references);
+			updated.insert(snapshot->start, index);
+		}
+
+		pending.clear();
+		pending_size = 0;
+	};
+
+	int regions_done = 0;
+
+	for(const std::shared_ptr<IRegion> &region : regions) {
+
+		progress(util::percentage(regions_done++, regions.size()));
+
+		auto it = regions_.find(region->start());
+		const bool indexed = it != regions_.end() && it->end == region->end();
+
+		// nothing has run since this region was indexed
+		if(indexed && !stale_) {
+			updated.insert(region->start(), *it);
+			continue;
+		}
+
+		QVector<quint8> memory = edb::v1::read_pages(region->start(), region->size() / page_size);
+		if(memory.isEmpty()) {
+			continue;
+		}
+
+		const QByteArray md5 = edb::v1::get_md5(memory);
+
+		if(indexed && it->md5 == md5) {
+			updated.insert(region->start(), *it);
+			continue;
+		}
+
+		auto snapshot        = std::make_shared<Snapshot>();
+		snapshot->start      = region->start();
+		snapshot->end        = region->end();
+		snapshot->executable = region->executable();
+		snapshot->md5        = md5;
+		snapshot->memory     = std::move(memory);
+
+		pending_size += snapshot->memory.size();
+		pending.push_back(snapshot);
+
+		if(pending_size >= SNAPSHOT_BATCH_SIZE) {
+			flush();
+		}
+	}
+
+	flush();
+	regions_ = updated;
+	stale_   = false;
+}
+
+//------------------------------------------------------------------------------
+// Name: find
+// Desc: returns every reference to <target> in address order
+// Note: a region which was indexed while <target> wasn't mapped has no entries
+//       for it, such regions are scanned for <target> directly
+//------------------------------------------------------------------------------
+QVector<ReferenceIndex::Reference> ReferenceIndex::find(edb::address_t target) const {
+
+	const edb::address_t page_size = edb::v1::debugger_core->page_size();
+	const std::size_t pointer_size = edb::v1::pointer_size();
+
+	const std::function<QVector<Reference>(const ScanJob &)> scan = [target, pointer_size](const ScanJob &job) {
+		return scan_chunk(job, [target](edb::address_t value) { return value == target; }, pointer_size);
+	};
+
+	QVector<Reference> results;
+
+	for(auto it = regions_.begin(); it != regions_.end(); ++it) {
+		const RegionIndex &index = *it;
+
+		if(is_mapped(*index.mapped, target)) {
+			const auto range = std::equal_range(index.references.begin(), index.references.end(), target, TargetLess());
+			std::copy(range.first, range.second, std::back_inserter(results));
+			continue;
+		}
+
+		Snapshot snapshot;
+		snapshot.start      = it.key();
+		snapshot.end        = index.end;
+		snapshot.executable = index.executable;
+		snapshot.memory     = edb::v1::read_pages(snapshot.start, (snapshot.end - snapshot.start) / page_size);
+
+		QVector<ScanJob> jobs;
+		split_jobs(&snapshot, &jobs);
+
+#if defined(QT_CONCURRENT_LIB)
+		const QVector<QVector<Reference>> found = QtConcurrent::blockingMapped<QVector<QVector<Reference>>>(jobs, scan);
+#else
+		QVector<QVector<Reference>> found;
+		std::transform(jobs.begin(), jobs.end(), std::back_inserter(found), scan);
+#endif
+
+		QVector<Reference> references;
+		for(const QVector<Reference> &chunk : found) {
+			references += chunk;
+		}
+
+		sort_references(&references);
+		results += references;
+	}
+
+	return results;
+}
+
+//------------------------------------------------------------------------------
+// Name: invalidate
+// Desc: notes that the debuggee may have changed its memory, the next refresh
+//       checks the md5 of every region again
+//------------------------------------------------------------------------------
+void ReferenceIndex::invalidate() {
+	stale_ = true;
+}
+
+//------------------------------------------------------------------------------
+// Name: clear
+// Desc:
+//------------------------------------------------------------------------------
+void ReferenceIndex::clear() {
+	regions_.clear();
+	mapped_ = nullptr;
+	stale_  = true;
+}
+
+}
@@ -0,0 +1,76 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REFERENCE_INDEX_20181022_H_
+#define REFERENCE_INDEX_20181022_H_
+
+#include "Types.h"
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include <functional>
+#include <memory>
+
+class IRegion;
+
+namespace ReferencesPlugin {
+
+// Maps target addresses to the places which refer to them, either as a value
+// stored in memory or as an immediate operand of an instruction. It is kept
+// per region and across searches, a refresh only scans the regions whose
+// contents changed since the index was last marked stale
+class ReferenceIndex {
+public:
+	enum Type : char {
+		DataReference = 'D',
+		CodeReference = 'C'
+	};
+
+	struct Reference {
+		edb::address_t target;
+		edb::address_t site;
+		char           type;
+	};
+
+public:
+	void refresh(const QList<std::shared_ptr<IRegion>> &regions, const std::function<void(int)> &progress);
+	QVector<Reference> find(edb::address_t target) const;
+	void invalidate();
+	void clear();
+
+private:
+	using RangeList = QVector<QPair<edb::address_t, edb::address_t>>;
+
+	struct RegionIndex {
+		edb::address_t                   end;
+		bool                             executable;
+		QByteArray                       md5;
+		std::shared_ptr<const RangeList> mapped;     // the memory map the region was indexed against
+		QVector<Reference>               references; // sorted by target, then site
+	};
+
+	QMap<edb::address_t, RegionIndex> regions_;
+	std::shared_ptr<const RangeList>  mapped_;
+	bool                              stale_ = true; // the debuggee may have changed memory since the last refresh
+};
+
+}
+
+#endif
@@ -159,10 +159,9 @@ void DialogSymbolViewer::mnuFollowInCPU() {
 void DialogSymbolViewer::do_find() {
 	QStringList results;
 
-	const QList<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().symbols();
-	for(const std::shared_ptr<Symbol> &sym: symbols) {
-		results << QString("%1: %2").arg(edb::v1::format_pointer(sym->address), sym->name);
-	}
+	edb::v1::symbol_manager().for_each_symbol([&results](const Symbol &sym) {
+		results << QString("%1: %2").arg(edb::v1::format_pointer(sym.address), sym.name);
+	});
 
 	model_->setStringList(results);
 }
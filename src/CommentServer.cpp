@@ -21,9 +21,14 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "IDebugger.h"
 #include "IProcess.h"
 #include "Instruction.h"
+#include "StringSearch.h"
 #include "edb.h"
 
 #include <QString>
+#include <QTimer>
+#include <QVector>
+#include <algorithm>
+#include <cstring>
 
 //------------------------------------------------------------------------------
 // Name: CommentServer
@@ -46,6 +51,7 @@ CommentServer::~CommentServer() {
 //------------------------------------------------------------------------------
 void CommentServer::set_comment(QHexView::address_t address, const QString &comment) {
 	custom_comments_[address] = comment;
+	cell_comments_.clear();
 }
 
 //------------------------------------------------------------------------------
@@ -54,6 +60,7 @@ void CommentServer::set_comment(QHexView::address_t address, const QString &comm
 //------------------------------------------------------------------------------
 void CommentServer::clear() {
 	custom_comments_.clear();
+	cell_comments_.clear();
 }
 
 // a call can be anywhere from 2 to 7 bytes long depends on if there is a Mod/RM byte
@@ -63,6 +70,9 @@ void CommentServer::clear() {
 #define CALL_MAX_SIZE 7
 #define CALL_MIN_SIZE 2
 
+// how many pointer sized cells are commented at once, about a screen full
+#define PREFETCH_CELLS 64
+
 //------------------------------------------------------------------------------
 // Name: resolve_function_call
 // Desc:
@@ -95,24 +105,73 @@ Result<QString> CommentServer::resolve_function_call(QHexView::address_t address
 }
 
 //------------------------------------------------------------------------------
-// Name: resolve_string
+// Name: clear_cell_comments
 // Desc:
 //------------------------------------------------------------------------------
-Result<QString> CommentServer::resolve_string(QHexView::address_t address) const {
+void CommentServer::clear_cell_comments() {
+	cell_comments_.clear();
+}
+
+//------------------------------------------------------------------------------
+// Name: prefetch_comments
+// Desc: works out the comments of the pointer sized cells from <address> on,
+//       up to the end of the page. All of the cells are read at once and the
+//       strings they point to are resolved in a single batch
+//------------------------------------------------------------------------------
+void CommentServer::prefetch_comments(QHexView::address_t address) const {
+
+	IProcess *const process = edb::v1::debugger_core->process();
+	if(!process) {
+		return;
+	}
 
-	const int min_string_length = edb::v1::config().min_string_length;
-	const int max_string_length = 256;
+	const std::size_t pointer_size = edb::v1::pointer_size();
+	const quint64 page_size        = edb::v1::debugger_core->page_size();
+	const std::size_t remaining    = page_size - (address & (page_size - 1));
 
-	int stringLen;
-	QString temp;
+	QVector<quint8> cells(static_cast<int>(std::max(pointer_size, std::min<std::size_t>(PREFETCH_CELLS * pointer_size, remaining))));
+	const std::size_t read = process->read_bytes(address, cells.data(), cells.size());
 
-	if(edb::v1::get_ascii_string_at_address(address, temp, min_string_length, max_string_length, stringLen)) {
-		return edb::v1::make_result(tr("ASCII \"%1\"").arg(temp));
-	} else if(edb::v1::get_utf16_string_at_address(address, temp, min_string_length, max_string_length, stringLen)) {
-		return edb::v1::make_result(tr("UTF16 \"%1\"").arg(temp));
+	if(cell_comments_.isEmpty()) {
+		// throw them away once the view is done painting
+		QTimer::singleShot(0, this, SLOT(clear_cell_comments()));
 	}
 
-	return Result<QString>(tr("Failed to resolve string"), tr(""));
+	QVector<edb::address_t> targets;
+	QVector<quint64>        target_cells;
+
+	for(std::size_t offset = 0; offset + pointer_size <= read; offset += pointer_size) {
+
+		const quint64 cell = address + offset;
+
+		edb::address_t value(0);
+		std::memcpy(&value, cells.constData() + offset, pointer_size);
+
+		auto it = custom_comments_.find(value);
+		if(it != custom_comments_.end()) {
+			cell_comments_[cell] = it.value();
+		} else if(Result<QString> ret = resolve_function_call(value)) {
+			cell_comments_[cell] = *ret;
+		} else {
+			cell_comments_[cell] = QString();
+			targets.push_back(value);
+			target_cells.push_back(cell);
+		}
+	}
+
+	const QVector<edb::StringHit> strings = edb::v1::get_strings_at_addresses(targets, edb::v1::config().min_string_length, 256);
+
+	// the strings come back in the order of the targets, without the ones
+	// that aren't strings
+	int index = 0;
+	for(const edb::StringHit &string : strings) {
+		while(targets[index] != string.address) {
+			++index;
+		}
+
+		cell_comments_[target_cells[index]] = string.utf16 ? tr("UTF16 \"%1\"").arg(string.text) : tr("ASCII \"%1\"").arg(string.text);
+		++index;
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -121,24 +180,18 @@ Result<QString> CommentServer::resolve_string(QHexView::address_t address) const
 //------------------------------------------------------------------------------
 QString CommentServer::comment(QHexView::address_t address, int size) const {
 
-	if(IProcess *process = edb::v1::debugger_core->process()) {
-		// if the view is currently looking at words which are a pointer in size
-		// then see if it points to anything...
-		if(size == edb::v1::pointer_size()) {
-			edb::address_t value(0);
-			if(process->read_bytes(address, &value, edb::v1::pointer_size())) {
-
-				auto it = custom_comments_.find(value);
-				if(it != custom_comments_.end()) {
-					return it.value();
-				} else {
-					if(Result<QString> ret = resolve_function_call(value)) {
-						return *ret;
-					} else if(Result<QString> ret = resolve_string(value)) {
-						return *ret;
-					}
-				}
-			}
+	// if the view is currently looking at words which are a pointer in size
+	// then see if it points to anything...
+	if(size == edb::v1::pointer_size()) {
+
+		auto it = cell_comments_.find(address);
+		if(it == cell_comments_.end()) {
+			prefetch_comments(address);
+			it = cell_comments_.find(address);
+		}
+
+		if(it != cell_comments_.end()) {
+			return it.value();
 		}
 	}
 
@@ -38,12 +38,20 @@ public:
     QString comment(QHexView::address_t address, int size) const override;
     void clear() override;
 
+private Q_SLOTS:
+	void clear_cell_comments();
+
 private:
 	Result<QString> resolve_function_call(QHexView::address_t address) const;
-	Result<QString> resolve_string(QHexView::address_t address) const;
+	void prefetch_comments(QHexView::address_t address) const;
 
 private:
 	QHash<quint64, QString> custom_comments_;
+
+	// the comments of the cells around the last one asked for, the view asks
+	// for one row at a time so they are worked out together. They are only
+	// kept until control returns to the event loop
+	mutable QHash<quint64, QString> cell_comments_;
 };
 
 #endif
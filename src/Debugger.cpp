@@ -71,6 +71,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QMimeData>
 #include <QSettings>
 #include <QShortcut>
+#include <QSocketNotifier>
 #include <QStringListModel>
 #include <QTimer>
 #include <QToolButton>
@@ -355,9 +356,11 @@ Debugger::Debugger(QWidget *parent) : QMainWindow(parent),
 		stack_view_info_(nullptr),
 		arguments_dialog_(new DialogArguments),
 		timer_(new QTimer(this)),
+		debug_event_notifier_(nullptr),
 		recent_file_manager_(new RecentFileManager(this)),
         comment_server_(new CommentServer),
-		stack_view_locked_(false)
+		stack_view_locked_(false),
+		trace_running_(false)
 #ifdef Q_OS_UNIX
 		,debug_pointer_(0), dynamic_info_bp_set_(false)
 #endif
@@ -521,6 +524,7 @@ void Debugger::update_menu_state(GUI_STATE state) {
 	switch(state) {
 	case PAUSED:
 		ui.actionRun_Until_Return->setEnabled(true);
+		ui.actionTrace_Into->setEnabled(true);
 		ui.action_Restart->setEnabled(true);
 		ui.action_Run->setEnabled(true);
 		ui.action_Pause->setEnabled(false);
@@ -538,6 +542,7 @@ void Debugger::update_menu_state(GUI_STATE state) {
 		break;
 	case RUNNING:
 		ui.actionRun_Until_Return->setEnabled(false);
+		ui.actionTrace_Into->setEnabled(false);
 		ui.action_Restart->setEnabled(false);
 		ui.action_Run->setEnabled(false);
 		ui.action_Pause->setEnabled(true);
@@ -555,6 +560,7 @@ void Debugger::update_menu_state(GUI_STATE state) {
 		break;
 	case TERMINATED:
 		ui.actionRun_Until_Return->setEnabled(false);
+		ui.actionTrace_Into->setEnabled(false);
 		ui.action_Restart->setEnabled(recent_file_manager_->entry_count()>0);
 		ui.action_Run->setEnabled(false);
 		ui.action_Pause->setEnabled(false);
@@ -2734,12 +2740,86 @@ void Debugger::on_actionRun_Until_Return_triggered() {
 				std::bind(&Debugger::on_action_Step_Into_triggered, this));
 }
 
+//------------------------------------------------------------------------------
+// Name: on_actionTrace_Into_triggered
+// Desc: single steps the current thread inside the debugger core until a
+//       breakpoint or anything other than a step happens, or the user pauses.
+//       The GUI is only updated once the trace ends
+//------------------------------------------------------------------------------
+void Debugger::on_actionTrace_Into_triggered() {
+
+	edb::v1::clear_status();
+	Q_ASSERT(edb::v1::debugger_core);
+
+	if(!edb::v1::debugger_core->process()) {
+		return;
+	}
+
+	// the core hands us the event which ended the trace, nothing else may
+	// collect events until then
+	stop_debug_events();
+
+	edb::v1::arch_processor().about_to_resume();
+	edb::v1::debugger_core->clear_trace_log();
+
+	trace_running_ = true;
+	update_menu_state(RUNNING);
+	next_trace_chunk();
+}
+
+//------------------------------------------------------------------------------
+// Name: next_trace_chunk
+// Desc: runs the next TraceOptions::max_steps steps of the trace, the event
+//       loop gets to run in between chunks so the trace can be paused
+//------------------------------------------------------------------------------
+void Debugger::next_trace_chunk() {
+
+	Q_ASSERT(edb::v1::debugger_core);
+
+	// detached or killed in between chunks, there is nothing left to report
+	if(!edb::v1::debugger_core->process()) {
+		trace_running_ = false;
+		return;
+	}
+
+	if(trace_running_) {
+		const std::shared_ptr<IDebugEvent> e = edb::v1::debugger_core->trace_run(IDebugger::TraceOptions());
+
+		// a plain step which didn't land on a breakpoint means the chunk just
+		// ran out of steps
+		if(e && e->stopped() && e->is_trap() && e->trap_reason() == IDebugEvent::TRAP_STEPPING) {
+			State state;
+			edb::v1::debugger_core->get_state(&state);
+
+			const std::shared_ptr<IBreakpoint> bp = edb::v1::debugger_core->find_breakpoint(state.instruction_pointer());
+			if(!bp || !bp->enabled()) {
+				QTimer::singleShot(0, this, SLOT(next_trace_chunk()));
+				return;
+			}
+		}
+	}
+
+	trace_running_ = false;
+	start_debug_events();
+
+	// the event the trace ended with is waiting in the core
+	next_debug_event();
+}
+
 //------------------------------------------------------------------------------
 // Name: on_action_Pause_triggered
 // Desc:
 //------------------------------------------------------------------------------
 void Debugger::on_action_Pause_triggered() {
 	Q_ASSERT(edb::v1::debugger_core);
+
+	// a trace is only ever running in between chunks as far as we can tell,
+	// so it is enough not to start the next one
+	if(trace_running_) {
+		trace_running_ = false;
+		return;
+	}
+
 	if(IProcess *process = edb::v1::debugger_core->process()) {
 		process->pause();
 	}
@@ -2751,7 +2831,8 @@ void Debugger::on_action_Pause_triggered() {
 //------------------------------------------------------------------------------
 void Debugger::cleanup_debugger() {
 
-	timer_->stop();
+	stop_debug_events();
+	trace_running_ = false;
 
 	ui.cpuView->clear_comments();
 	edb::v1::memory_regions().clear();
@@ -2835,6 +2916,37 @@ void Debugger::detach_from_process(DETACH_ACTION kill) {
 	update_menu_state(TERMINATED);
 }
 
+//------------------------------------------------------------------------------
+// Name: start_debug_events
+// Desc: starts collecting debug events from the core
+//------------------------------------------------------------------------------
+void Debugger::start_debug_events() {
+
+	// if the core can tell us when an event is ready, polling is just a safety net
+	const int event_fd = edb::v1::debugger_core->debug_event_fd();
+	if(event_fd != -1) {
+		if(!debug_event_notifier_) {
+			debug_event_notifier_ = new QSocketNotifier(event_fd, QSocketNotifier::Read, this);
+			connect(debug_event_notifier_, SIGNAL(activated(int)), this, SLOT(next_debug_event()));
+		}
+		debug_event_notifier_->setEnabled(true);
+		timer_->start(100);
+	} else {
+		timer_->start(0);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: stop_debug_events
+// Desc: stops collecting debug events from the core
+//------------------------------------------------------------------------------
+void Debugger::stop_debug_events() {
+	timer_->stop();
+	if(debug_event_notifier_) {
+		debug_event_notifier_->setEnabled(false);
+	}
+}
+
 //------------------------------------------------------------------------------
 // Name: set_initial_debugger_state
 // Desc: resets all of the basic data to sane defaults
@@ -2842,7 +2954,7 @@ void Debugger::detach_from_process(DETACH_ACTION kill) {
 void Debugger::set_initial_debugger_state() {
 
 	update_menu_state(PAUSED);
-	timer_->start(0);
+	start_debug_events();
 
 	edb::v1::symbol_manager().clear();
 	edb::v1::memory_regions().sync();
@@ -3417,7 +3529,18 @@ void Debugger::next_debug_event() {
 
 	Q_ASSERT(edb::v1::debugger_core);
 
-	if(std::shared_ptr<IDebugEvent> e = edb::v1::debugger_core->wait_debug_event(10)) {
+	// the core may have had to give up on event notification, go back to polling then
+	if(debug_event_notifier_ && debug_event_notifier_->isEnabled() && edb::v1::debugger_core->debug_event_fd() == -1) {
+		debug_event_notifier_->setEnabled(false);
+		timer_->start(0);
+	}
+
+	// with the notifier in charge we only get here when an event is ready (or
+	// on the safety timer), so there is never a reason to wait for one. Plain
+	// polling still waits a little, so that it doesn't spin
+	const bool notified = debug_event_notifier_ && debug_event_notifier_->isEnabled();
+
+	if(std::shared_ptr<IDebugEvent> e = edb::v1::debugger_core->wait_debug_event(notified ? 0 : 10)) {
 
 		last_event_ = e;
 
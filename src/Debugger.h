@@ -35,6 +35,7 @@ class IDebugEvent;
 class IPlugin;
 class RecentFileManager;
 
+class QSocketNotifier;
 class QStringListModel;
 class QTimer;
 class QToolButton;
@@ -137,6 +138,7 @@ public Q_SLOTS:
 	void on_action_Step_Over_Pass_Signal_To_Application_triggered();
 	void on_action_Step_Over_triggered();
 	void on_actionStep_Out_triggered();
+	void on_actionTrace_Into_triggered();
 	void on_action_Threads_triggered();
 	void on_cpuView_breakPointToggled(edb::address_t);
 	void on_cpuView_customContextMenuRequested(const QPoint &);
@@ -217,6 +219,7 @@ private Q_SLOTS:
 private Q_SLOTS:
 	void goto_triggered();
 	void next_debug_event();
+	void next_trace_chunk();
 	void open_file(const QString &s,const QList<QByteArray> &a);
 	void tab_context_menu(int index, const QPoint &pos);
 	void tty_proc_finished(int exit_code, QProcess::ExitStatus exit_status);
@@ -262,6 +265,8 @@ private:
 	void setup_stack_view();
 	void setup_tab_buttons();
 	void setup_ui();
+	void start_debug_events();
+	void stop_debug_events();
 	void test_native_binary();
 	void setup_data_views();
 	void update_data_views();
@@ -315,6 +320,7 @@ private:
 	QStringListModel *                               list_model_;
 	DialogArguments *                                arguments_dialog_;
 	QTimer *                                         timer_;
+	QSocketNotifier *                                debug_event_notifier_;
 	RecentFileManager *                              recent_file_manager_;
 
 	QSharedPointer<QHexView::CommentServerInterface> comment_server_;
@@ -326,6 +332,7 @@ private:
 	QString                                          working_directory_;
 	QString                                          program_executable_;
 	bool                                             stack_view_locked_;
+	bool                                             trace_running_;
 	std::shared_ptr<const IDebugEvent>               last_event_;
 	QLabel *                                         status_;
 
@@ -50,13 +50,11 @@ ExpressionDialog::ExpressionDialog(const QString &title, const QString &prompt)
 	connect(&expression_, SIGNAL(textChanged(const QString&)), this, SLOT(on_text_changed(const QString&)));
 	expression_.selectAll();
 
-	QList<std::shared_ptr<Symbol>> symbols = edb::v1::symbol_manager().symbols();
 	QList<QString> allLabels;
 
-	for(const std::shared_ptr<Symbol> &sym: symbols)
-	{
-		allLabels.append(sym->name_no_prefix);
-	}
+	edb::v1::symbol_manager().for_each_symbol([&allLabels](const Symbol &sym) {
+		allLabels.append(sym.name_no_prefix);
+	});
 	allLabels.append(edb::v1::symbol_manager().labels().values());
 
 	QCompleter *completer = new QCompleter(allLabels);
@@ -25,6 +25,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <QDebug>
 
+#include <algorithm>
+
 //------------------------------------------------------------------------------
 // Name: MemoryRegions
 // Desc: constructor
@@ -44,56 +46,194 @@ MemoryRegions::~MemoryRegions() {
 // Desc:
 //------------------------------------------------------------------------------
 void MemoryRegions::clear() {
+	beginResetModel();
 	regions_.clear();
+	index_.clear();
+	endResetModel();
 }
 
 //------------------------------------------------------------------------------
 // Name: sync
-// Desc: reads a memory map file line by line
+// Desc: brings the region list up to date with the debuggee, only the rows
+//       which actually changed are reported to any attached views
 //------------------------------------------------------------------------------
 void MemoryRegions::sync() {
 
-	beginResetModel();
-
 	QList<std::shared_ptr<IRegion>> regions;
 
 	if(edb::v1::debugger_core) {
 		if(IProcess *process = edb::v1::debugger_core->process()) {
 			regions = process->regions();
-			Q_FOREACH(const std::shared_ptr<IRegion> &region, regions) {
-				// if the region has a name, is mapped starting
-				// at the beginning of the file, and is executable, sounds
-				// like a module mapping!
-				if(!region->name().isEmpty()) {
-					if(region->base() == 0) {
-						if(region->executable()) {
-							edb::v1::symbol_manager().load_symbol_file(region->name(), region->start());
-						}
-					}
+		}
+	}
+
+	// the process hands back the very same region objects when nothing
+	// changed, so this is cheap and by far the most common case
+	if(regions == regions_) {
+		return;
+	}
+
+	auto by_start = [](const std::shared_ptr<IRegion> &a, const std::shared_ptr<IRegion> &b) {
+		return a->start() < b->start();
+	};
+
+	if(!std::is_sorted(regions.begin(), regions.end(), by_start)) {
+		std::stable_sort(regions.begin(), regions.end(), by_start);
+	}
+
+	// merge the new list into the current one, keeping track of what was
+	// added, removed and changed along the way. index_ is patched along with
+	// regions_ so that it is already up to date when the views are told
+	QList<std::shared_ptr<IRegion>> added;
+
+	int row = 0;
+	int n   = 0;
+
+	while(n < regions.size()) {
+
+		if(row == regions_.size()) {
+			// everything left over is newly mapped
+			beginInsertRows(QModelIndex(), row, row + (regions.size() - n) - 1);
+			for(; n < regions.size(); ++n) {
+				regions_.push_back(regions[n]);
+				index_.push_back({ regions[n]->start(), regions[n]->end() });
+				added.push_back(regions[n]);
+			}
+			endInsertRows();
+			break;
+		}
+
+		const std::shared_ptr<IRegion> &current = regions_[row];
+		const std::shared_ptr<IRegion> &region  = regions[n];
+
+		if(current == region) {
+			++row;
+			++n;
+		} else if(current->start() == region->start()) {
+			// same place, but something about it changed
+			regions_[row] = region;
+			index_[row]   = { region->start(), region->end() };
+			added.push_back(region);
+			Q_EMIT dataChanged(index(row, 0), index(row, columnCount() - 1));
+			++row;
+			++n;
+		} else if(current->start() < region->start()) {
+			// a run of regions which have been unmapped
+			int last = row;
+			while(last + 1 < regions_.size() && regions_[last + 1]->start() < region->start()) {
+				++last;
+			}
+
+			beginRemoveRows(QModelIndex(), row, last);
+			regions_.erase(regions_.begin() + row, regions_.begin() + last + 1);
+			index_.erase(index_.begin() + row, index_.begin() + last + 1);
+			endRemoveRows();
+		} else {
+			// a run of regions which have been newly mapped
+			int last = n;
+			while(last + 1 < regions.size() && regions[last + 1]->start() < current->start()) {
+				++last;
+			}
+
+			beginInsertRows(QModelIndex(), row, row + (last - n));
+			for(; n <= last; ++n, ++row) {
+				regions_.insert(row, regions[n]);
+				index_.insert(index_.begin() + row, { regions[n]->start(), regions[n]->end() });
+				added.push_back(regions[n]);
+			}
+			endInsertRows();
+		}
+	}
+
+	if(row < regions_.size()) {
+		// everything left over has been unmapped
+		beginRemoveRows(QModelIndex(), row, regions_.size() - 1);
+		regions_.erase(regions_.begin() + row, regions_.end());
+		index_.erase(index_.begin() + row, index_.end());
+		endRemoveRows();
+	}
+
+	Q_FOREACH(const std::shared_ptr<IRegion> &region, added) {
+		// if the region has a name, is mapped starting
+		// at the beginning of the file, and is executable, sounds
+		// like a module mapping!
+		if(!region->name().isEmpty()) {
+			if(region->base() == 0) {
+				if(region->executable()) {
+					edb::v1::symbol_manager().load_symbol_file(region->name(), region->start());
 				}
 			}
 		}
 	}
+}
 
+//------------------------------------------------------------------------------
+// Name: find_region_index
+// Desc: returns the row of the region containing <address>, or -1
+//------------------------------------------------------------------------------
+int MemoryRegions::find_region_index(edb::address_t address) const {
 
-	qSwap(regions_, regions);
-	endResetModel();
+	// find the first region which starts after the address, the one before
+	// it is the only one which could possibly contain it
+	auto it = std::upper_bound(index_.begin(), index_.end(), address, [](edb::address_t value, const RegionBounds &bounds) {
+		return value < bounds.start;
+	});
+
+	if(it == index_.begin()) {
+		return -1;
+	}
+
+	--it;
+	if(address < it->end) {
+		return static_cast<int>(it - index_.begin());
+	}
+
+	return -1;
 }
 
 //------------------------------------------------------------------------------
 // Name: find_region
-// Desc:
+// Desc: returns the region containing <address>, or nullptr
 //------------------------------------------------------------------------------
 std::shared_ptr<IRegion> MemoryRegions::find_region(edb::address_t address) const {
 
-	for(const std::shared_ptr<IRegion> &i: regions_) {
-		if(i->contains(address)) {
-			return i;
-		}
+	const int n = find_region_index(address);
+	if(n != -1) {
+		return regions_[n];
 	}
 	return nullptr;
 }
 
+//------------------------------------------------------------------------------
+// Name: find_regions
+// Desc: looks up the regions for many addresses at once, the result has an
+//       entry for each of <addresses> (nullptr where there is no region)
+//------------------------------------------------------------------------------
+QVector<std::shared_ptr<IRegion>> MemoryRegions::find_regions(const QVector<edb::address_t> &addresses) const {
+
+	QVector<std::shared_ptr<IRegion>> ret(addresses.size());
+
+	// addresses tend to come in clusters, so check the last region we found
+	// before falling back to a search
+	int last = -1;
+
+	for(int i = 0; i < addresses.size(); ++i) {
+		const edb::address_t address = addresses[i];
+
+		if(last == -1 || address < index_[last].start || address >= index_[last].end) {
+			const int n = find_region_index(address);
+			if(n == -1) {
+				continue;
+			}
+			last = n;
+		}
+
+		ret[i] = regions_[last];
+	}
+
+	return ret;
+}
+
 //------------------------------------------------------------------------------
 // Name: data
 // Desc:
@@ -0,0 +1,512 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PatternSearch.h"
+#include "RegionSearch.h"
+
+#include <QQueue>
+#include <algorithm>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define EDB_SEARCH_AVX2
+#endif
+
+namespace edb {
+
+namespace {
+
+//------------------------------------------------------------------------------
+// Name: find_pair_scalar
+// Desc: returns the first p in [first, last) where p[0] == b0 and p[1] == b1,
+//       or nullptr if there is none
+// Note: last[0] must be readable
+//------------------------------------------------------------------------------
+const quint8 *find_pair_scalar(const quint8 *first, const quint8 *last, quint8 b0, quint8 b1) {
+
+	while(first < last) {
+		first = static_cast<const quint8 *>(std::memchr(first, b0, last - first));
+		if(!first) {
+			return nullptr;
+		}
+
+		if(first[1] == b1) {
+			return first;
+		}
+
+		++first;
+	}
+
+	return nullptr;
+}
+
+#if defined(__SSE2__)
+//------------------------------------------------------------------------------
+// Name: find_pair_sse2
+// Desc: compares 16 offsets at a time against both bytes
+//------------------------------------------------------------------------------
+const quint8 *find_pair_sse2(const quint8 *first, const quint8 *last, quint8 b0, quint8 b1) {
+
+	const __m128i v0 = _mm_set1_epi8(static_cast<char>(b0));
+	const __m128i v1 = _mm_set1_epi8(static_cast<char>(b1));
+
+	while(last - first >= 16) {
+		const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+		const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first + 1));
+
+		if(const int mask = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, v0), _mm_cmpeq_epi8(b, v1)))) {
+			return first + internal::count_trailing_zeros(static_cast<quint32>(mask));
+		}
+
+		first += 16;
+	}
+
+	return find_pair_scalar(first, last, b0, b1);
+}
+#endif
+
+#if defined(EDB_SEARCH_AVX2)
+//------------------------------------------------------------------------------
+// Name: find_pair_avx2
+// Desc: compares 32 offsets at a time against both bytes
+//------------------------------------------------------------------------------
+__attribute__((target("avx2")))
+const quint8 *find_pair_avx2(const quint8 *first, const quint8 *last, quint8 b0, quint8 b1) {
+
+	const __m256i v0 = _mm256_set1_epi8(static_cast<char>(b0));
+	const __m256i v1 = _mm256_set1_epi8(static_cast<char>(b1));
+
+	while(last - first >= 32) {
+		const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first));
+		const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(first + 1));
+
+		if(const int mask = _mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, v0), _mm256_cmpeq_epi8(b, v1)))) {
+			return first + internal::count_trailing_zeros(static_cast<quint32>(mask));
+		}
+
+		first += 32;
+	}
+
+	return find_pair_scalar(first, last, b0, b1);
+}
+#endif
+
+using find_pair_t = const quint8 *(*)(const quint8 *, const quint8 *, quint8, quint8);
+
+//------------------------------------------------------------------------------
+// Name: select_find_pair
+// Desc: picks the widest implementation the CPU supports
+//------------------------------------------------------------------------------
+find_pair_t select_find_pair() {
+#if defined(EDB_SEARCH_AVX2)
+	// this may run before libgcc has initialized its copy of cpuid
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) {
+		return find_pair_avx2;
+	}
+#endif
+#if defined(__SSE2__)
+	return find_pair_sse2;
+#else
+	return find_pair_scalar;
+#endif
+}
+
+const find_pair_t find_pair = select_find_pair();
+
+//------------------------------------------------------------------------------
+// Name: hex_value
+// Desc: returns the value of a hex digit, or -1
+//------------------------------------------------------------------------------
+int hex_value(QChar ch) {
+	const ushort c = ch.unicode();
+	if(c >= '0' && c <= '9') return c - '0';
+	if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: BytePattern
+// Desc: a pattern without any wildcards
+//------------------------------------------------------------------------------
+BytePattern::BytePattern(const QByteArray &bytes) : bytes_(bytes), masks_(bytes.size(), static_cast<char>(0xff)) {
+}
+
+//------------------------------------------------------------------------------
+// Name: BytePattern
+// Desc: the bits which are clear in <masks> are wildcards
+//------------------------------------------------------------------------------
+BytePattern::BytePattern(const QByteArray &bytes, const QByteArray &masks) : bytes_(bytes), masks_(masks) {
+
+	Q_ASSERT(bytes.size() == masks.size());
+
+	for(int i = 0; i < bytes_.size(); ++i) {
+		bytes_[i] = static_cast<char>(bytes_[i] & masks_[i]);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: from_string
+// Desc:
+//------------------------------------------------------------------------------
+BytePattern BytePattern::from_string(const QString &text, bool *ok) {
+
+	QByteArray bytes;
+	QByteArray masks;
+
+	if(ok) {
+		*ok = false;
+	}
+
+	int  nibbles = 0;
+	char byte    = 0;
+	char mask    = 0;
+
+	for(QChar ch : text) {
+		if(ch.isSpace()) {
+			continue;
+		}
+
+		byte <<= 4;
+		mask <<= 4;
+
+		if(ch != '?') {
+			const int value = hex_value(ch);
+			if(value < 0) {
+				return BytePattern();
+			}
+
+			byte |= value;
+			mask |= 0x0f;
+		}
+
+		if(++nibbles % 2 == 0) {
+			bytes.push_back(byte);
+			masks.push_back(mask);
+			byte = 0;
+			mask = 0;
+		}
+	}
+
+	if(nibbles % 2 != 0 || bytes.isEmpty()) {
+		return BytePattern();
+	}
+
+	if(ok) {
+		*ok = true;
+	}
+
+	return BytePattern(bytes, masks);
+}
+
+//------------------------------------------------------------------------------
+// Name: matches
+// Desc: <p> must have at least size() readable bytes
+//------------------------------------------------------------------------------
+bool BytePattern::matches(const quint8 *p) const {
+
+	const int n = bytes_.size();
+	for(int i = 0; i < n; ++i) {
+		if((p[i] & static_cast<quint8>(masks_[i])) != static_cast<quint8>(bytes_[i])) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: PatternSearch
+// Desc:
+//------------------------------------------------------------------------------
+PatternSearch::PatternSearch(const BytePattern &pattern, std::size_t alignment) : PatternSearch(QVector<BytePattern>{pattern}, alignment) {
+}
+
+//------------------------------------------------------------------------------
+// Name: PatternSearch
+// Desc: empty patterns are ignored, the indexes in the hits still refer to
+//       the position in <patterns>
+//------------------------------------------------------------------------------
+PatternSearch::PatternSearch(const QVector<BytePattern> &patterns, std::size_t alignment) : patterns_(patterns), alignment_(std::max<std::size_t>(alignment, 1)) {
+
+	bool any = false;
+
+	for(int i = 0; i < patterns_.size(); ++i) {
+		const BytePattern &pattern = patterns_[i];
+
+		Literal literal = { 0, 0 };
+		int run_start = 0;
+		for(int j = 0; j < pattern.size(); ++j) {
+			if(pattern.mask(j) != 0xff) {
+				run_start = j + 1;
+			} else if(j + 1 - run_start > literal.length) {
+				literal.offset = run_start;
+				literal.length = j + 1 - run_start;
+			}
+		}
+
+		literals_.push_back(literal);
+
+		if(!pattern.empty()) {
+			any = true;
+			max_size_ = std::max(max_size_, pattern.size());
+			if(literal.length == 0) {
+				unanchored_.push_back(i);
+			}
+		}
+	}
+
+	if(!any) {
+		patterns_.clear();
+		literals_.clear();
+		return;
+	}
+
+	if(patterns_.size() > 1) {
+		build_automaton();
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: build_automaton
+// Desc: builds the Aho-Corasick automaton over the literals of all patterns,
+//       with the failure links folded in so matching is one lookup per byte
+//------------------------------------------------------------------------------
+void PatternSearch::build_automaton() {
+
+	Node root;
+	std::fill(std::begin(root.next), std::end(root.next), -1);
+	root.fail = 0;
+	nodes_.push_back(root);
+
+	for(int i = 0; i < patterns_.size(); ++i) {
+		const Literal &literal = literals_[i];
+		if(literal.length == 0) {
+			continue;
+		}
+
+		int state = 0;
+		for(int j = literal.offset; j < literal.offset + literal.length; ++j) {
+			const quint8 byte = patterns_[i].byte(j);
+			if(nodes_[state].next[byte] == -1) {
+				Node node;
+				std::fill(std::begin(node.next), std::end(node.next), -1);
+				node.fail = 0;
+				nodes_[state].next[byte] = nodes_.size();
+				nodes_.push_back(node);
+			}
+			state = nodes_[state].next[byte];
+		}
+
+		nodes_[state].outputs.push_back(i);
+	}
+
+	QQueue<int> queue;
+	for(int byte = 0; byte < 256; ++byte) {
+		int &next = nodes_[0].next[byte];
+		if(next == -1) {
+			next = 0;
+		} else {
+			nodes_[next].fail = 0;
+			queue.enqueue(next);
+		}
+	}
+
+	while(!queue.isEmpty()) {
+		const int state = queue.dequeue();
+		const int fail  = nodes_[state].fail;
+
+		nodes_[state].outputs += nodes_[fail].outputs;
+
+		for(int byte = 0; byte < 256; ++byte) {
+			const int next = nodes_[state].next[byte];
+			if(next == -1) {
+				nodes_[state].next[byte] = nodes_[fail].next[byte];
+			} else {
+				nodes_[next].fail = nodes_[fail].next[byte];
+				queue.enqueue(next);
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: search
+// Desc:
+//------------------------------------------------------------------------------
+QVector<SearchHit> PatternSearch::search(const void *data, std::size_t size, edb::address_t address) const {
+
+	QVector<SearchHit> hits;
+
+	if(valid()) {
+		const auto first = static_cast<const quint8 *>(data);
+
+		if(patterns_.size() == 1) {
+			if(unanchored_.isEmpty()) {
+				search_single(first, size, address, &hits);
+			} else {
+				search_unanchored(first, size, address, &hits);
+			}
+		} else {
+			search_multiple(first, size, address, &hits);
+			search_unanchored(first, size, address, &hits);
+
+			std::sort(hits.begin(), hits.end(), [](const SearchHit &lhs, const SearchHit &rhs) {
+				return lhs.address < rhs.address || (lhs.address == rhs.address && lhs.pattern < rhs.pattern);
+			});
+		}
+	}
+
+	return hits;
+}
+
+//------------------------------------------------------------------------------
+// Name: search_single
+// Desc: finds candidates by the first one or two bytes of the literal
+//------------------------------------------------------------------------------
+void PatternSearch::search_single(const quint8 *first, std::size_t size, edb::address_t address, QVector<SearchHit> *hits) const {
+
+	const BytePattern &pattern = patterns_[0];
+	const Literal &literal     = literals_[0];
+	const std::size_t length   = pattern.size();
+
+	if(size < length) {
+		return;
+	}
+
+	// where the literal may start so that the whole pattern fits
+	const quint8 *p           = first + literal.offset;
+	const quint8 *const limit = first + (size - length) + literal.offset + 1;
+	const quint8 b0           = pattern.byte(literal.offset);
+
+	while(p < limit) {
+		if(literal.length >= 2) {
+			p = find_pair(p, limit, b0, pattern.byte(literal.offset + 1));
+		} else {
+			p = static_cast<const quint8 *>(std::memchr(p, b0, limit - p));
+		}
+
+		if(!p) {
+			break;
+		}
+
+		const quint8 *const start   = p - literal.offset;
+		const edb::address_t found = address + static_cast<std::size_t>(start - first);
+		if(found % alignment_ == 0 && pattern.matches(start)) {
+			hits->push_back({ found, 0 });
+		}
+
+		++p;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: search_multiple
+// Desc: runs the automaton over the data, every time it reaches the end of a
+//       literal the owning pattern is compared in full
+//------------------------------------------------------------------------------
+void PatternSearch::search_multiple(const quint8 *first, std::size_t size, edb::address_t address, QVector<SearchHit> *hits) const {
+
+	if(nodes_.isEmpty()) {
+		return;
+	}
+
+	const Node *const nodes = nodes_.constData();
+
+	int state = 0;
+	for(std::size_t i = 0; i < size; ++i) {
+		state = nodes[state].next[first[i]];
+
+		for(int index : nodes[state].outputs) {
+			const BytePattern &pattern = patterns_[index];
+			const Literal &literal     = literals_[index];
+
+			// the literal ends at i, see if the pattern around it fits
+			const std::size_t before = literal.offset + literal.length - 1;
+			if(i < before) {
+				continue;
+			}
+
+			const std::size_t start = i - before;
+			if(start + pattern.size() > size) {
+				continue;
+			}
+
+			const edb::address_t found = address + start;
+			if(found % alignment_ == 0 && pattern.matches(first + start)) {
+				hits->push_back({ found, index });
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: search_unanchored
+// Desc: patterns made up of wildcard nibbles only have nothing to look for
+//       up front, so they are compared at every offset
+//------------------------------------------------------------------------------
+void PatternSearch::search_unanchored(const quint8 *first, std::size_t size, edb::address_t address, QVector<SearchHit> *hits) const {
+
+	for(int index : unanchored_) {
+		const BytePattern &pattern = patterns_[index];
+		const std::size_t length   = pattern.size();
+
+		for(std::size_t i = 0; i + length <= size; ++i) {
+			const edb::address_t found = address + i;
+			if(found % alignment_ == 0 && pattern.matches(first + i)) {
+				hits->push_back({ found, index });
+			}
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: search_regions
+// Desc: each chunk also carries the first bytes of the next one, so that
+//       matches crossing the edge are still found
+//------------------------------------------------------------------------------
+void PatternSearch::search_regions(const QList<std::shared_ptr<IRegion>> &regions, const HitHandler &handler) const {
+
+	if(!valid()) {
+		return;
+	}
+
+	const std::function<QVector<SearchHit>(const internal::SearchChunk &)> search_chunk = [this](const internal::SearchChunk &chunk) {
+		QVector<SearchHit> hits = search(chunk.bytes.constData(), chunk.bytes.size(), chunk.address);
+
+		// the overlap belongs to the next chunk
+		auto it = std::find_if(hits.begin(), hits.end(), [&chunk](const SearchHit &hit) {
+			return hit.address - chunk.address >= chunk.end;
+		});
+
+		hits.erase(it, hits.end());
+		return hits;
+	};
+
+	internal::search_regions<SearchHit>(regions, 0, max_size_ - 1, search_chunk, handler);
+}
+
+}
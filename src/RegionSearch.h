@@ -0,0 +1,162 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef REGION_SEARCH_20181112_H_
+#define REGION_SEARCH_20181112_H_
+
+#include "IDebugger.h"
+#include "IProcess.h"
+#include "IRegion.h"
+#include "Types.h"
+#include "edb.h"
+
+#include <QList>
+#include <QThread>
+#include <QVector>
+#include <algorithm>
+#include <cstddef>
+#include <functional>
+#include <iterator>
+#include <memory>
+
+#ifdef QT_CONCURRENT_LIB
+#include <QtConcurrent>
+#endif
+
+// the parts the bulk memory searches (PatternSearch, StringSearch) have in
+// common, these are not part of the exported API
+
+namespace edb {
+namespace internal {
+
+// regions are read this much at a time
+const std::size_t SEARCH_CHUNK_SIZE = 0x400000;
+
+// a piece of a region as it is handed to a search, hits have to start in
+// [begin, end) of the bytes. The bytes around that are only there so that
+// matches crossing the edge of the chunk can be told apart
+struct SearchChunk {
+	edb::address_t  address; // of the first byte
+	std::size_t     begin;
+	std::size_t     end;
+	QVector<quint8> bytes;
+};
+
+//------------------------------------------------------------------------------
+// Name: count_trailing_zeros
+// Desc:
+//------------------------------------------------------------------------------
+inline int count_trailing_zeros(quint32 value) {
+#if defined(__GNUC__)
+	return __builtin_ctz(value);
+#else
+	int n = 0;
+	while(!(value & 1)) {
+		value >>= 1;
+		++n;
+	}
+	return n;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: search_regions
+// Desc: reads the memory of the debuggee in chunks of SEARCH_CHUNK_SIZE bytes,
+//       each carrying up to <lead> bytes before it and <overlap> bytes after
+//       it. The chunks are searched in batches with <search_chunk>, and the
+//       hits of each batch are passed to <handler> in address order along
+//       with the overall progress. <handler> returning false stops the search
+// Note: reading, as well as calling <handler>, happens on the calling thread.
+//       Only <search_chunk> runs in parallel
+//------------------------------------------------------------------------------
+template <class Hit>
+void search_regions(const QList<std::shared_ptr<IRegion>> &regions, std::size_t lead, std::size_t overlap, const std::function<QVector<Hit>(const SearchChunk &)> &search_chunk, const std::function<bool(const QVector<Hit> &, int)> &handler) {
+
+	if(!edb::v1::debugger_core) {
+		return;
+	}
+
+	IProcess *const process = edb::v1::debugger_core->process();
+	if(!process) {
+		return;
+	}
+
+	quint64 total_size = 0;
+	for(const std::shared_ptr<IRegion> &region : regions) {
+		total_size += region->size();
+	}
+
+	const int chunks_per_batch = std::max(1, QThread::idealThreadCount()) * 2;
+
+	QVector<SearchChunk> batch;
+	quint64 done_size = 0;
+
+	auto flush = [&]() {
+#if defined(QT_CONCURRENT_LIB)
+		const QVector<QVector<Hit>> results = QtConcurrent::blockingMapped<QVector<QVector<Hit>>>(batch, search_chunk);
+#else
+		QVector<QVector<Hit>> results;
+		std::transform(batch.begin(), batch.end(), std::back_inserter(results), search_chunk);
+#endif
+		batch.clear();
+
+		QVector<Hit> hits;
+		for(const QVector<Hit> &chunk_hits : results) {
+			hits += chunk_hits;
+		}
+
+		const int percent = total_size ? static_cast<int>(done_size * 100 / total_size) : 100;
+		return handler(hits, percent);
+	};
+
+	for(const std::shared_ptr<IRegion> &region : regions) {
+
+		for(edb::address_t address = region->start(); address < region->end(); address += SEARCH_CHUNK_SIZE) {
+
+			const std::size_t size       = std::min<std::size_t>(SEARCH_CHUNK_SIZE, region->end() - address);
+			const std::size_t rest       = region->end() - address - size;
+			const std::size_t chunk_lead = std::min<std::size_t>(lead, address - region->start());
+
+			SearchChunk chunk;
+			chunk.address = address - chunk_lead;
+			chunk.begin   = chunk_lead;
+			chunk.end     = chunk_lead + size;
+			chunk.bytes.resize(chunk_lead + size + std::min(rest, overlap));
+
+			// reading has to happen on this thread
+			const std::size_t read = process->read_bytes(chunk.address, chunk.bytes.data(), chunk.bytes.size());
+			done_size += size;
+
+			if(read > chunk_lead) {
+				chunk.bytes.resize(read);
+				batch.push_back(chunk);
+			}
+
+			if(batch.size() >= chunks_per_batch && !flush()) {
+				return;
+			}
+		}
+	}
+
+	flush();
+}
+
+}
+}
+
+#endif
@@ -0,0 +1,326 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "StringSearch.h"
+#include "RegionSearch.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace edb {
+
+namespace {
+
+// how many bytes before a chunk are needed to tell if a string runs into it
+const std::size_t LEAD_SIZE = 2;
+
+//------------------------------------------------------------------------------
+// Name: is_ascii_char
+// Desc: printable characters and whitespace, the same as std::isprint and
+//       std::isspace accept in the C locale
+//------------------------------------------------------------------------------
+bool is_ascii_char(quint8 ch) {
+	return (ch >= 0x20 && ch < 0x7f) || (ch >= 0x09 && ch <= 0x0d);
+}
+
+//------------------------------------------------------------------------------
+// Name: is_utf16_char
+// Desc: for now, we only acknowledge ASCII chars encoded as unicode
+//------------------------------------------------------------------------------
+bool is_utf16_char(const quint8 *p) {
+	return p[0] >= 0x20 && p[0] < 0x80 && p[1] == 0;
+}
+
+#if defined(__SSE2__)
+//------------------------------------------------------------------------------
+// Name: ascii_mask_sse2
+// Desc: bit n is set when first[n] is an ASCII string character
+// Note: the compares are signed, so bytes from 0x80 up fail both ranges
+//------------------------------------------------------------------------------
+quint32 ascii_mask_sse2(const quint8 *first) {
+
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+
+	const __m128i printable = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f)), _mm_cmplt_epi8(v, _mm_set1_epi8(0x7f)));
+	const __m128i space     = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x08)), _mm_cmplt_epi8(v, _mm_set1_epi8(0x0e)));
+
+	return static_cast<quint32>(_mm_movemask_epi8(_mm_or_si128(printable, space)));
+}
+
+//------------------------------------------------------------------------------
+// Name: utf16_mask_sse2
+// Desc: bit 2n is set when the 16-bit unit at first[2n] is a UTF-16 string
+//       character, the odd bits are always clear
+//------------------------------------------------------------------------------
+quint32 utf16_mask_sse2(const quint8 *first) {
+
+	const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(first));
+
+	const quint32 low  = static_cast<quint32>(_mm_movemask_epi8(_mm_cmpgt_epi8(v, _mm_set1_epi8(0x1f))));
+	const quint32 zero = static_cast<quint32>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_setzero_si128())));
+
+	return low & (zero >> 1) & 0x5555;
+}
+#endif
+
+//------------------------------------------------------------------------------
+// Name: find_ascii
+// Desc: returns the first offset in [i, end) where being an ASCII string
+//       character is <wanted>, or end if there is none
+//------------------------------------------------------------------------------
+std::size_t find_ascii(const quint8 *first, std::size_t i, std::size_t end, bool wanted) {
+
+#if defined(__SSE2__)
+	while(i + 16 <= end) {
+		const quint32 mask = wanted ? ascii_mask_sse2(first + i) : ~ascii_mask_sse2(first + i) & 0xffff;
+		if(mask) {
+			return i + internal::count_trailing_zeros(mask);
+		}
+
+		i += 16;
+	}
+#endif
+
+	while(i < end && is_ascii_char(first[i]) != wanted) {
+		++i;
+	}
+
+	return i;
+}
+
+//------------------------------------------------------------------------------
+// Name: find_utf16
+// Desc: returns the first of the offsets i, i + 2, ... where being a UTF-16
+//       string character is <wanted>
+// Note: if there is none, the offset returned is one where a whole unit no
+//       longer fits before <end>
+//------------------------------------------------------------------------------
+std::size_t find_utf16(const quint8 *first, std::size_t i, std::size_t end, bool wanted) {
+
+#if defined(__SSE2__)
+	while(i + 16 <= end) {
+		const quint32 mask = wanted ? utf16_mask_sse2(first + i) : ~utf16_mask_sse2(first + i) & 0x5555;
+		if(mask) {
+			return i + internal::count_trailing_zeros(mask);
+		}
+
+		i += 16;
+	}
+#endif
+
+	while(i + 2 <= end && is_utf16_char(first + i) != wanted) {
+		i += 2;
+	}
+
+	return i;
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: escape_string
+// Desc: replaces the characters which need an escape char with the escape
+//       sequence
+//------------------------------------------------------------------------------
+QString StringSearch::escape_string(QString s) {
+	s.replace("\r", "\\r");
+	s.replace("\n", "\\n");
+	s.replace("\t", "\\t");
+	s.replace("\v", "\\v");
+	s.replace("\"", "\\\"");
+	return s;
+}
+
+//------------------------------------------------------------------------------
+// Name: string_length
+// Desc: returns how many string characters the <size> bytes at <data> start
+//       with, at most <max_length>
+//------------------------------------------------------------------------------
+int StringSearch::string_length(const void *data, std::size_t size, int max_length, bool utf16) {
+
+	if(max_length <= 0) {
+		return 0;
+	}
+
+	const auto first = static_cast<const quint8 *>(data);
+
+	if(utf16) {
+		const std::size_t end = std::min<std::size_t>(size, static_cast<std::size_t>(max_length) * 2) & ~std::size_t(1);
+		return static_cast<int>(std::min(find_utf16(first, 0, end, false), end) / 2);
+	}
+
+	const std::size_t end = std::min<std::size_t>(size, max_length);
+	return static_cast<int>(find_ascii(first, 0, end, false));
+}
+
+//------------------------------------------------------------------------------
+// Name: string_text
+// Desc: returns the <length> characters at <data> as they are, without escapes
+//------------------------------------------------------------------------------
+QString StringSearch::string_text(const void *data, int length, bool utf16) {
+
+	const auto first = static_cast<const quint8 *>(data);
+
+	if(!utf16) {
+		return QString::fromLatin1(reinterpret_cast<const char *>(first), length);
+	}
+
+	QString text;
+	text.reserve(length);
+	for(int i = 0; i < length; ++i) {
+		text += QChar(first[i * 2]);
+	}
+
+	return text;
+}
+
+//------------------------------------------------------------------------------
+// Name: StringSearch
+// Desc:
+//------------------------------------------------------------------------------
+StringSearch::StringSearch(int min_length, int max_length, bool utf16) : min_length_(std::max(1, min_length)), max_length_(max_length), utf16_(utf16) {
+}
+
+//------------------------------------------------------------------------------
+// Name: search
+// Desc:
+//------------------------------------------------------------------------------
+QVector<StringHit> StringSearch::search(const void *data, std::size_t size, edb::address_t address) const {
+
+	QVector<StringHit> hits;
+
+	if(valid()) {
+		search_range(static_cast<const quint8 *>(data), size, 0, size, address, &hits);
+	}
+
+	return hits;
+}
+
+//------------------------------------------------------------------------------
+// Name: search_range
+// Desc: finds the strings which start in [begin, end) of the <size> bytes at
+//       <first>, the bytes around the range are only looked at to tell where
+//       the strings start and end
+//------------------------------------------------------------------------------
+void StringSearch::search_range(const quint8 *first, std::size_t size, std::size_t begin, std::size_t end, edb::address_t address, QVector<StringHit> *hits) const {
+
+	search_ascii(first, size, begin, end, address, hits);
+
+	if(utf16_) {
+		search_utf16(first, size, begin, end, address, hits);
+
+		std::sort(hits->begin(), hits->end(), [](const StringHit &a, const StringHit &b) {
+			return a.address < b.address;
+		});
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: search_ascii
+// Desc:
+//------------------------------------------------------------------------------
+void StringSearch::search_ascii(const quint8 *first, std::size_t size, std::size_t begin, std::size_t end, edb::address_t address, QVector<StringHit> *hits) const {
+
+	std::size_t i = begin;
+
+	// a string running into the range was found along with the bytes before it
+	if(i > 0 && is_ascii_char(first[i - 1])) {
+		i = find_ascii(first, i, size, false);
+	}
+
+	while(i < end) {
+		const std::size_t start = find_ascii(first, i, end, true);
+		if(start == end) {
+			break;
+		}
+
+		const std::size_t stop   = find_ascii(first, start, size, false);
+		const std::size_t length = stop - start;
+
+		if(length >= static_cast<std::size_t>(min_length_)) {
+			const int n = static_cast<int>(std::min<std::size_t>(length, max_length_));
+			hits->push_back({ address + start, n, false, escape_string(string_text(first + start, n, false)) });
+		}
+
+		i = stop;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: search_utf16
+// Desc: the units may be at either alignment, so both are searched
+//------------------------------------------------------------------------------
+void StringSearch::search_utf16(const quint8 *first, std::size_t size, std::size_t begin, std::size_t end, edb::address_t address, QVector<StringHit> *hits) const {
+
+	for(std::size_t alignment = 0; alignment < 2; ++alignment) {
+
+		std::size_t i = begin + alignment;
+
+		// a string running into the range was found along with the bytes before it
+		if(i >= 2 && i <= size && is_utf16_char(first + i - 2)) {
+			i = find_utf16(first, i, size, false);
+		}
+
+		while(i < end) {
+			const std::size_t start = find_utf16(first, i, size, true);
+			if(start >= end || start + 2 > size) {
+				break;
+			}
+
+			const std::size_t stop   = find_utf16(first, start, size, false);
+			const std::size_t length = (stop - start) / 2;
+
+			if(length >= static_cast<std::size_t>(min_length_)) {
+				const int n = static_cast<int>(std::min<std::size_t>(length, max_length_));
+				hits->push_back({ address + start, n, true, escape_string(string_text(first + start, n, true)) });
+			}
+
+			i = stop;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: search_regions
+// Desc: each chunk also carries the bytes just before it, which tell if a
+//       string runs into it, and the bytes needed to finish a string which
+//       starts at its end
+//------------------------------------------------------------------------------
+void StringSearch::search_regions(const QList<std::shared_ptr<IRegion>> &regions, const HitHandler &handler) const {
+
+	if(!valid()) {
+		return;
+	}
+
+	const std::function<QVector<StringHit>(const internal::SearchChunk &)> search_chunk = [this](const internal::SearchChunk &chunk) {
+		QVector<StringHit> hits;
+		const std::size_t size = chunk.bytes.size();
+		search_range(chunk.bytes.constData(), size, chunk.begin, std::min(chunk.end, size), chunk.address, &hits);
+		return hits;
+	};
+
+	// enough to finish the longest string that gets reported
+	const std::size_t overlap = static_cast<std::size_t>(max_length_) * (utf16_ ? 2 : 1);
+
+	internal::search_regions<StringHit>(regions, LEAD_SIZE, overlap, search_chunk, handler);
+}
+
+}
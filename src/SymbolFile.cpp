@@ -0,0 +1,652 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "SymbolFile.h"
+#include "Symbol.h"
+
+#include <QDateTime>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QVector>
+#include <QtDebug>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+
+// the layout of a symbol file on disk, the entries, the name index and the
+// string table follow the header in that order. Everything is naturally
+// aligned and in host byte order so that it can be used in place
+struct SymbolFile::Header {
+	char    magic[8];
+	quint32 version;
+	quint32 count;
+	quint64 map_size;            // of the text symbol file this was converted from
+	qint64  map_modified;
+	quint64 library_size;        // of the library when its md5 was last checked
+	qint64  library_modified;    // 0 if it has never been checked
+	char    library_md5[16];
+	quint32 library_name;        // offset of the library's path in the string table
+	quint32 library_name_length;
+	quint64 strings_size;
+};
+
+struct SymbolFile::Entry {
+	quint64 address;
+	quint32 size;
+	quint32 name;        // offset of the name in the string table
+	quint32 name_length;
+	char    type;
+	char    reserved[3];
+};
+
+namespace {
+
+const char    SYMBOL_FILE_MAGIC[8] = { 'E', 'D', 'B', 'S', 'Y', 'M', 'B', 'L' };
+const quint32 SYMBOL_FILE_VERSION  = 1;
+
+//------------------------------------------------------------------------------
+// Name: is_space
+// Desc:
+//------------------------------------------------------------------------------
+bool is_space(char ch) {
+	return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r' || ch == '\v' || ch == '\f';
+}
+
+//------------------------------------------------------------------------------
+// Name: skip_space
+// Desc:
+//------------------------------------------------------------------------------
+void skip_space(const char *&p, const char *end) {
+	while(p != end && is_space(*p)) {
+		++p;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: read_token
+// Desc: reads the next whitespace delimited token
+//------------------------------------------------------------------------------
+QByteArray read_token(const char *&p, const char *end) {
+	skip_space(p, end);
+
+	const char *const first = p;
+	while(p != end && !is_space(*p)) {
+		++p;
+	}
+
+	return QByteArray(first, p - first);
+}
+
+//------------------------------------------------------------------------------
+// Name: read_line
+// Desc: reads the rest of the current line, the newline is consumed but not
+//       returned
+//------------------------------------------------------------------------------
+QByteArray read_line(const char *&p, const char *end) {
+	const char *const first = p;
+	while(p != end && *p != '\n') {
+		++p;
+	}
+
+	const QByteArray line(first, p - first);
+	if(p != end) {
+		++p;
+	}
+
+	return line;
+}
+
+//------------------------------------------------------------------------------
+// Name: read_hex
+// Desc: reads a hexadecimal number, with or without a 0x prefix
+//------------------------------------------------------------------------------
+bool read_hex(const char *&p, const char *end, quint64 *value) {
+	skip_space(p, end);
+
+	if(end - p > 2 && p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+		p += 2;
+	}
+
+	const char *const first = p;
+	quint64 n = 0;
+
+	for(; p != end; ++p) {
+		const char ch = *p;
+		if(ch >= '0' && ch <= '9') {
+			n = (n << 4) | (ch - '0');
+		} else if(ch >= 'a' && ch <= 'f') {
+			n = (n << 4) | (ch - 'a' + 10);
+		} else if(ch >= 'A' && ch <= 'F') {
+			n = (n << 4) | (ch - 'A' + 10);
+		} else {
+			break;
+		}
+	}
+
+	*value = n;
+	return p != first;
+}
+
+//------------------------------------------------------------------------------
+// Name: compare_names
+// Desc: orders names bytewise, a name sorts before any longer name it is a
+//       prefix of
+//------------------------------------------------------------------------------
+int compare_names(const char *lhs, quint32 lhs_length, const char *rhs, quint32 rhs_length) {
+	if(const int r = std::memcmp(lhs, rhs, std::min(lhs_length, rhs_length))) {
+		return r;
+	}
+
+	return (lhs_length > rhs_length) - (lhs_length < rhs_length);
+}
+
+}
+
+//------------------------------------------------------------------------------
+// Name: open
+// Desc: maps the symbol file <filename>, returns nullptr if it doesn't exist or
+//       is not a valid symbol file
+//------------------------------------------------------------------------------
+std::shared_ptr<SymbolFile> SymbolFile::open(const QString &filename) {
+
+	std::shared_ptr<SymbolFile> file(new SymbolFile(filename));
+	if(!file->load()) {
+		return nullptr;
+	}
+
+	return file;
+}
+
+//------------------------------------------------------------------------------
+// Name: convert
+// Desc: creates the symbol file <filename> from the text symbol file <map_file>
+// Note: like the text parser it replaces, a corrupt line ends the conversion
+//       but everything before it is kept
+//------------------------------------------------------------------------------
+bool SymbolFile::convert(const QString &map_file, const QString &filename) {
+
+	QFile input(map_file);
+	if(!input.open(QIODevice::ReadOnly) || input.size() == 0) {
+		return false;
+	}
+
+	const QFileInfo map_info(map_file);
+
+	const char *p = reinterpret_cast<const char *>(input.map(0, input.size()));
+	if(!p) {
+		return false;
+	}
+
+	const char *const end = p + input.size();
+
+	// the first line is the date that the file was generated, it is followed
+	// by the md5 and the path of the library
+	read_line(p, end);
+	const QByteArray md5     = QByteArray::fromHex(read_token(p, end));
+	const QByteArray library = read_token(p, end);
+
+	if(library.isEmpty()) {
+		return false;
+	}
+
+	QVector<Entry> entries;
+	QByteArray     strings = library;
+
+	while(true) {
+		skip_space(p, end);
+		if(p == end) {
+			break;
+		}
+
+		quint64 start;
+		quint64 size;
+
+		if(!read_hex(p, end, &start) || !read_hex(p, end, &size) || (skip_space(p, end), p == end)) {
+			qWarning() << "WARNING: File" << map_file << "seems corrupt";
+			break;
+		}
+
+		const char type = *p++;
+
+		// the name may have spaces if it was demangled, so it is the rest of the line
+		const QByteArray name = read_line(p, end).trimmed();
+
+		Entry entry = {};
+		entry.address     = start;
+		entry.size        = static_cast<quint32>(size);
+		entry.name        = strings.size();
+		entry.name_length = name.size();
+		entry.type        = type;
+
+		strings += name;
+		entries.push_back(entry);
+	}
+
+	// when several symbols share an address or a name, the last one wins,
+	// so the order of the file is preserved among them
+	std::stable_sort(entries.begin(), entries.end(), [](const Entry &lhs, const Entry &rhs) {
+		return lhs.address < rhs.address;
+	});
+
+	QVector<quint32> names(entries.size());
+	for(int i = 0; i < names.size(); ++i) {
+		names[i] = i;
+	}
+
+	const char *const string_table = strings.constData();
+	std::stable_sort(names.begin(), names.end(), [&entries, string_table](quint32 lhs, quint32 rhs) {
+		const Entry &a = entries[lhs];
+		const Entry &b = entries[rhs];
+		return compare_names(string_table + a.name, a.name_length, string_table + b.name, b.name_length) < 0;
+	});
+
+	Header header = {};
+	std::memcpy(header.magic, SYMBOL_FILE_MAGIC, sizeof(header.magic));
+	header.version             = SYMBOL_FILE_VERSION;
+	header.count               = entries.size();
+	header.map_size            = map_info.size();
+	header.map_modified        = map_info.lastModified().toMSecsSinceEpoch();
+	header.library_name        = 0;
+	header.library_name_length = library.size();
+	header.strings_size        = strings.size();
+
+	if(md5.size() == sizeof(header.library_md5)) {
+		std::memcpy(header.library_md5, md5.constData(), sizeof(header.library_md5));
+	}
+
+	QSaveFile file(filename);
+	if(!file.open(QIODevice::WriteOnly)) {
+		qDebug() << "Unable to write symbol file" << filename;
+		return false;
+	}
+
+	file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(entries.constData()), entries.size() * sizeof(Entry));
+	file.write(reinterpret_cast<const char *>(names.constData()), names.size() * sizeof(quint32));
+	file.write(strings);
+
+	if(!file.commit()) {
+		qDebug() << "Unable to write symbol file" << filename;
+		return false;
+	}
+
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: mark_verified
+// Desc: records that the md5 of <library> has been checked against the symbol
+//       file <filename>, so it doesn't need to be checked again until the
+//       library changes
+//------------------------------------------------------------------------------
+bool SymbolFile::mark_verified(const QString &filename, const QFileInfo &library) {
+
+	QFile file(filename);
+	if(!file.open(QIODevice::ReadWrite) || !file.seek(offsetof(Header, library_size))) {
+		return false;
+	}
+
+	const quint64 size     = library.size();
+	const qint64  modified = library.lastModified().toMSecsSinceEpoch();
+
+	return file.write(reinterpret_cast<const char *>(&size), sizeof(size)) == sizeof(size) &&
+		file.write(reinterpret_cast<const char *>(&modified), sizeof(modified)) == sizeof(modified);
+}
+
+//------------------------------------------------------------------------------
+// Name: SymbolFile
+// Desc:
+//------------------------------------------------------------------------------
+SymbolFile::SymbolFile(const QString &filename) : map_(filename) {
+}
+
+//------------------------------------------------------------------------------
+// Name: load
+// Desc: maps the file and checks that it is complete
+//------------------------------------------------------------------------------
+bool SymbolFile::load() {
+
+	if(!map_.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	const qint64 size = map_.size();
+	if(size < static_cast<qint64>(sizeof(Header))) {
+		return false;
+	}
+
+	const uchar *const map = map_.map(0, size);
+	if(!map) {
+		return false;
+	}
+
+	auto header = reinterpret_cast<const Header *>(map);
+
+	if(std::memcmp(header->magic, SYMBOL_FILE_MAGIC, sizeof(header->magic)) != 0 || header->version != SYMBOL_FILE_VERSION) {
+		return false;
+	}
+
+	const quint64 expected_size = sizeof(Header) +
+		header->count * static_cast<quint64>(sizeof(Entry)) +
+		header->count * static_cast<quint64>(sizeof(quint32)) +
+		header->strings_size;
+
+	if(expected_size != static_cast<quint64>(size)) {
+		return false;
+	}
+
+	if(static_cast<quint64>(header->library_name) + header->library_name_length > header->strings_size) {
+		return false;
+	}
+
+	auto entries = reinterpret_cast<const Entry *>(header + 1);
+	auto names   = reinterpret_cast<const quint32 *>(entries + header->count);
+
+	// the name index is used to find entries while searching, so it has to be sane
+	for(quint32 i = 0; i < header->count; ++i) {
+		if(names[i] >= header->count) {
+			return false;
+		}
+	}
+
+	header_  = header;
+	entries_ = entries;
+	names_   = names;
+	strings_ = reinterpret_cast<const char *>(names + header->count);
+	return true;
+}
+
+//------------------------------------------------------------------------------
+// Name: is_built_from
+// Desc: returns true if this was converted from the current version of the
+//       text symbol file <map_file>
+//------------------------------------------------------------------------------
+bool SymbolFile::is_built_from(const QFileInfo &map_file) const {
+	return header_->map_size == static_cast<quint64>(map_file.size()) &&
+		header_->map_modified == map_file.lastModified().toMSecsSinceEpoch();
+}
+
+//------------------------------------------------------------------------------
+// Name: is_verified
+// Desc: returns true if the md5 was checked against this version of <library>
+//------------------------------------------------------------------------------
+bool SymbolFile::is_verified(const QFileInfo &library) const {
+	return header_->library_modified != 0 &&
+		header_->library_size == static_cast<quint64>(library.size()) &&
+		header_->library_modified == library.lastModified().toMSecsSinceEpoch();
+}
+
+//------------------------------------------------------------------------------
+// Name: library_md5
+// Desc: the md5 of the library these symbols were generated from
+//------------------------------------------------------------------------------
+QByteArray SymbolFile::library_md5() const {
+	return QByteArray(header_->library_md5, sizeof(header_->library_md5));
+}
+
+//------------------------------------------------------------------------------
+// Name: library_name
+// Desc: the path of the library these symbols were generated from
+//------------------------------------------------------------------------------
+QString SymbolFile::library_name() const {
+	return QString::fromUtf8(string(header_->library_name, header_->library_name_length));
+}
+
+//------------------------------------------------------------------------------
+// Name: set_location
+// Desc: sets which file the symbols are reported as coming from and where the
+//       library is loaded
+//------------------------------------------------------------------------------
+void SymbolFile::set_location(const QString &file, edb::address_t base) {
+	file_   = file;
+	base_   = base;
+	prefix_ = QFileInfo(library_name()).fileName();
+	symbols_.clear();
+
+	start_ = 0;
+	end_   = 0;
+
+	for(quint32 i = 0; i < header_->count; ++i) {
+		const edb::address_t first = relocate(entries_[i].address);
+		const edb::address_t last  = first + std::max<quint32>(entries_[i].size, 1);
+
+		if(i == 0 || first < start_) {
+			start_ = first;
+		}
+
+		if(last > end_) {
+			end_ = last;
+		}
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: size
+// Desc: the number of symbols in the file
+//------------------------------------------------------------------------------
+int SymbolFile::size() const {
+	return header_->count;
+}
+
+//------------------------------------------------------------------------------
+// Name: string
+// Desc: returns the bytes of an entry in the string table, an empty array if
+//       it lies outside of the table
+//------------------------------------------------------------------------------
+QByteArray SymbolFile::string(quint32 offset, quint32 length) const {
+	if(static_cast<quint64>(offset) + length > header_->strings_size) {
+		return QByteArray();
+	}
+
+	return QByteArray::fromRawData(strings_ + offset, length);
+}
+
+//------------------------------------------------------------------------------
+// Name: relocate
+// Desc: addresses below the load address are relative to it
+//------------------------------------------------------------------------------
+edb::address_t SymbolFile::relocate(quint64 address) const {
+	const edb::address_t result = address;
+	return (result < base_) ? result + base_ : result;
+}
+
+//------------------------------------------------------------------------------
+// Name: address
+// Desc: the address of the symbol at <index> once relocated
+//------------------------------------------------------------------------------
+edb::address_t SymbolFile::address(int index) const {
+	Q_ASSERT(index >= 0 && index < size());
+	return relocate(entries_[index].address);
+}
+
+//------------------------------------------------------------------------------
+// Name: find_near
+// Desc: returns the index of the symbol with the highest address which is not
+//       above <address>, or -1 if there is none
+// Note: the entries are sorted by their unrelocated address. Those above the
+//       load address stay where they are and those below it move up by it, so
+//       each group is searched separately
+//------------------------------------------------------------------------------
+int SymbolFile::find_near(edb::address_t address) const {
+
+	const Entry *const first = entries_;
+	const Entry *const last  = entries_ + header_->count;
+
+	// the last entry at or before <key>
+	auto last_at_or_before = [first, last](quint64 key) -> const Entry * {
+		const Entry *it = std::upper_bound(first, last, key, [](quint64 value, const Entry &entry) {
+			return value < entry.address;
+		});
+		return (it == first) ? nullptr : it - 1;
+	};
+
+	const Entry *best = nullptr;
+
+	// an entry which isn't relocated
+	if(const Entry *it = last_at_or_before(address)) {
+		if(!(base_ > it->address)) {
+			best = it;
+		}
+	}
+
+	// an entry which is relocated
+	if(base_ != 0 && !(address < base_)) {
+		const quint64 key = std::min<quint64>(address - base_, base_ - 1);
+		if(const Entry *it = last_at_or_before(key)) {
+			if(!best || relocate(best->address) <= relocate(it->address)) {
+				best = it;
+			}
+		}
+	}
+
+	return best ? static_cast<int>(best - first) : -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: find
+// Desc: returns the index of the symbol at <address>, or -1 if there is none
+//------------------------------------------------------------------------------
+int SymbolFile::find(edb::address_t address) const {
+	const int index = find_near(address);
+	return (index != -1 && this->address(index) == address) ? index : -1;
+}
+
+//------------------------------------------------------------------------------
+// Name: find
+// Desc: returns the index of the symbol named <name>, without the library
+//       prefix, or -1 if there is none
+//------------------------------------------------------------------------------
+int SymbolFile::find(const QString &name) const {
+
+	const QByteArray key = name.toUtf8();
+
+	auto compare = [this](quint32 index, const QByteArray &value) {
+		const Entry &entry = entries_[index];
+		const QByteArray entry_name = string(entry.name, entry.name_length);
+		return compare_names(entry_name.constData(), entry_name.size(), value.constData(), value.size());
+	};
+
+	const quint32 *const first = names_;
+	const quint32 *const last  = names_ + header_->count;
+
+	// the last of the symbols with this name
+	const quint32 *it = std::upper_bound(first, last, key, [&compare](const QByteArray &value, quint32 index) {
+		return compare(index, value) > 0;
+	});
+
+	if(it == first || compare(*(it - 1), key) != 0) {
+		return -1;
+	}
+
+	return static_cast<int>(*(it - 1));
+}
+
+//------------------------------------------------------------------------------
+// Name: symbol
+// Desc: returns the symbol at <index>, it is created the first time it is
+//       asked for
+//------------------------------------------------------------------------------
+std::shared_ptr<Symbol> SymbolFile::symbol(int index) const {
+
+	Q_ASSERT(index >= 0 && index < size());
+
+	auto it = symbols_.find(index);
+	if(it != symbols_.end()) {
+		return it.value();
+	}
+
+	auto sym = std::make_shared<Symbol>();
+	fill(index, sym.get());
+
+	symbols_.insert(index, sym);
+	return sym;
+}
+
+//------------------------------------------------------------------------------
+// Name: fill
+// Desc: sets <sym> to the symbol at <index>
+//------------------------------------------------------------------------------
+void SymbolFile::fill(int index, Symbol *sym) const {
+
+	const Entry &entry = entries_[index];
+
+	sym->file           = file_;
+	sym->name_no_prefix = QString::fromUtf8(string(entry.name, entry.name_length));
+	sym->name           = prefix_ + QLatin1Char('!') + sym->name_no_prefix;
+	sym->address        = relocate(entry.address);
+	sym->size           = entry.size;
+	sym->type           = entry.type;
+}
+
+//------------------------------------------------------------------------------
+// Name: for_each
+// Desc: calls <f> with every symbol in the file. The symbols are built on the
+//       fly and are not kept, so this is suited to going over a whole table
+//------------------------------------------------------------------------------
+void SymbolFile::for_each(const std::function<void(const Symbol &)> &f) const {
+
+	Symbol sym;
+	for(int i = 0; i < size(); ++i) {
+		fill(i, &sym);
+		f(sym);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: for_each
+// Desc: calls <f> with every symbol whose relocated address is in
+//       [start, end), the same way as the other for_each
+// Note: like find_near, the entries which are relocated and the ones which
+//       aren't are searched separately
+//------------------------------------------------------------------------------
+void SymbolFile::for_each(edb::address_t start, edb::address_t end, const std::function<void(const Symbol &)> &f) const {
+
+	if(!(start < end)) {
+		return;
+	}
+
+	const Entry *const first = entries_;
+	const Entry *const last  = entries_ + header_->count;
+
+	auto lower = [first, last](quint64 key) {
+		return std::lower_bound(first, last, key, [](const Entry &entry, quint64 value) {
+			return entry.address < value;
+		});
+	};
+
+	Symbol sym;
+	auto visit = [&](quint64 from, quint64 to) {
+		for(const Entry *it = lower(from); it != last && it->address < to; ++it) {
+			fill(static_cast<int>(it - first), &sym);
+			f(sym);
+		}
+	};
+
+	// the entries which aren't relocated are the ones at or above the load address
+	visit(std::max<quint64>(start, base_), end);
+
+	// the ones below it end up at their address plus the load address
+	if(base_ != 0 && end > base_) {
+		const quint64 from = (start > base_) ? start - base_ : 0;
+		const quint64 to   = std::min<quint64>(end - base_, base_);
+		if(from < to) {
+			visit(from, to);
+		}
+	}
+}
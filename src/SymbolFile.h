@@ -0,0 +1,99 @@
+/*
+Copyright (C) 2006 - 2015 Evan Teran
+                          evan.teran@gmail.com
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifndef SYMBOL_FILE_20181105_H_
+#define SYMBOL_FILE_20181105_H_
+
+#include "Types.h"
+#include <QByteArray>
+#include <QFile>
+#include <QHash>
+#include <QString>
+#include <functional>
+#include <memory>
+
+class QFileInfo;
+class Symbol;
+
+// The binary form of a symbol file. It holds the symbols sorted by address,
+// an index of them sorted by name and a table of the names. The file is
+// mapped and used in place, Symbol objects are only created for the entries
+// which are actually asked for
+class SymbolFile {
+private:
+	struct Header;
+	struct Entry;
+
+public:
+	static std::shared_ptr<SymbolFile> open(const QString &filename);
+	static bool convert(const QString &map_file, const QString &filename);
+	static bool mark_verified(const QString &filename, const QFileInfo &library);
+
+private:
+	SymbolFile(const QString &filename);
+
+public:
+	SymbolFile(const SymbolFile &) = delete;
+	SymbolFile &operator=(const SymbolFile &) = delete;
+
+public:
+	bool is_built_from(const QFileInfo &map_file) const;
+	bool is_verified(const QFileInfo &library) const;
+	QByteArray library_md5() const;
+	QString library_name() const;
+
+public:
+	void set_location(const QString &file, edb::address_t base);
+	QString file() const { return file_; }
+	QString prefix() const { return prefix_; }
+	edb::address_t start() const { return start_; }
+	edb::address_t end() const { return end_; }
+
+public:
+	int size() const;
+	int find(edb::address_t address) const;
+	int find(const QString &name) const;
+	int find_near(edb::address_t address) const;
+	edb::address_t address(int index) const;
+	std::shared_ptr<Symbol> symbol(int index) const;
+
+public:
+	void for_each(const std::function<void(const Symbol &)> &f) const;
+	void for_each(edb::address_t start, edb::address_t end, const std::function<void(const Symbol &)> &f) const;
+
+private:
+	bool load();
+	void fill(int index, Symbol *sym) const;
+	QByteArray string(quint32 offset, quint32 length) const;
+	edb::address_t relocate(quint64 address) const;
+
+private:
+	QFile                                       map_;
+	const Header                               *header_  = nullptr;
+	const Entry                                *entries_ = nullptr;
+	const quint32                              *names_   = nullptr;
+	const char                                 *strings_ = nullptr;
+	QString                                     file_;
+	QString                                     prefix_;
+	edb::address_t                              base_    = 0;
+	edb::address_t                              start_   = 0; // the relocated symbols lie in [start_, end_)
+	edb::address_t                              end_     = 0;
+	mutable QHash<int, std::shared_ptr<Symbol>> symbols_;
+};
+
+#endif
@@ -20,6 +20,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Configuration.h"
 #include "ISymbolGenerator.h"
 #include "Symbol.h"
+#include "SymbolFile.h"
 #include "edb.h"
 
 #include <QDir>
@@ -28,10 +29,6 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QProcess>
 #include <QtDebug>
 
-#include <fstream>
-#include <iostream>
-#include <istream>
-
 //------------------------------------------------------------------------------
 // Name: SymbolManager
 // Desc:
@@ -46,6 +43,8 @@ SymbolManager::SymbolManager() : symbol_generator_(nullptr), show_path_notice_(t
 //------------------------------------------------------------------------------
 void SymbolManager::clear() {
 	symbol_files_.clear();
+	symbol_tables_.clear();
+	symbol_tables_by_start_.clear();
 	symbols_.clear();
 	symbols_by_address_.clear();
 	symbols_by_file_.clear();
@@ -88,9 +87,10 @@ void SymbolManager::load_symbol_file(const QString &filename, edb::address_t bas
 		QDir().mkpath(path);
 
 		if(!symbol_files_.contains(info.absoluteFilePath())) {
-			const QString map_file = QString("%1/%2.map").arg(path, name);
+			const QString map_file   = QString("%1/%2.map").arg(path, name);
+			const QString cache_file = QString("%1/%2.sym").arg(path, name);
 
-			if(process_symbol_file(map_file, base, filename, true)) {
+			if(process_symbol_file(map_file, cache_file, base, filename, true)) {
 				symbol_files_.insert(info.absoluteFilePath());
 			}
 		}
@@ -108,15 +108,32 @@ const std::shared_ptr<Symbol> SymbolManager::find(const QString &name) const {
 		return it.value();
 	}
 
+	// names are "library!symbol", so look for the symbol in the file of the
+	// library it names, the most recently loaded one wins
+	for(auto table = symbol_tables_.rbegin(); table != symbol_tables_.rend(); ++table) {
+		const QString prefix = (*table)->prefix() + QLatin1Char('!');
+		if(name.startsWith(prefix)) {
+			const int index = (*table)->find(name.mid(prefix.size()));
+			if(index != -1) {
+				return (*table)->symbol(index);
+			}
+		}
+	}
+
 	// slow path... look for any symbol which matches the name, but skipping the prefix
-	// we can make this faster later at the cost of yet another hash table if we
-	// feel the need
 	for(auto &&symbol : symbols_) {
 		if(symbol->name_no_prefix == name) {
 			return symbol;
 		}
 	}
 
+	for(const std::shared_ptr<SymbolFile> &table : symbol_tables_) {
+		const int index = table->find(name);
+		if(index != -1) {
+			return table->symbol(index);
+		}
+	}
+
 	return nullptr;
 }
 
@@ -126,7 +143,38 @@ const std::shared_ptr<Symbol> SymbolManager::find(const QString &name) const {
 //------------------------------------------------------------------------------
 const std::shared_ptr<Symbol> SymbolManager::find(edb::address_t address) const {
 	auto it = symbols_by_address_.find(address);
-	return (it != symbols_by_address_.end()) ? it.value() : nullptr;
+	if(it != symbols_by_address_.end()) {
+		return it.value();
+	}
+
+	if(const std::shared_ptr<SymbolFile> table = table_at(address)) {
+		const int index = table->find(address);
+		if(index != -1) {
+			return table->symbol(index);
+		}
+	}
+
+	return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// Name: table_at
+// Desc: returns the symbol table whose symbols cover <address>, or nullptr if
+//       there is none
+//------------------------------------------------------------------------------
+std::shared_ptr<SymbolFile> SymbolManager::table_at(edb::address_t address) const {
+
+	auto it = symbol_tables_by_start_.upperBound(address);
+	if(it == symbol_tables_by_start_.begin()) {
+		return nullptr;
+	}
+
+	--it;
+	if(address < it.value()->end()) {
+		return it.value();
+	}
+
+	return nullptr;
 }
 
 //------------------------------------------------------------------------------
@@ -135,22 +183,26 @@ const std::shared_ptr<Symbol> SymbolManager::find(edb::address_t address) const
 //------------------------------------------------------------------------------
 const std::shared_ptr<Symbol> SymbolManager::find_near_symbol(edb::address_t address) const {
 
+	// the closest symbol at or before the address, wherever it came from
+	std::shared_ptr<Symbol> sym;
+
 	auto it = symbols_by_address_.lowerBound(address);
-	if(it != symbols_by_address_.end()) {
+	if(it != symbols_by_address_.end() && address == it.value()->address) {
+		sym = it.value();
+	} else if(it != symbols_by_address_.begin()) {
+		sym = (--it).value();
+	}
 
-		// not an exact match, we should backup one
-		if(address != it.value()->address) {
-			// not safe to backup!, return early
-			if(it == symbols_by_address_.begin()) {
-				return nullptr;
-			}
-			--it;
+	if(const std::shared_ptr<SymbolFile> table = table_at(address)) {
+		const int index = table->find_near(address);
+		if(index != -1 && (!sym || sym->address <= table->address(index))) {
+			sym = table->symbol(index);
 		}
+	}
 
-		if(const std::shared_ptr<Symbol> sym = it.value()) {
-			if(address >= sym->address && address < sym->address + sym->size) {
-				return sym;
-			}
+	if(sym) {
+		if(address >= sym->address && address < sym->address + sym->size) {
+			return sym;
 		}
 	}
 
@@ -171,85 +223,72 @@ void SymbolManager::add_symbol(const std::shared_ptr<Symbol> &symbol) {
 
 //------------------------------------------------------------------------------
 // Name: process_symbol_file
-// Desc:
+// Desc: loads the symbols for <library_filename>. The text symbol file <f> is
+//       converted to the binary <cache_file> the first time it is seen, after
+//       that the binary one is mapped directly
 // Note: returning false means 'try again', true means, 'we loaded what we could'
 //------------------------------------------------------------------------------
-bool SymbolManager::process_symbol_file(const QString &f, edb::address_t base, const QString &library_filename, bool allow_retry) {
+bool SymbolManager::process_symbol_file(const QString &f, const QString &cache_file, edb::address_t base, const QString &library_filename, bool allow_retry) {
 
 	// TODO(eteran): support filename starting with "http://" being fetched from a web server
 
 	QFile symbolFile(f);
-	if(symbolFile.size() == 0) {
+	if(symbolFile.exists() && symbolFile.size() == 0) {
 		symbolFile.remove();
 	}
 
-	std::ifstream file(qPrintable(f));
-	if(file) {
-		edb::v1::set_status(QObject::tr("Loading symbols: %1").arg(f),0);
-		edb::address_t sym_start;
-		edb::address_t sym_end;
-		std::string    sym_name;
-		std::string    date;
-		std::string    md5;
-		std::string    filename;
-
-		if(std::getline(file, date)) {
-			if(file >> md5 >> filename) {
-
-				const QByteArray file_md5   = QByteArray::fromHex(md5.c_str());
-				const QByteArray actual_md5 = edb::v1::get_file_md5(library_filename);
-
-				if(file_md5 != actual_md5) {
-					qDebug() << "Your symbol file for" << library_filename << "appears to not match the actual file, perhaps you should rebuild your symbols?";
-					const Configuration &config = edb::v1::config();
-					if(config.remove_stale_symbols) {
-						symbolFile.remove();
+	const QFileInfo map_info(f);
+	const QFileInfo library_info(library_filename);
 
-						if(allow_retry) {
-							return process_symbol_file(f, base, library_filename, false);
-						}
+	std::shared_ptr<SymbolFile> table = SymbolFile::open(cache_file);
 
-					}
-					edb::v1::clear_status();
-					return false;
-				}
-
-				const QFileInfo info(QString::fromStdString(filename));
-				const QString prefix = info.fileName();
-				char sym_type;
-
-				while(true) {
-					file >> std::hex >> sym_start >> std::hex >> sym_end >> sym_type;
-					// For symbol name we can't use operator>>() as it may have spaces if demangled
-					// Thus, get the rest of the line as the symbol name
-					std::getline(file,sym_name);
-
-					if(!file) {
-						if(!file.eof()) qWarning() << "WARNING: File" << f << "seems corrupt";
-						break;
-					}
-
-					auto sym = std::make_shared<Symbol>();
+	// the binary file is rebuilt whenever the text file it came from changes
+	if(table && map_info.exists() && !table->is_built_from(map_info)) {
+		table = nullptr;
+	}
 
-					sym->file           = f;
-					sym->name_no_prefix = QString::fromStdString(sym_name).trimmed();
-					sym->name           = QString("%1!%2").arg(prefix, sym->name_no_prefix);
-					sym->address        = sym_start;
-					sym->size           = sym_end;
-					sym->type           = sym_type;
+	if(!table && map_info.exists()) {
+		edb::v1::set_status(QObject::tr("Loading symbols: %1").arg(f),0);
+		if(SymbolFile::convert(f, cache_file)) {
+			table = SymbolFile::open(cache_file);
+		}
+	}
 
-					// fixup the base address based on where it is loaded
-					if(sym->address < base) {
-						sym->address += base;
+	if(table) {
+		// hashing the library is expensive, so it is only done when the library
+		// changed since the last time it was found to match
+		if(!table->is_verified(library_info)) {
+			const QByteArray actual_md5 = edb::v1::get_file_md5(library_filename);
+
+			if(table->library_md5() != actual_md5) {
+				qDebug() << "Your symbol file for" << library_filename << "appears to not match the actual file, perhaps you should rebuild your symbols?";
+				const Configuration &config = edb::v1::config();
+				if(config.remove_stale_symbols) {
+					table = nullptr;
+					QFile::remove(cache_file);
+					symbolFile.remove();
+
+					if(allow_retry) {
+						return process_symbol_file(f, cache_file, base, library_filename, false);
 					}
 
-					add_symbol(sym);
 				}
 				edb::v1::clear_status();
-				return true;
+				return false;
 			}
+
+			SymbolFile::mark_verified(cache_file, library_info);
 		}
-	} else if(symbol_generator_) {
+
+		table->set_location(f, base);
+		symbol_tables_.push_back(table);
+		if(table->size() != 0) {
+			symbol_tables_by_start_[table->start()] = table;
+		}
+
+		edb::v1::clear_status();
+		return true;
+	} else if(!map_info.exists() && symbol_generator_) {
 		edb::v1::set_status(QObject::tr("Auto-Generating Symbol File: %1").arg(f),0);
 		bool generatedOK=symbol_generator_->generate_symbol_file(library_filename, f);
 		edb::v1::clear_status();
@@ -266,7 +305,53 @@ bool SymbolManager::process_symbol_file(const QString &f, edb::address_t base, c
 // Desc:
 //------------------------------------------------------------------------------
 const QList<std::shared_ptr<Symbol>> SymbolManager::symbols() const {
-	return symbols_;
+
+	// these are copies, so that listing every symbol doesn't make the tables
+	// keep every one of them
+	QList<std::shared_ptr<Symbol>> symbols;
+	for(const std::shared_ptr<SymbolFile> &table : symbol_tables_) {
+		table->for_each([&symbols](const Symbol &sym) {
+			symbols.push_back(std::make_shared<Symbol>(sym));
+		});
+	}
+
+	return symbols + symbols_;
+}
+
+//------------------------------------------------------------------------------
+// Name: for_each_symbol
+// Desc:
+//------------------------------------------------------------------------------
+void SymbolManager::for_each_symbol(const std::function<void(const Symbol &)> &f) const {
+
+	for(const std::shared_ptr<SymbolFile> &table : symbol_tables_) {
+		table->for_each(f);
+	}
+
+	for(const std::shared_ptr<Symbol> &sym : symbols_) {
+		f(*sym);
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: for_each_symbol
+// Desc: only the tables which overlap [start, end) are looked at
+//------------------------------------------------------------------------------
+void SymbolManager::for_each_symbol(edb::address_t start, edb::address_t end, const std::function<void(const Symbol &)> &f) const {
+
+	for(const std::shared_ptr<SymbolFile> &table : symbol_tables_by_start_) {
+		if(!(table->start() < end)) {
+			break;
+		}
+
+		if(start < table->end()) {
+			table->for_each(start, end, f);
+		}
+	}
+
+	for(auto it = symbols_by_address_.lowerBound(start); it != symbols_by_address_.end() && it.key() < end; ++it) {
+		f(*it.value());
+	}
 }
 
 //------------------------------------------------------------------------------
@@ -334,5 +419,11 @@ QHash<edb::address_t, QString> SymbolManager::labels() const {
 // Desc:
 //------------------------------------------------------------------------------
 QList<QString> SymbolManager::files() const {
-	return symbols_by_file_.keys();
+	QList<QString> files = symbols_by_file_.keys();
+	for(const std::shared_ptr<SymbolFile> &table : symbol_tables_) {
+		if(!files.contains(table->file())) {
+			files.push_back(table->file());
+		}
+	}
+	return files;
 }
@@ -26,6 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QSet>
 
 class QString;
+class SymbolFile;
 
 class SymbolManager : public ISymbolManager {
 public:
@@ -33,6 +34,8 @@ public:
 
 public:
 	const QList<std::shared_ptr<Symbol>> symbols() const override;
+	void for_each_symbol(const std::function<void(const Symbol &)> &f) const override;
+	void for_each_symbol(edb::address_t start, edb::address_t end, const std::function<void(const Symbol &)> &f) const override;
 	const std::shared_ptr<Symbol> find(const QString &name) const override;
 	const std::shared_ptr<Symbol> find(edb::address_t address) const override;
 	const std::shared_ptr<Symbol> find_near_symbol(edb::address_t address) const override;
@@ -46,10 +49,13 @@ public:
 	QList<QString> files() const override;
 
 private:
-	bool process_symbol_file(const QString &f, edb::address_t base, const QString &library_filename, bool allow_retry);
+	bool process_symbol_file(const QString &f, const QString &cache_file, edb::address_t base, const QString &library_filename, bool allow_retry);
+	std::shared_ptr<SymbolFile> table_at(edb::address_t address) const;
 
 private:
 	QSet<QString>                          symbol_files_;
+	QList<std::shared_ptr<SymbolFile>>             symbol_tables_;
+	QMap<edb::address_t, std::shared_ptr<SymbolFile>> symbol_tables_by_start_; // loaded libraries don't overlap
 	QList<std::shared_ptr<Symbol>>                 symbols_;
 	QMap<edb::address_t, std::shared_ptr<Symbol>>  symbols_by_address_;
 	QHash<QString, QList<std::shared_ptr<Symbol>>> symbols_by_file_;
@@ -23,9 +23,11 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <vector>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <cctype>
 #include <cstring>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 
@@ -35,10 +37,186 @@ namespace {
 
 constexpr int MAX_OPERANDS       = 3;
 
-Architecture capstoneArch        = Architecture::ARCH_X86;
-bool         capstoneInitialized = false;
-csh          csh                 = 0;
-Formatter    activeFormatter;
+std::atomic<Architecture> capstoneArch(Architecture::ARCH_X86);
+std::atomic<bool>         capstoneInitialized(false);
+Formatter                 activeFormatter;
+
+// capstone handles must not be used by more than one thread at a time, so
+// every thread opens its own with these settings. Changing them bumps the
+// generation, which makes each thread reopen its handles on next use
+std::mutex                settingsMutex;
+Architecture              settingsArch   = Architecture::ARCH_X86;
+cs_opt_value              settingsSyntax = CS_OPT_SYNTAX_DEFAULT;
+std::atomic<unsigned int> settingsGeneration(1);
+
+struct ThreadContext {
+	~ThreadContext() {
+		close();
+	}
+
+	void close() {
+		if (generation) {
+			cs_close(&detail);
+			cs_close(&flow);
+			generation = 0;
+		}
+	}
+
+	csh          detail     = 0; // with instruction details
+	csh          flow       = 0; // without details, for decode_length
+	unsigned int generation = 0; // 0 if the handles aren't open
+};
+
+cs_err open_handle(Architecture arch, csh *handle) {
+	switch (arch) {
+	case Architecture::ARCH_AMD64:
+		return cs_open(CS_ARCH_X86, CS_MODE_64, handle);
+	case Architecture::ARCH_X86:
+		return cs_open(CS_ARCH_X86, CS_MODE_32, handle);
+	case Architecture::ARCH_ARM32_ARM:
+		return cs_open(CS_ARCH_ARM, CS_MODE_ARM, handle);
+	case Architecture::ARCH_ARM32_THUMB:
+		return cs_open(CS_ARCH_ARM, CS_MODE_THUMB, handle);
+	case Architecture::ARCH_ARM64:
+		return cs_open(CS_ARCH_ARM64, CS_MODE_ARM, handle);
+	default:
+		return CS_ERR_ARCH;
+	}
+}
+
+//------------------------------------------------------------------------------
+// Name: context
+// Desc: returns the handles of the calling thread, (re)opening them if the
+//       settings changed since they were opened
+//------------------------------------------------------------------------------
+ThreadContext &context() {
+	thread_local ThreadContext ctx;
+
+	const unsigned int generation = settingsGeneration.load(std::memory_order_acquire);
+	if (ctx.generation != generation) {
+		ctx.close();
+
+		Architecture arch;
+		cs_opt_value syntax;
+		{
+			std::lock_guard<std::mutex> lock(settingsMutex);
+			arch   = settingsArch;
+			syntax = settingsSyntax;
+		}
+
+		if (open_handle(arch, &ctx.detail) == CS_ERR_OK) {
+			if (open_handle(arch, &ctx.flow) == CS_ERR_OK) {
+				cs_option(ctx.detail, CS_OPT_DETAIL, CS_OPT_ON);
+				if (syntax != CS_OPT_SYNTAX_DEFAULT) {
+					cs_option(ctx.detail, CS_OPT_SYNTAX, syntax);
+				}
+				ctx.generation = generation;
+			} else {
+				cs_close(&ctx.detail);
+			}
+		}
+	}
+
+	return ctx;
+}
+
+csh detail_handle() {
+	return context().detail;
+}
+
+csh flow_handle() {
+	return context().flow;
+}
+
+//------------------------------------------------------------------------------
+// Name: fixup_instruction
+// Desc: corrects known capstone errors in a freshly decoded instruction
+//------------------------------------------------------------------------------
+void fixup_instruction(cs_insn *insn) {
+#if defined EDB_ARM32
+	if(insn->detail->arm.op_count>=2)
+	{
+		// XXX: this is a work around capstone bug #1013
+		auto& op=insn->detail->arm.operands[1];
+		if(op.type==ARM_OP_MEM && op.subtracted && op.mem.scale==1)
+			op.mem.scale=-1;
+	}
+#else
+	Q_UNUSED(insn);
+#endif
+}
+
+//------------------------------------------------------------------------------
+// Name: flow_class
+// Desc: classifies an instruction by its id alone, so it works without details
+//------------------------------------------------------------------------------
+FlowClass flow_class(unsigned int id) {
+	switch (id) {
+#if defined EDB_X86 || defined EDB_X86_64
+	case X86_INS_CALL:
+	case X86_INS_LCALL:
+		return FlowClass::Call;
+	case X86_INS_JMP:
+	case X86_INS_LJMP:
+		return FlowClass::Jump;
+	case X86_INS_JAE:
+	case X86_INS_JA:
+	case X86_INS_JBE:
+	case X86_INS_JB:
+	case X86_INS_JCXZ:
+	case X86_INS_JECXZ:
+	case X86_INS_JE:
+	case X86_INS_JGE:
+	case X86_INS_JG:
+	case X86_INS_JLE:
+	case X86_INS_JL:
+	case X86_INS_JNE:
+	case X86_INS_JNO:
+	case X86_INS_JNP:
+	case X86_INS_JNS:
+	case X86_INS_JO:
+	case X86_INS_JP:
+	case X86_INS_JRCXZ:
+	case X86_INS_JS:
+	case X86_INS_LOOP:
+	case X86_INS_LOOPE:
+	case X86_INS_LOOPNE:
+		return FlowClass::ConditionalJump;
+	case X86_INS_RET:
+	case X86_INS_RETF:
+	case X86_INS_IRET:
+	case X86_INS_IRETD:
+	case X86_INS_IRETQ:
+		return FlowClass::Return;
+	case X86_INS_INT:
+	case X86_INS_INT1:
+	case X86_INS_INT3:
+	case X86_INS_INTO:
+	case X86_INS_SYSCALL:
+	case X86_INS_SYSENTER:
+		return FlowClass::Interrupt;
+	case X86_INS_HLT:
+		return FlowClass::Halt;
+#elif defined EDB_ARM32
+	// NOTE: without details, instructions which branch by writing to PC
+	//       (pop {pc}, ldr pc, ...) and the condition codes can't be seen
+	case ARM_INS_BL:
+	case ARM_INS_BLX:
+		return FlowClass::Call;
+	case ARM_INS_B:
+	case ARM_INS_BX:
+		return FlowClass::Jump;
+	case ARM_INS_CBZ:
+	case ARM_INS_CBNZ:
+		return FlowClass::ConditionalJump;
+	case ARM_INS_SVC:
+	case ARM_INS_BKPT:
+		return FlowClass::Interrupt;
+#endif
+	default:
+		return FlowClass::Sequential;
+	}
+}
 
 bool is_simd_register(const Operand &operand) {
 
@@ -112,62 +290,82 @@ bool isX86_64() {
 
 bool init(Architecture arch) {
 
-	capstoneArch = arch;
+	capstoneInitialized = false;
+	capstoneArch        = arch;
 
-	if (capstoneInitialized) {
-		cs_close(&csh);
+	{
+		std::lock_guard<std::mutex> lock(settingsMutex);
+		settingsArch = arch;
 	}
 
-	capstoneInitialized = false;
-
-	const cs_err result = [arch]() {
-		switch (arch) {
-		case Architecture::ARCH_AMD64:
-			return cs_open(CS_ARCH_X86, CS_MODE_64, &csh);
-		case Architecture::ARCH_X86:
-			return cs_open(CS_ARCH_X86, CS_MODE_32, &csh);
-		case Architecture::ARCH_ARM32_ARM:
-			return cs_open(CS_ARCH_ARM, CS_MODE_ARM, &csh);
-		case Architecture::ARCH_ARM32_THUMB:
-			return cs_open(CS_ARCH_ARM, CS_MODE_THUMB, &csh);
-		case Architecture::ARCH_ARM64:
-			return cs_open(CS_ARCH_ARM64, CS_MODE_ARM, &csh);
-		default:
-			return CS_ERR_ARCH;
-		}
-	}();
+	++settingsGeneration;
 
-	if (result != CS_ERR_OK) {
+	// open the handles of this thread right away, so that errors show up here
+	if (!context().generation) {
 		return false;
 	}
 
 	capstoneInitialized = true;
 
-	cs_option(csh, CS_OPT_DETAIL, CS_OPT_ON);
-
 	// Set selected formatting options on reinit
 	activeFormatter.setOptions(activeFormatter.options());
 	return true;
 }
 
-Instruction::Instruction(Instruction &&other) : insn_(other.insn_), byte0_(other.byte0_), rva_(other.rva_) {
+InstructionBuffer::~InstructionBuffer() {
+	if (insn_) {
+		cs_free(insn_, 1);
+	}
+}
+
+cs_insn *InstructionBuffer::storage() {
+	assert(capstoneInitialized);
+	if (!insn_) {
+		insn_ = cs_malloc(detail_handle());
+	}
+	return insn_;
+}
+
+std::size_t decode_length(InstructionBuffer &buffer, const void *first, const void *last, uint64_t rva, FlowClass *flow) {
+	assert(capstoneInitialized);
+	auto code = static_cast<const uint8_t *>(first);
+	auto size = static_cast<size_t>(static_cast<const uint8_t *>(last) - code);
+
+	cs_insn *const insn = buffer.storage();
+	if (first < last && insn && cs_disasm_iter(flow_handle(), &code, &size, &rva, insn)) {
+		if (flow) {
+			*flow = flow_class(insn->id);
+		}
+		return insn->size;
+	}
+
+	if (flow) {
+		*flow = FlowClass::Invalid;
+	}
+	return 0;
+}
+
+Instruction::Instruction(Instruction &&other) : insn_(other.insn_), byte0_(other.byte0_), rva_(other.rva_), owned_(other.owned_) {
 	other.insn_  = nullptr;
 	other.byte0_ = 0;
 	other.rva_   = 0;
+	other.owned_ = true;
 }
 
 Instruction &Instruction::operator=(Instruction &&rhs) {
 	insn_      = rhs.insn_;
 	byte0_     = rhs.byte0_;
 	rva_       = rhs.rva_;
+	owned_     = rhs.owned_;
 	rhs.insn_  = nullptr;
 	rhs.byte0_ = 0;
 	rhs.rva_   = 0;
+	rhs.owned_ = true;
 	return *this;
 }
 
 Instruction::~Instruction() {
-	if (insn_) {
+	if (insn_ && owned_) {
 		cs_free(insn_, 1);
 	}
 }
@@ -180,22 +378,32 @@ Instruction::Instruction(const void *first, const void *last, uint64_t rva) noex
 	byte0_ = codeBegin[0];
 
 	cs_insn *insn = nullptr;
-	if (first < last && cs_disasm(csh, codeBegin, codeEnd - codeBegin, rva, 1, &insn)) {
+	if (first < last && cs_disasm(detail_handle(), codeBegin, codeEnd - codeBegin, rva, 1, &insn)) {
 		insn_ = insn;
-#if defined EDB_ARM32
-		if(insn_->detail->arm.op_count>=2)
-		{
-			// XXX: this is a work around capstone bug #1013
-			auto& op=insn_->detail->arm.operands[1];
-			if(op.type==ARM_OP_MEM && op.subtracted && op.mem.scale==1)
-				op.mem.scale=-1;
-		}
-#endif
+		fixup_instruction(insn_);
 	} else {
 		insn_ = nullptr;
 	}
 }
 
+Instruction::Instruction(InstructionBuffer &buffer, const void *first, const void *last, uint64_t rva) noexcept : insn_(nullptr), rva_(rva), owned_(false) {
+	assert(capstoneInitialized);
+	auto codeBegin = static_cast<const uint8_t *>(first);
+	auto codeEnd   = static_cast<const uint8_t *>(last);
+
+	byte0_ = codeBegin[0];
+
+	const uint8_t *code    = codeBegin;
+	size_t         size    = codeEnd - codeBegin;
+	uint64_t       address = rva;
+
+	cs_insn *const insn = buffer.storage();
+	if (first < last && insn && cs_disasm_iter(detail_handle(), &code, &size, &address, insn)) {
+		insn_ = insn;
+		fixup_instruction(insn_);
+	}
+}
+
 Operand Instruction::operator[](size_t n) const {
 	if (!valid())
 		return Operand();
@@ -325,16 +533,25 @@ void Formatter::setOptions(const Formatter::FormatOptions &options) {
 
 	options_ = options;
 
+	cs_opt_value syntax = CS_OPT_SYNTAX_DEFAULT;
 #if defined EDB_X86 || defined EDB_X86_64
 	if (options.syntax == SyntaxATT)
-		cs_option(csh, CS_OPT_SYNTAX, CS_OPT_SYNTAX_ATT);
+		syntax = CS_OPT_SYNTAX_ATT;
 	else
-		cs_option(csh, CS_OPT_SYNTAX, CS_OPT_SYNTAX_INTEL);
+		syntax = CS_OPT_SYNTAX_INTEL;
 #elif defined EDB_ARM32 // FIXME(ARM): does this apply to AArch64?
 	// TODO: make this optional. Don't forget to reflect this in register view!
-	cs_option(csh, CS_OPT_SYNTAX, CS_OPT_SYNTAX_NOREGNAME);
+	syntax = CS_OPT_SYNTAX_NOREGNAME;
 #endif
 
+	{
+		std::lock_guard<std::mutex> lock(settingsMutex);
+		settingsSyntax = syntax;
+	}
+
+	// every thread picks up the new syntax the next time it decodes
+	++settingsGeneration;
+
 	activeFormatter = *this;
 }
 
@@ -464,7 +681,7 @@ std::string Formatter::to_string(const Operand &operand) const {
 
 std::string Formatter::register_name(int reg) const {
 	assert(capstoneInitialized);
-	const char *raw = cs_reg_name(csh, reg);
+	const char *raw = cs_reg_name(detail_handle(), reg);
 	if (!raw)
 		return "(invalid register)";
 	std::string str(raw);
@@ -1070,17 +1287,17 @@ bool is_SIMD_USI(const Operand &operand) {
 
 bool is_return(const Instruction &insn) {
 	if(!insn) return false;
-	return cs_insn_group(csh, insn.native(), CS_GRP_RET);
+	return cs_insn_group(detail_handle(), insn.native(), CS_GRP_RET);
 }
 
 bool is_jump(const Instruction &insn) {
 	if(!insn) return false;
-	return cs_insn_group(csh, insn.native(), CS_GRP_JUMP);
+	return cs_insn_group(detail_handle(), insn.native(), CS_GRP_JUMP);
 }
 
 bool is_call(const Instruction &insn) {
 	if(!insn) return false;
-	return cs_insn_group(csh, insn.native(), CS_GRP_CALL);
+	return cs_insn_group(detail_handle(), insn.native(), CS_GRP_CALL);
 }
 
 bool modifies_pc(const Instruction &insn) {
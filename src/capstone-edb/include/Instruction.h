@@ -39,8 +39,47 @@ enum class Architecture {
 bool init(Architecture arch);
 
 class Instruction;
+class InstructionBuffer;
 class Formatter;
 
+// The effect an instruction has on control flow, which is all that scanners
+// looking for instruction boundaries and branches need to know
+enum class FlowClass : uint8_t {
+	Invalid,         // the bytes don't decode to an instruction
+	Sequential,      // execution continues with the next instruction
+	Call,
+	Jump,
+	ConditionalJump,
+	Return,
+	Interrupt,
+	Halt
+};
+
+// Decodes only the length and flow class of the instruction at <first>, which
+// is much cheaper than a full Instruction since no operand details are filled
+// in. Returns 0 if there is no valid instruction
+std::size_t decode_length(InstructionBuffer &buffer, const void *first, const void *end, uint64_t rva, FlowClass *flow = nullptr);
+
+// Storage for decoding many instructions one after another without allocating
+// for each of them. An Instruction decoded into a buffer borrows its storage,
+// so it is only valid until the buffer is used again or destroyed
+class InstructionBuffer {
+	friend class Instruction;
+	friend std::size_t decode_length(InstructionBuffer &buffer, const void *first, const void *end, uint64_t rva, FlowClass *flow);
+
+public:
+	InstructionBuffer() = default;
+	InstructionBuffer(const InstructionBuffer &)            = delete;
+	InstructionBuffer &operator=(const InstructionBuffer &) = delete;
+	~InstructionBuffer();
+
+private:
+	cs_insn *storage();
+
+private:
+	cs_insn *insn_ = nullptr;
+};
+
 class Instruction {
 	friend class Formatter;
 	friend class Operand;
@@ -54,6 +93,7 @@ public:
 
 public:
 	Instruction(const void *first, const void *end, uint64_t rva) noexcept;
+	Instruction(InstructionBuffer &buffer, const void *first, const void *end, uint64_t rva) noexcept;
 	Instruction(const Instruction &)            = delete;
 	Instruction &operator=(const Instruction &) = delete;
 	Instruction(Instruction &&);
@@ -167,6 +207,9 @@ private:
 	// even during a failed disassembly
 	uint8_t  byte0_ = 0;
 	uint64_t rva_   = 0;
+
+	// false if insn_ belongs to an InstructionBuffer
+	bool     owned_ = true;
 };
 
 }
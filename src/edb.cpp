@@ -36,6 +36,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "Prototype.h"
 #include "QHexView"
 #include "State.h"
+#include "StringSearch.h"
 #include "Symbol.h"
 #include "SymbolManager.h"
 #include "version.h"
@@ -50,9 +51,12 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <QFileInfo>
 #include <QMessageBox>
 #include <QCryptographicHash>
+#include <QVarLengthArray>
 
 #include <QDebug>
-#include <cctype>
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 IDebugger *edb::v1::debugger_core = nullptr;
 QWidget   *edb::v1::debugger_ui   = nullptr;
@@ -88,6 +92,105 @@ namespace {
 		*offset = 0;
 		return false;
 	}
+
+	// regions are scanned for pointers this much at a time
+	const std::size_t POINTER_SCAN_CHUNK_SIZE = 0x100000;
+
+	// targets this close to each other in the same region are fetched with a
+	// single read, as long as the read doesn't grow beyond the limit
+	const std::size_t TARGET_MERGE_GAP = 0x100;
+	const std::size_t TARGET_SPAN_MAX  = 0x10000;
+
+	//------------------------------------------------------------------------------
+	// Name: collect_pointers
+	// Desc: reads <region> in bulk and returns the pointer aligned slots which
+	//       hold a value in [first, last). <progress> (if set) is called after
+	//       each chunk
+	//------------------------------------------------------------------------------
+	QVector<edb::v1::PointerRef> collect_pointers(IProcess *process, const std::shared_ptr<IRegion> &region, edb::address_t first, edb::address_t last, const std::function<void(int)> &progress) {
+
+		QVector<edb::v1::PointerRef> pointers;
+
+		const std::size_t pointer_size = edb::v1::pointer_size();
+		QVector<quint8> image(POINTER_SCAN_CHUNK_SIZE);
+
+		for(edb::address_t address = region->start(); address < region->end(); address += POINTER_SCAN_CHUNK_SIZE) {
+
+			const std::size_t size = std::min<std::size_t>(POINTER_SCAN_CHUNK_SIZE, region->end() - address);
+			const std::size_t read = process->read_bytes(address, image.data(), size);
+
+			for(std::size_t offset = 0; offset + pointer_size <= read; offset += pointer_size) {
+				quint64 value = 0;
+				std::memcpy(&value, &image[offset], pointer_size);
+
+				if(first <= value && last > value) {
+					pointers.push_back({ address + offset, value });
+				}
+			}
+
+			if(progress) {
+				const quint64 done = (address - region->start()) + size;
+				progress(static_cast<int>(done * 100 / region->size()));
+			}
+		}
+
+		return pointers;
+	}
+
+	//------------------------------------------------------------------------------
+	// Name: append_string_chars
+	// Desc: appends the characters at <p> to <s> for as long as they are string
+	//       characters, up to <count> of them. Returns how many were appended
+	//------------------------------------------------------------------------------
+	int append_string_chars(const quint8 *p, int count, bool utf16, QString *s) {
+
+		const std::size_t char_size = utf16 ? 2 : 1;
+
+		const int n = edb::StringSearch::string_length(p, count * char_size, count, utf16);
+		*s += edb::StringSearch::string_text(p, n, utf16);
+		return n;
+	}
+
+	//------------------------------------------------------------------------------
+	// Name: page_remaining
+	// Desc: how many bytes there are from <address> to the end of its page
+	//------------------------------------------------------------------------------
+	std::size_t page_remaining(edb::address_t address) {
+		const quint64 page_size = edb::v1::debugger_core->page_size();
+		return page_size - (static_cast<quint64>(address) & (page_size - 1));
+	}
+
+	//------------------------------------------------------------------------------
+	// Name: read_string
+	// Desc: appends the string at <address> to <s>, at most <max_length>
+	//       characters of it
+	// Note: memory is read up to the end of a page at a time, and only as far
+	//       as the string goes. So a short string costs one read, and one that
+	//       ends right before an unmapped page can still be read in full
+	//------------------------------------------------------------------------------
+	void read_string(IProcess *process, edb::address_t address, int max_length, bool utf16, QString *s) {
+
+		const std::size_t char_size = utf16 ? 2 : 1;
+
+		QVarLengthArray<quint8, 512> buffer(max_length * char_size);
+		std::size_t size = 0;
+		int length       = 0;
+
+		while(length < max_length) {
+			const edb::address_t next = address + size;
+			const std::size_t wanted  = std::min<std::size_t>(buffer.size() - size, page_remaining(next));
+			const std::size_t read    = process->read_bytes(next, buffer.data() + size, wanted);
+			size += read;
+
+			const int available = static_cast<int>(size / char_size) - length;
+			const int appended  = append_string_chars(buffer.data() + length * char_size, available, utf16, s);
+			length += appended;
+
+			if(appended != available || read != wanted) {
+				break;
+			}
+		}
+	}
 }
 
 namespace edb {
@@ -645,30 +748,14 @@ bool get_ascii_string_at_address(address_t address, QString &s, int min_length,
 			s.clear();
 
 			if(min_length <= max_length) {
-				while(max_length--) {
-					char ch;
-					if(!process->read_bytes(address++, &ch, sizeof(ch))) {
-						break;
-					}
-
-					const int ascii_char = static_cast<unsigned char>(ch);
-					if(ascii_char < 0x80 && (std::isprint(ascii_char) || std::isspace(ascii_char))) {
-						s += ch;
-					} else {
-						break;
-					}
-				}
+				read_string(process, address, max_length, false, &s);
 			}
 
 			is_string = s.length() >= min_length;
 
 			if(is_string) {
 				found_length = s.length();
-				s.replace("\r", "\\r");
-				s.replace("\n", "\\n");
-				s.replace("\t", "\\t");
-				s.replace("\v", "\\v");
-				s.replace("\"", "\\\"");
+				s = StringSearch::escape_string(s);
 			}
 		}
 	}
@@ -692,42 +779,84 @@ bool get_utf16_string_at_address(address_t address, QString &s, int min_length,
 			s.clear();
 
 			if(min_length <= max_length) {
-				while(max_length--) {
-
-					quint16 val;
-					if(!process->read_bytes(address, &val, sizeof(val))) {
-						break;
-					}
-
-					address += sizeof(val);
-
-					QChar ch(val);
-
-					// for now, we only acknowledge ASCII chars encoded as unicode
-					const int ascii_char = ch.toLatin1();
-					if(ascii_char >= 0x20 && ascii_char < 0x80) {
-						s += ch;
-					} else {
-						break;
-					}
-				}
+				read_string(process, address, max_length, true, &s);
 			}
 
 			is_string = s.length() >= min_length;
 
 			if(is_string) {
 				found_length = s.length();
-				s.replace("\r", "\\r");
-				s.replace("\n", "\\n");
-				s.replace("\t", "\\t");
-				s.replace("\v", "\\v");
-				s.replace("\"", "\\\"");
+				s = StringSearch::escape_string(s);
 			}
 		}
 	}
 	return is_string;
 }
 
+//------------------------------------------------------------------------------
+// Name: get_strings_at_addresses
+// Desc: the batch form of get_ascii_string_at_address and
+//       get_utf16_string_at_address, returns the strings found at any of the
+//       <addresses>. Where both would match, the ASCII string is taken
+// Note: the memory at all of the addresses is fetched with a single read,
+//       each one up to the end of its page. Only strings which run on past
+//       that are finished with further reads
+//------------------------------------------------------------------------------
+QVector<StringHit> get_strings_at_addresses(const QVector<address_t> &addresses, int min_length, int max_length) {
+
+	QVector<StringHit> strings;
+
+	if(!debugger_core || min_length > max_length || max_length <= 0) {
+		return strings;
+	}
+
+	IProcess *const process = debugger_core->process();
+	if(!process) {
+		return strings;
+	}
+
+	// enough for either kind of string
+	const std::size_t size = static_cast<std::size_t>(max_length) * 2;
+
+	QVector<quint8> buffer(static_cast<int>(addresses.size() * size));
+	QVector<ReadSpan> spans;
+	spans.reserve(addresses.size());
+
+	for(int i = 0; i < addresses.size(); ++i) {
+		spans.push_back({ addresses[i], buffer.data() + i * size, std::min(size, page_remaining(addresses[i])), 0 });
+	}
+
+	process->read_spans(spans.data(), spans.size());
+
+	for(int i = 0; i < spans.size(); ++i) {
+		const ReadSpan &span = spans[i];
+		const quint8 *bytes  = buffer.constData() + i * size;
+
+		for(const bool utf16 : { false, true }) {
+			const std::size_t char_size = utf16 ? 2 : 1;
+			const int available = static_cast<int>(std::min<std::size_t>(span.bytes_read / char_size, max_length));
+
+			QString s;
+			const int length = append_string_chars(bytes, available, utf16, &s);
+
+			// the string goes on into the next page
+			if(length == available && length < max_length && span.bytes_read == span.length) {
+				s.clear();
+				read_string(process, span.address, max_length, utf16, &s);
+			}
+
+			if(s.length() >= min_length) {
+				const int found_length = s.length();
+				s = StringSearch::escape_string(s);
+				strings.push_back({ span.address, found_length, utf16, s });
+				break;
+			}
+		}
+	}
+
+	return strings;
+}
+
 //------------------------------------------------------------------------------
 // Name: find_function_symbol
 // Desc:
@@ -933,6 +1062,14 @@ IPlugin *find_plugin_by_name(const QString &name) {
 //------------------------------------------------------------------------------
 void reload_symbols() {
 	symbol_manager().clear();
+
+	if(debugger_core) {
+		debugger_core->clear_conditions();
+	}
+
+	// regions are only scanned for modules when they first show up, so forget
+	// them all and let the next sync find everything again
+	memory_regions().clear();
 }
 
 //------------------------------------------------------------------------------
@@ -1441,6 +1578,141 @@ QVector<quint8> read_pages(address_t address, size_t page_count) {
 	return QVector<quint8>();
 }
 
+//------------------------------------------------------------------------------
+// Name: find_pointers
+// Desc: finds the pointer aligned slots of <region> which point into
+//       [first, last)
+//------------------------------------------------------------------------------
+QVector<PointerRef> find_pointers(const std::shared_ptr<IRegion> &region, address_t first, address_t last, const std::function<void(int)> &progress) {
+
+	if(region && debugger_core) {
+		if(IProcess *process = debugger_core->process()) {
+			return collect_pointers(process, region, first, last, progress);
+		}
+	}
+
+	return QVector<PointerRef>();
+}
+
+//------------------------------------------------------------------------------
+// Name: find_pointers_to_bytes
+// Desc: finds the pointer aligned slots of <region> which point at memory
+//       starting with <bytes>
+// Note: the region is read once, and the distinct targets are then fetched
+//       together, grouped by the region they are in
+//------------------------------------------------------------------------------
+QVector<PointerRef> find_pointers_to_bytes(const std::shared_ptr<IRegion> &region, const QByteArray &bytes, const std::function<void(int)> &progress) {
+
+	QVector<PointerRef> results;
+
+	if(!region || !debugger_core || bytes.isEmpty()) {
+		return results;
+	}
+
+	IProcess *const process = debugger_core->process();
+	if(!process) {
+		return results;
+	}
+
+	const std::size_t size = bytes.size();
+
+	// null is never a match
+	const QVector<PointerRef> pointers = collect_pointers(process, region, 1, std::numeric_limits<quint64>::max(), progress);
+
+	QVector<address_t> targets;
+	targets.reserve(pointers.size());
+	for(const PointerRef &pointer : pointers) {
+		targets.push_back(pointer.target);
+	}
+
+	std::sort(targets.begin(), targets.end());
+	targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+
+	// only values which land in a mapped region can be followed
+	const QVector<std::shared_ptr<IRegion>> target_regions = memory_regions().find_regions(targets);
+
+	struct Group {
+		address_t   address;
+		std::size_t length;
+		std::size_t offset; // into the buffer
+		std::shared_ptr<IRegion> region;
+	};
+
+	QVector<Group> groups;
+	std::size_t buffer_size = 0;
+
+	for(int i = 0; i < targets.size(); ++i) {
+		const std::shared_ptr<IRegion> &target_region = target_regions[i];
+		if(!target_region) {
+			continue;
+		}
+
+		const address_t target = targets[i];
+
+		if(!groups.isEmpty()) {
+			Group &group = groups.back();
+			const address_t group_end = group.address + group.length;
+
+			if(group.region == target_region && target <= group_end + TARGET_MERGE_GAP && (target + size) - group.address <= TARGET_SPAN_MAX) {
+				const std::size_t length = (target + size) - group.address;
+				if(length > group.length) {
+					buffer_size += length - group.length;
+					group.length = length;
+				}
+				continue;
+			}
+		}
+
+		groups.push_back({ target, size, buffer_size, target_region });
+		buffer_size += size;
+	}
+
+	QVector<quint8> buffer(static_cast<int>(buffer_size));
+	QVector<ReadSpan> spans;
+	spans.reserve(groups.size());
+	for(const Group &group : groups) {
+		spans.push_back({ group.address, buffer.data() + group.offset, group.length, 0 });
+	}
+
+	process->read_spans(spans.data(), spans.size());
+
+	// both the targets and the groups are sorted, so walk them together
+	QVector<bool> matches(targets.size(), false);
+	int group_index = 0;
+
+	for(int i = 0; i < targets.size() && group_index < groups.size(); ++i) {
+		if(!target_regions[i]) {
+			continue;
+		}
+
+		const address_t target = targets[i];
+		while(group_index < groups.size() && groups[group_index].address + groups[group_index].length < target + size) {
+			++group_index;
+		}
+
+		if(group_index == groups.size()) {
+			break;
+		}
+
+		const Group &group     = groups[group_index];
+		const ReadSpan &span   = spans[group_index];
+		const std::size_t skip = target - group.address;
+
+		if(target >= group.address && skip + size <= span.bytes_read) {
+			matches[i] = std::memcmp(buffer.constData() + group.offset + skip, bytes.constData(), size) == 0;
+		}
+	}
+
+	for(const PointerRef &pointer : pointers) {
+		const auto it = std::lower_bound(targets.begin(), targets.end(), pointer.target);
+		if(matches[static_cast<int>(it - targets.begin())]) {
+			results.push_back(pointer);
+		}
+	}
+
+	return results;
+}
+
 //------------------------------------------------------------------------------
 // Name: disassemble_address
 // Desc: will return a QString where isNull is true on failure